@@ -0,0 +1,15 @@
+#ifndef ALPHABET_H
+#define ALPHABET_H
+
+/*
+ * Renumbers the characters of the language by corpus frequency, the most
+ * frequent first, so the hot rows of every frequency table are adjacent, and
+ * shrinks LANG_LENGTH to the characters of the language. With --compact the
+ * characters absent from every layout of the run are dropped as well. The
+ * frequency tables, 'lang_arr' and 'char_table' are rebuilt in the new order,
+ * so layouts read afterwards use it. Must run after the corpus is normalized
+ * and before any cache is written or the tables are used.
+ */
+void remap_alphabet();
+
+#endif
@@ -16,4 +16,16 @@
  */
 void single_analyze(layout *lt);
 
+/*
+ * Performs analysis on many layouts, with the same results single_analyze
+ * gives for each. With a batch kernel the layouts are interleaved in groups
+ * of batch_lanes, one per vector lane, so every ngram of a stat is decoded
+ * once per group instead of once per layout.
+ *
+ * Parameters:
+ *   lts:   The layouts to analyze.
+ *   count: The number of layouts.
+ */
+void batch_analyze(layout **lts, int count);
+
 #endif
@@ -0,0 +1,22 @@
+#ifndef BLEND_H
+#define BLEND_H
+
+/*
+ * Checks whether the selected corpus is a blend of several corpora, given as
+ * 'name:weight,name:weight,...'.
+ *
+ * Returns: 1 if the corpus is a blend, 0 if it is a single corpus.
+ */
+int is_blend();
+
+/*
+ * Fills the global linear arrays with a weighted blend of the normalized
+ * frequencies of several corpora. Corpora without a valid cache are counted
+ * and cached first, then every cache is read in parallel on the worker pool.
+ * The blend is cached under a key derived from the weights and the counts of
+ * each corpus, so repeating it only reads that cache. Only the BLEND_LIMIT
+ * most recently used blend caches of the language are kept.
+ */
+void read_blend();
+
+#endif
@@ -0,0 +1,306 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdint.h>
+
+#include "sparse.h"
+
+/* Identifies a binary corpus cache, followed by the format version. */
+#define CACHE_MAGIC "GLGCACHE"
+#define CACHE_VERSION 2
+
+/* Identifies a cache of normalized frequencies, followed by the format version. */
+#define LINEAR_MAGIC "GLGLINER"
+#define LINEAR_VERSION 2
+
+/* Storage of one block of counts. */
+#define BLOCK_DENSE 0
+#define BLOCK_SPARSE 1
+
+/* Size of the name of a cache source, including the terminator. */
+#define SOURCE_NAME_LENGTH 224
+
+/*
+ * Header at the start of a binary corpus cache, followed by 'block_count'
+ * block descriptors and 'source_count' sources. All multi byte fields are in
+ * native byte order.
+ */
+typedef struct cache_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t lang_length;
+    uint64_t lang_hash;
+    uint32_t block_count;
+    uint32_t source_count;
+} cache_header;
+
+/*
+ * Describes one table of counts. Dense blocks hold 'entries' 64-bit counts in
+ * the order of the index_* functions, sparse blocks hold 'entries' pairs of a
+ * 64-bit index and a 64-bit count, sorted by index.
+ */
+typedef struct cache_block {
+    /* 'm', 'b', 't', 'q', or '1' to '9' for the skipgrams */
+    uint32_t kind;
+    uint32_t format;
+    uint64_t entries;
+    /* from the start of the file, 8 byte aligned */
+    uint64_t offset;
+    /* sum of every count in the table */
+    uint64_t total;
+} cache_block;
+
+/*
+ * One text file counted into the cache, the corpus itself first and then any
+ * appended files. A source whose size and modification time are unchanged is
+ * trusted, otherwise its content hash decides whether the cache is stale.
+ */
+typedef struct cache_source {
+    uint64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t hash;
+    /* name in the corpora directory, without the .txt extension */
+    char name[SOURCE_NAME_LENGTH];
+} cache_source;
+
+/* One nonzero count of a sparse block. */
+typedef struct cache_entry {
+    uint64_t index;
+    uint64_t count;
+} cache_entry;
+
+/*
+ * Header at the start of a cache of normalized frequencies, followed by
+ * 'block_count' block descriptors laid out like those of a corpus cache.
+ * Dense blocks hold 32-bit floats, sparse blocks linear_entry pairs.
+ */
+typedef struct linear_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t lang_length;
+    uint64_t lang_hash;
+    /* identifies what the frequencies were derived from */
+    uint64_t key;
+    uint32_t block_count;
+    uint32_t reserved;
+} linear_header;
+
+/* One nonzero frequency of a sparse block of a linear cache. */
+typedef struct linear_entry {
+    uint64_t index;
+    float value;
+    uint32_t reserved;
+} linear_entry;
+
+/*
+ * Normalized frequency tables of one corpus, laid out like the linear arrays.
+ * Languages kept in sparse tables use the sparse tables instead of 'tri',
+ * 'quad' and 'skip'.
+ */
+typedef struct linear_tables {
+    float *mono;
+    float *bi;
+    float *tri;
+    float *quad;
+    float *skip;
+    sparse_table *sparse_tri;
+    sparse_table *sparse_quad;
+    sparse_table *sparse_skip;
+} linear_tables;
+
+/*
+ * Hashes the current language's character set, a cache built for another
+ * character set (or another order of it) is rejected.
+ *
+ * Returns: The 64-bit FNV-1a hash of 'lang_arr'.
+ */
+uint64_t lang_hash();
+
+/*
+ * Builds the path of a file in the corpora directory of the current language.
+ *
+ * Parameters:
+ *   name:      The name of the corpus.
+ *   extension: The extension to append to the name, such as ".txt".
+ * Returns: The allocated path, to be freed by the caller.
+ */
+char *corpora_path(const char *name, const char *extension);
+
+/*
+ * Builds the path of a file next to the corpus, in the corpora directory of
+ * the current language.
+ *
+ * Parameters:
+ *   extension: The extension to append to the corpus name, such as ".txt".
+ * Returns: The allocated path, to be freed by the caller.
+ */
+char *corpus_path(const char *extension);
+
+/*
+ * Finds the text file of a corpus in the corpora directory, either plain
+ * '<name>.txt' or compressed as '<name>.txt.gz', '.txt.xz' or '.txt.zst', in
+ * that order of preference, or else its word list '<name>.freq' compressed
+ * the same ways.
+ *
+ * Parameters:
+ *   name: The name of the corpus.
+ * Returns: The allocated path of the first file that exists, or of the plain
+ *          '.txt' file if none does, to be freed by the caller.
+ */
+char *source_path(const char *name);
+
+/*
+ * Checks whether a corpus file is a word frequency list, named
+ * '<name>.freq' and possibly compressed, rather than running text.
+ *
+ * Parameters:
+ *   path: The path of the file.
+ * Returns: 1 for a word list, 0 for text.
+ */
+int is_word_list(const char *path);
+
+/*
+ * Returns the number of text files counted into the corpus arrays, as read
+ * from the cache or recorded since.
+ */
+int source_count();
+
+/*
+ * Returns the name of a text file counted into the corpus arrays.
+ *
+ * Parameters:
+ *   i: The index of the source, below source_count().
+ * Returns: The name in the corpora directory, without the extension.
+ */
+const char *source_name(int i);
+
+/*
+ * Records that a text file of the corpora directory was counted into the
+ * corpus arrays, with its current size, modification time and content hash.
+ * A source of the same name is updated in place.
+ *
+ * Parameters:
+ *   name: The name in the corpora directory, without the extension.
+ */
+void record_source(const char *name);
+
+/*
+ * Forgets a source, used when a file counted before no longer exists.
+ *
+ * Parameters:
+ *   i: The index of the source, below source_count().
+ */
+void drop_source(int i);
+
+/* Forgets every source, before counting a different corpus. */
+void clear_sources();
+
+/*
+ * Checks whether a text file is a source whose content did not change since
+ * it was counted.
+ *
+ * Parameters:
+ *   name: The name in the corpora directory, without the extension.
+ * Returns: 1 if the file is already counted as it is, 0 otherwise.
+ */
+int source_unchanged(const char *name);
+
+/*
+ * Reads the binary cache of the current corpus with mmap and fills the global
+ * corpus arrays from it. Every source of the cache is checked first, by size
+ * and modification time, falling back to a content hash if those changed.
+ * The sources of a stale cache are kept, so they can all be recounted.
+ *
+ * Returns: 1 if a valid cache was read, 0 if it is missing, was built for a
+ *          different language or format version, or a source has changed.
+ */
+int read_binary_cache();
+
+/*
+ * Identifies the counts in the binary cache of a corpus, without reading
+ * them. The stamp changes whenever the counts or their sources change.
+ *
+ * Parameters:
+ *   name:  The name of the corpus.
+ *   stamp: Where to store the stamp.
+ * Returns: 1 if the corpus has a valid cache, 0 otherwise.
+ */
+int cache_stamp(const char *name, uint64_t *stamp);
+
+/*
+ * Reads the binary cache of a corpus into its own normalized tables, without
+ * touching the global arrays, so several corpora can be read at once.
+ *
+ * Parameters:
+ *   name:   The name of the corpus.
+ *   tables: Where to store the allocated tables, freed with free_tables.
+ * Returns: 1 if a valid cache was read, 0 otherwise.
+ */
+int read_cache_linear(const char *name, linear_tables *tables);
+
+/*
+ * Frees the tables allocated by read_cache_linear.
+ *
+ * Parameters:
+ *   tables: The tables.
+ */
+void free_tables(linear_tables *tables);
+
+/*
+ * Reads a cache of normalized frequencies into the global linear arrays, or
+ * the sparse tables of large languages. The dense mono to quad tables are
+ * used in place from the mapped file, without being copied, and the arrays
+ * they replace are freed. Tables that are not allocated yet are allocated.
+ *
+ * Parameters:
+ *   path: The path of the cache.
+ *   key:  What the frequencies must have been derived from.
+ * Returns: 1 if a valid cache was read, 0 if it is missing or was built from
+ *          something else, for another language or format version.
+ */
+int read_linear_cache(const char *path, uint64_t key);
+
+/*
+ * Writes the global linear arrays, or the sparse tables of large languages,
+ * to a cache of normalized frequencies. Dense arrays are stored dense on a
+ * cache line so they can be mapped, skipgram blocks dense or sparse,
+ * whichever is smaller, and the file is replaced atomically.
+ *
+ * Parameters:
+ *   path: The path of the cache.
+ *   key:  What the frequencies were derived from.
+ */
+void write_linear_cache(const char *path, uint64_t key);
+
+/*
+ * Unmaps the cache of normalized frequencies read by read_linear_cache, and
+ * sets the global linear arrays used from it to NULL.
+ */
+void release_linear_cache();
+
+/*
+ * Reads the normalized frequencies of the current corpus from its
+ * '<corpus>.glinear' cache, which is only valid for the binary cache of
+ * counts it was written from. Skips both reading the counts and normalizing
+ * them. Standard input and appending always need the counts.
+ *
+ * Returns: 1 if the normalized cache was read, 0 otherwise.
+ */
+int read_normalized_cache();
+
+/*
+ * Writes the normalized frequencies of the current corpus to its
+ * '<corpus>.glinear' cache, tied to its current binary cache of counts.
+ */
+void write_normalized_cache();
+
+/*
+ * Writes the global corpus arrays to the binary cache of the current corpus.
+ * Each table is stored dense or sparse, whichever is smaller. The cache is
+ * written to a temporary file and renamed over the old one, so a reader never
+ * sees a partial cache.
+ */
+void write_binary_cache();
+
+#endif
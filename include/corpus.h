@@ -0,0 +1,22 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+/*
+ * Counts every ngram of a UTF-8 text file into the global corpus arrays. The
+ * file is split into byte ranges aligned to character boundaries, each range
+ * is counted by a pool task into private tables, and the tables are summed.
+ * Each range first reads the 10 characters before it without counting them,
+ * so ngrams and skipgrams spanning two ranges are counted exactly once and
+ * the result is identical to counting the file sequentially. Files
+ * compressed with gzip, xz or zstd, and pipes, are decompressed on a separate
+ * thread and counted chunk by chunk in the same way.
+ * A word frequency list, named '.freq', instead counts every word once with
+ * the word separator after it, weighted by the count of the word.
+ *
+ * Parameters:
+ *   path: The path of the text file, or "-" for standard input.
+ * Returns: 1 if the file was counted, 0 if it could not be opened.
+ */
+int ingest_file(const char *path);
+
+#endif
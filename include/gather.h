@@ -0,0 +1,74 @@
+#ifndef GATHER_H
+#define GATHER_H
+
+/*
+ * The ngrams of one stat decoded into offsets of the layout matrix, viewed as
+ * MAX_ROW * MAX_COL ints, so no kernel has to unflatten them.
+ */
+typedef struct gather_list {
+    /* offsets[k][j] is key k of ngram j, zero padded to a multiple of 16 */
+    int *offsets[4];
+    int keys;
+    int length;
+} gather_list;
+
+/*
+ * Sums the frequencies of the ngrams of a list whose keys all hold a
+ * character, once per target.
+ * Parameters:
+ *   list:   The decoded ngrams of the stat.
+ *   matrix: The layout matrix.
+ *   table:  The dense frequency array of the ngram type.
+ *   bases:  The start of each target in the array, the skip distance block.
+ *   count:  The number of targets, at most 9.
+ *   sums:   The sum of each target.
+ */
+typedef void (*gather_function)(const gather_list *list, const int *matrix, const float *table,
+    const int *bases, int count, float *sums);
+
+/* The kernel for this cpu, chosen by prepare_gather. */
+extern gather_function gather_sums;
+
+/* The most layouts a batch kernel scores at once. */
+#define BATCH_MAX 16
+
+/*
+ * Sums the frequencies of the ngrams of a list for a batch of layouts, one
+ * layout per lane, once per target. Each lane adds in list order, the same
+ * order the scalar kernel adds in.
+ * Parameters:
+ *   list:   The decoded ngrams of the stat.
+ *   soa:    The batch, soa[offset * batch_lanes + lane] is the character at
+ *           matrix offset 'offset' of the layout in 'lane'.
+ *   table:  The dense frequency array of the ngram type.
+ *   bases:  The start of each target in the array, the skip distance block.
+ *   count:  The number of targets, at most 9.
+ *   sums:   sums[t * batch_lanes + lane] is target t of the layout in 'lane'.
+ */
+typedef void (*batch_function)(const gather_list *list, const int *soa, const float *table,
+    const int *bases, int count, float *sums);
+
+/* The batch kernel for this cpu, NULL without vector instructions. */
+extern batch_function batch_sums;
+
+/* The layouts batch_sums scores at once, 1 without a batch kernel. */
+extern int batch_lanes;
+
+/* The decoded ngrams of every stat, empty for stats that are not gathered. */
+extern gather_list *gather_mono;
+extern gather_list *gather_bi;
+extern gather_list *gather_tri;
+extern gather_list *gather_quad;
+extern gather_list *gather_skip;
+
+/*
+ * Decodes the ngrams of every stat single_analyze gathers and picks the
+ * widest kernels the cpu and --simd allow: AVX-512, AVX2 or scalar, for
+ * single layouts and for batches. Must run after the stats are cleaned.
+ */
+void prepare_gather();
+
+/* Frees the decoded ngram lists. */
+void free_gather();
+
+#endif
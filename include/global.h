@@ -3,14 +3,7 @@
 
 #include <wchar.h>
 #include "structs.h"
-
-/* Defining dimensions for the layout grid. */
-#define row 3
-#define col 12
-#define dim1 row * col
-#define dim2 dim1 * dim1
-#define dim3 dim2 * dim1
-#define dim4 dim3 * dim1
+#include "sparse.h"
 
 /* Character count in the chosen language. */
 extern int LANG_LENGTH;
@@ -18,7 +11,13 @@ extern int LANG_LENGTH;
 /* Maximum length of a language definition file. */
 extern int LANG_FILE_LENGTH;
 
-/* Re-iterate the dimensions for external use. */
+/* Largest character count whose tri, quad and skip tables are stored dense. */
+extern int DENSE_LANG_LENGTH;
+
+/*
+ * Dimensions of the keyboard grid and the number of ngrams of each size,
+ * read from the keyboard file.
+ */
 extern int ROW;
 extern int COL;
 extern int DIM1;
@@ -26,6 +25,18 @@ extern int DIM2;
 extern int DIM3;
 extern int DIM4;
 
+/* Number of grid positions with a key. */
+extern int KEY_COUNT;
+
+/* Row of the home keys, the top row is above it and the bottom row below. */
+extern int HOME_ROW;
+
+/* Finger of every grid position (0-7), -1 where the grid has no key. */
+extern int key_fingers[MAX_ROW][MAX_COL];
+
+/* 1 for the stretch positions (pinky and index stretch), 0 otherwise. */
+extern int key_stretch[MAX_ROW][MAX_COL];
+
 extern int MAX_SWAPS;
 extern int WORKERS;
 
@@ -36,6 +47,39 @@ extern char *layout_name;
 extern char *layout2_name;
 extern char *weight_name;
 
+/* Keyboard geometry in data/keyboards/, NULL for the standard keyboard. */
+extern char *keyboard_name;
+
+/* Optional output file for the improvement time series (CSV or JSONL). */
+extern char *telemetry_name;
+
+/* Comma separated text files to count into the corpus cache, NULL for none. */
+extern char *append_name;
+
+/* Custom stat definitions in data/stats/, NULL for none. */
+extern char *custom_stats_name;
+
+/* 1 to score with a scorer compiled for the configuration, see scorer.c. */
+extern int specialize;
+
+/* Instruction set of the gather kernels, 'a'uto, '5' AVX-512, '2' AVX2, 's'calar. */
+extern char simd_level;
+
+/* 1 to drop the characters no layout of the run holds, see alphabet.c. */
+extern int compact;
+
+/* Character counted after every word of a word list corpus, 0 for none. */
+extern int word_separator;
+
+/* Stagnation detection for the annealing threads, 0 disables a criterion. */
+extern int stagnation_limit;
+extern float stagnation_accept;
+extern char stagnation_action;
+
+/* Target acceptance rates of worse moves used to calibrate the temperature. */
+extern float accept_start;
+extern float accept_end;
+
 /* Control flags for program execution. */
 extern char run_mode;
 extern int repetitions;
@@ -53,17 +97,20 @@ extern wchar_t *lang_arr;
 extern int *char_table;
 
 /* Pinned key positions on the layout for improvement. */
-extern int pins[row][col];
+extern int pins[MAX_ROW][MAX_COL];
 
 /* Head of the linked list for layout ranking. */
 extern layout_node *head_node;
 
-/* Arrays to store raw frequency counts from the corpus. */
-extern int *corpus_mono;
-extern int **corpus_bi;
-extern int ***corpus_tri;
-extern int ****corpus_quad;
-extern int ***corpus_skip;
+/*
+ * Arrays to store raw frequency counts from the corpus, flat and indexed like
+ * the linear arrays. Freed once the corpus is normalized.
+ */
+extern long long *corpus_mono;
+extern long long *corpus_bi;
+extern long long *corpus_tri;
+extern long long *corpus_quad;
+extern long long *corpus_skip;
 
 /* Arrays to store normalized frequency data (percentages). */
 extern float *linear_mono;
@@ -72,6 +119,14 @@ extern float *linear_tri;
 extern float *linear_quad;
 extern float *linear_skip;
 
+/*
+ * Sparse tables replacing the tri, quad and skip arrays (both raw and linear)
+ * for languages larger than DENSE_LANG_LENGTH, NULL otherwise.
+ */
+extern sparse_table *sparse_tri;
+extern sparse_table *sparse_quad;
+extern sparse_table *sparse_skip;
+
 /* total umber of statistics for each ngram type. */
 extern int MONO_LENGTH;
 extern int BI_LENGTH;
@@ -80,6 +135,12 @@ extern int QUAD_LENGTH;
 extern int SKIP_LENGTH;
 extern int META_LENGTH;
 
+/* How the analysis computes each type of statistic, see stats/plan.c. */
+extern stat_plan plan_mono;
+extern stat_plan plan_bi;
+extern stat_plan plan_tri;
+extern stat_plan plan_quad;
+
 /* Arrays to hold all statistics after processing. */
 extern mono_stat *stats_mono;
 extern bi_stat *stats_bi;
@@ -73,26 +73,44 @@ void check_setup();
 void read_lang();
 
 /*
- * Attempts to read corpus data from a cache file. If the cache file exists,
- * it reads the pre-computed ngram frequencies into the global corpus arrays.
+ * Checks whether the corpus is read from standard input, selected as '-'.
+ * Such a corpus is never cached, as it cannot be checked for changes.
+ *
+ * Returns: 1 if the corpus is standard input, 0 otherwise.
+ */
+int corpus_from_stdin();
+
+/*
+ * Attempts to read corpus data from a cache file. The binary cache is read if
+ * it is valid, otherwise an old text cache is imported and converted to a
+ * binary cache for the next run.
  *
  * Returns:
- *   1 if the cache file was successfully read, 0 otherwise.
+ *   1 if a cache file was successfully read, 0 otherwise.
  */
 int read_corpus_cache();
 
 /*
- * Reads and processes a corpus text file to collect ngram frequency data. Reads
- * the corpus character by character, updating the frequency counts in the
- * global corpus arrays for monograms, bigrams, trigrams, quadgrams,
- * and skipgrams.
+ * Reads and processes a corpus text file to collect ngram frequency data. The
+ * corpus is counted in parallel on the worker pool, updating the frequency
+ * counts in the global corpus arrays for monograms, bigrams, trigrams,
+ * quadgrams, and skipgrams. Files appended to a stale cache are recounted.
+ * Corpora compressed with gzip, xz or zstd and standard input are
+ * decompressed as they are counted.
  */
 void read_corpus();
 
+/*
+ * Counts the text files named by --append into the corpus arrays and adds
+ * them to the cache, so new text is counted without rereading the corpus.
+ * Files already counted with the same content are skipped.
+ */
+void append_corpus();
+
 /*
  * Creates or updates a cache file with the current corpus frequency data.
  * This function writes the current state of the global corpus arrays to a
- * cache file, allowing for quicker initialization in future runs.
+ * binary cache file, allowing for quicker initialization in future runs.
  */
 void cache_corpus();
 
@@ -114,6 +132,17 @@ void read_weights();
  */
 void read_layout(layout *lt, int which_layout);
 
+/*
+ * Reads and initializes a layout from the named file in the current language's
+ * layouts directory. Does not touch any globals, so it is safe to call from
+ * pool tasks.
+ *
+ * Parameters:
+ *   lt:   A pointer to the layout structure to be initialized.
+ *   name: The layout name, without the .glg extension.
+ */
+void read_named_layout(layout *lt, const char *name);
+
 /*
  * Prints the layout name and score.
  * Parameters:
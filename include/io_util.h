@@ -68,4 +68,31 @@ char check_output_mode(char *optarg);
  */
 char check_backend_mode(char *optarg);
 
+/*
+ * Validates and converts a stagnation action string to its corresponding
+ * character representation.
+ * Parameters:
+ *   optarg: The string representing the stagnation action.
+ * Returns: The character representing the validated stagnation action, or 'r'
+ *          if invalid.
+ */
+char check_stagnation_action(char *optarg);
+
+/*
+ * Validates and converts a word separator, given as a single character or as
+ * 'space' or 'none'.
+ * Parameters:
+ *   optarg: The string representing the separator.
+ * Returns: The code point of the separator, or 0 for none.
+ */
+int check_separator(char *optarg);
+
+/*
+ * Validates and converts the instruction set of the gather kernels.
+ * Parameters:
+ *   optarg: 'auto', 'avx512', 'avx2' or 'scalar'.
+ * Returns: 'a', '5', '2' or 's'.
+ */
+char check_simd(char *optarg);
+
 #endif
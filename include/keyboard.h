@@ -0,0 +1,13 @@
+#ifndef KEYBOARD_H
+#define KEYBOARD_H
+
+/*
+ * Reads the keyboard geometry of './data/keyboards/<keyboard_name>.kbd',
+ * 'standard' when no keyboard is selected with --keyboard. Sets the grid
+ * dimensions, the finger and stretch of every position and the home row,
+ * pins every position without a key, and sets MAX_SWAPS from the number of
+ * keys. Must run before the stats are initialized or a layout is read.
+ */
+void read_keyboard();
+
+#endif
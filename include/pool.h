@@ -0,0 +1,46 @@
+#ifndef POOL_H
+#define POOL_H
+
+/*
+ * Creates the persistent worker pool used by every mode. Workers are started
+ * once and sleep until tasks are submitted, so short jobs do not pay thread
+ * creation costs.
+ *
+ * Parameters:
+ *   workers: The number of worker threads to start with.
+ */
+void create_pool(int workers);
+
+/*
+ * Makes sure the pool has at least the given number of workers, starting new
+ * ones if needed. Must only be called while the pool is idle.
+ *
+ * Parameters:
+ *   workers: The minimum number of worker threads required.
+ */
+void pool_reserve(int workers);
+
+/* Returns the current number of worker threads in the pool. */
+int pool_size();
+
+/*
+ * Queues a task on the pool. Tasks submitted from outside the pool are
+ * distributed round robin across the worker queues, tasks submitted from a
+ * worker go onto that worker's own queue. Idle workers steal from the others.
+ *
+ * Parameters:
+ *   function: The function to run on a worker.
+ *   arg:      The argument passed to the function.
+ */
+void pool_submit(void (*function)(void *), void *arg);
+
+/*
+ * Blocks until every submitted task has finished. Must not be called from
+ * inside a task.
+ */
+void pool_wait();
+
+/* Stops and joins all workers, then frees the pool. */
+void destroy_pool();
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef SCORER_H
+#define SCORER_H
+
+/*
+ * Version of the generated source, part of the key of the compiled scorers.
+ * Increase it whenever the emitted code changes meaning.
+ */
+#define SCORER_VERSION 1
+
+/*
+ * Signature of a specialized scorer: the layout matrix as MAX_ROW * MAX_COL
+ * ints, followed by the score arrays of the layout it fills.
+ */
+typedef void (*scorer_function)(const int *matrix, float *mono_score, float *bi_score,
+    float *tri_score, float *quad_score, float **skip_score, float *meta_score);
+
+/* The specialized scorer in use by single_analyze, NULL for the generic one. */
+extern scorer_function specialized_scorer;
+
+/*
+ * Emits C source computing every stat single_analyze would for the current
+ * stat set, weights, keyboard and language, with all of them folded in as
+ * constants. The source is compiled with the system compiler ($CC, or cc)
+ * into './data/scorers/<hash>.so', loaded, and used by single_analyze in
+ * place of the generic loops. A scorer already compiled for the same source
+ * on the same cpu is loaded without compiling, and only the SCORER_LIMIT most
+ * recently used scorers are kept. Without a compiler, or for languages too large
+ * for dense arrays, the generic scorer stays in use. Must run after the stats
+ * are cleaned and the frequencies normalized.
+ */
+void build_scorer();
+
+/* Unloads the specialized scorer, if any. */
+void free_scorer();
+
+#endif
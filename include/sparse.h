@@ -0,0 +1,114 @@
+#ifndef SPARSE_H
+#define SPARSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Sparse table of ngram frequencies, used in place of a flat array when the
+ * alphabet is too large to store every possible ngram. Entries are keyed by
+ * the same flat index as the linear arrays and kept in an open addressing hash
+ * table, so memory scales with the ngrams seen in the corpus rather than with
+ * the alphabet size to the fourth power.
+ */
+typedef struct sparse_table {
+    /* flat index plus one, 0 marks an empty slot */
+    uint64_t *keys;
+    /* raw counts, freed once the table is normalized */
+    long long *counts;
+    /* normalized frequencies, NULL until the table is normalized */
+    float *values;
+    /* capacity minus one, the capacity is a power of 2 */
+    size_t mask;
+    size_t used;
+} sparse_table;
+
+/*
+ * Hashes a flat index to its first slot in a sparse table.
+ * Parameters:
+ *   t:     The table.
+ *   index: The flat index.
+ * Returns: The slot to start probing from.
+ */
+static inline size_t sparse_slot(const sparse_table *t, uint64_t index)
+{
+    uint64_t hash = index * 0x9E3779B97F4A7C15ULL;
+    return (size_t)(hash ^ (hash >> 32)) & t->mask;
+}
+
+/*
+ * Looks up the normalized frequency of an ngram, the hot path of scoring.
+ * Parameters:
+ *   t:     A normalized table.
+ *   index: The flat index of the ngram.
+ * Returns: The frequency, or 0 if the ngram never occurs in the corpus.
+ */
+static inline float sparse_value(const sparse_table *t, uint64_t index)
+{
+    uint64_t key = index + 1;
+    for (size_t slot = sparse_slot(t, index);; slot = (slot + 1) & t->mask) {
+        if (t->keys[slot] == key) {return t->values[slot];}
+        if (t->keys[slot] == 0) {return 0;}
+    }
+}
+
+/*
+ * Allocates an empty sparse table.
+ * Parameters:
+ *   capacity: The expected number of distinct ngrams, the table grows past it.
+ * Returns: The allocated table, to be released with free_sparse.
+ */
+sparse_table *create_sparse(size_t capacity);
+
+/*
+ * Frees a sparse table, NULL is ignored.
+ * Parameters:
+ *   t: The table.
+ */
+void free_sparse(sparse_table *t);
+
+/*
+ * Adds to the raw count of an ngram, inserting it if it is new.
+ * Parameters:
+ *   t:     The table.
+ *   index: The flat index of the ngram.
+ *   count: The amount to add.
+ */
+void sparse_add(sparse_table *t, uint64_t index, long long count);
+
+/*
+ * Adds to the normalized frequency of an ngram, inserting it if it is new,
+ * used to fill a table from normalized data such as a blend of corpora.
+ * Parameters:
+ *   t:     The table.
+ *   index: The flat index of the ngram.
+ *   value: The amount to add.
+ */
+void sparse_add_value(sparse_table *t, uint64_t index, float value);
+
+/*
+ * Adds every raw count of one table to another.
+ * Parameters:
+ *   dest: The table to add to.
+ *   src:  The table to add.
+ */
+void merge_sparse(sparse_table *dest, const sparse_table *src);
+
+/*
+ * Converts the raw counts to percentages of the total of their group, the way
+ * normalize_corpus treats the dense arrays. The raw counts are kept.
+ * Parameters:
+ *   t:     The table.
+ *   group: The number of flat indices per group, every skip distance is its
+ *          own group of LANG_LENGTH^2 indices, the other tables one group.
+ */
+void normalize_sparse(sparse_table *t, uint64_t group);
+
+/*
+ * Frees the raw counts of a normalized table, NULL is ignored.
+ * Parameters:
+ *   t: The table.
+ */
+void free_sparse_counts(sparse_table *t);
+
+#endif
@@ -9,8 +9,8 @@
 void initialize_bi_stats();
 
 /*
- * Trims the ngrams in the array to move unused entries to the end.
- * This process ensures memory efficiency by eliminating gaps in the array.
+ * Trims the ngram array of every stat down to the ngrams in it, dropping the
+ * -1 entries and any ngram touching a gap of the keyboard.
  */
 void trim_bi_stats();
 
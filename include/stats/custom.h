@@ -0,0 +1,40 @@
+#ifndef CUSTOM_H
+#define CUSTOM_H
+
+#include <stdint.h>
+
+/*
+ * Reads the custom stat definitions of './data/stats/<custom_stats_name>.stat'
+ * selected with --stats. Nothing is read when no file is selected. Every line
+ * defines one stat as '<type> <name>: <condition>', see data/README.md.
+ */
+void read_custom_stats();
+
+/*
+ * Hashes the custom stat definitions for the key of the stats cache, so the
+ * cached tables are rebuilt whenever the definitions change.
+ *
+ * Returns: The 64-bit FNV-1a hash of the parsed definitions.
+ */
+uint64_t custom_stats_hash();
+
+/*
+ * Appends the custom stats to the built-in stat arrays of their type and
+ * classifies every ngram for them in the same pass the built-in stats use.
+ */
+void initialize_custom_stats();
+
+/*
+ * Sets the weight of every custom stat to 0, so a weights file that does not
+ * mention a custom stat leaves it out of the analysis. Called before the
+ * weights are read.
+ */
+void default_custom_weights();
+
+/* Returns the number of custom stats defined. */
+int custom_stat_count();
+
+/* Frees the custom stat definitions. */
+void free_custom_stats();
+
+#endif
@@ -14,6 +14,13 @@ void initialize_mono_stats();
  */
 void trim_mono_stats();
 
+/*
+ * Sets the weight of every heatmap stat to 0. The heatmaps follow the keys of
+ * the keyboard, so a weights file written for another keyboard need not name
+ * them all. Called before the weights are read.
+ */
+void default_heatmap_weights();
+
 /*
  * Cleans the monogram statistics array by removing statistics with zero length
  * or weight. This ensures that only relevant statistics are considered in the
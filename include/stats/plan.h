@@ -0,0 +1,23 @@
+#ifndef PLAN_H
+#define PLAN_H
+
+/*
+ * Plans how the analysis computes the monogram to quadgram stats once the
+ * weights are read and the skip flags final. A stat that must be computed and
+ * is exactly the union of disjoint smaller stats, such as Same Finger Bigram
+ * and the eight per finger bigram stats, is summed from their scores whenever
+ * at least one of them is computed anyway, which gathers fewer ngrams than
+ * the stat itself. The remaining stats are gathered from their ngrams.
+ */
+void plan_partitions();
+
+/*
+ * Returns the number of stats of every type summed from their partitions
+ * rather than gathered.
+ */
+int derived_count();
+
+/* Frees the plans made by plan_partitions. */
+void free_plans();
+
+#endif
@@ -8,12 +8,6 @@
  */
 void initialize_quad_stats();
 
-/*
- * Trims the ngrams in the array to move unused entries to the end.
- * This process ensures memory efficiency by eliminating gaps in the array.
- */
-void trim_quad_stats();
-
 /*
  * Cleans the quadgram statistics array by removing statistics with zero length
  * or weight. This ensures that only relevant statistics are considered in the
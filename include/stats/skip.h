@@ -1,6 +1,8 @@
 #ifndef SKIP_H
 #define SKIP_H
 
+#include "structs.h"
+
 /*
  * Initializes the array of skipgram statistics. The function allocates memory
  * for the stat array and sets default values, including a negative infinity
@@ -9,8 +11,8 @@
 void initialize_skip_stats();
 
 /*
- * Trims the ngrams in the array to move unused entries to the end.
- * This process ensures memory efficiency by eliminating gaps in the array.
+ * Trims the ngram array of every stat down to the ngrams in it, dropping the
+ * -1 entries and any ngram touching a gap of the keyboard.
  */
 void trim_skip_stats();
 
@@ -21,6 +23,24 @@ void trim_skip_stats();
  */
 void clean_skip_stats();
 
+/*
+ * Plans which skip distances of each skipgram stat are evaluated: those with
+ * a nonzero weight, and those used by a meta stat that is not skipped. Runs
+ * after define_meta_stats, so the analysis never computes a distance that
+ * cannot change the score.
+ */
+void plan_skip_stats();
+
+/*
+ * Checks whether a skip distance of a skipgram stat is evaluated.
+ *
+ * Parameters:
+ *   stat:     Pointer to the skip_stat structure.
+ *   distance: The skip distance (1-9).
+ * Returns: 1 if the distance is evaluated, 0 otherwise.
+ */
+int evaluates_distance(const skip_stat *stat, int distance);
+
 /* Frees the memory allocated for the skipgram statistics array. */
 void free_skip_stats();
 
@@ -0,0 +1,69 @@
+#ifndef STATS_CACHE_H
+#define STATS_CACHE_H
+
+#include <stdint.h>
+
+/* Identifies a cache of built stat tables, followed by the format version. */
+#define STATS_MAGIC "GLGSTATS"
+#define STATS_FORMAT 1
+
+/*
+ * Version of the stat definitions, part of the key of the stats cache.
+ * Increase it whenever a stat is added, removed, renamed or reordered, or a
+ * classifier in stats_util.c changes, so cached tables are rebuilt.
+ */
+#define STATS_VERSION 2
+
+/* Size of the name of a cached stat, including the terminator. */
+#define STATS_NAME_LENGTH 64
+
+/*
+ * Header at the start of a stats cache, followed by 'table_count' table
+ * descriptors. All multi byte fields are in native byte order.
+ */
+typedef struct stats_header {
+    char magic[8];
+    uint32_t format;
+    uint32_t table_count;
+    /* hash of the keyboard geometry and the stat definitions */
+    uint64_t key;
+} stats_header;
+
+/*
+ * Describes the ngram list of one stat, 'length' 32-bit flat indices in
+ * ascending order. Tables are in the order the stats are built.
+ */
+typedef struct stats_table {
+    /* 'm', 'b', 't', 'q' or 's' */
+    uint32_t kind;
+    uint32_t length;
+    /* from the start of the file, 64 byte aligned */
+    uint64_t offset;
+    char name[STATS_NAME_LENGTH];
+} stats_table;
+
+/*
+ * Hashes everything the stat tables are derived from: the dimensions of the
+ * grid and its home row, the hand, finger and stretch of every key, the
+ * custom stat definitions, and STATS_VERSION.
+ *
+ * Returns: The 64-bit FNV-1a key of the stats cache.
+ */
+uint64_t stats_key();
+
+/*
+ * Reads the monogram to skipgram stats from the stats cache, in place of
+ * building them. Each ngram array is allocated to exactly its length.
+ *
+ * Returns: 1 if a cache with the current key was read, 0 otherwise.
+ */
+int read_stats_cache();
+
+/*
+ * Writes the built monogram to skipgram stats to the stats cache.
+ * The file is written to a temporary file and renamed over the old one, so a
+ * reader never sees it half written.
+ */
+void write_stats_cache();
+
+#endif
@@ -17,10 +17,62 @@
  */
 int find_stat_index(char *stat_name, char type);
 
+/*
+ * Returns whether every key of an ngram is on the keyboard, rather than in a
+ * gap of its grid.
+ *
+ * Parameters:
+ *   index: The flat index of the ngram.
+ *   keys:  The number of keys in the ngram.
+ */
+int is_key_ngram(int index, int keys);
+
+/*
+ * Classifies every ngram of one size for a set of stats in a single pass.
+ * Each ngram is decoded once and run through every classifier, and the ngrams
+ * are split into blocks across the worker pool. The lists of the blocks are
+ * then joined in order, so each stat gets exactly its ngrams, ascending.
+ * Ngrams touching a gap of the keyboard fall under no stat and are not
+ * enumerated, so the work grows with the keys rather than the grid.
+ *
+ * Parameters:
+ *   keys:     The number of keys in each ngram.
+ *   count:    The number of stats.
+ *   classify: Sets members[s] to whether an ngram falls under stat s, for
+ *             every stat.
+ *   ngrams:   Returns where to store the allocated ngram array of a stat.
+ *   lengths:  Where to store the number of ngrams in each stat.
+ */
+void classify_ngrams(int keys, int count, void (*classify)(int index, char *members),
+    int **(*ngrams)(int stat), int *lengths);
+
+/*
+ * Packs the ngram array of a hand written stat, built over every ngram with
+ * the index of each member and -1 elsewhere, down to exactly its members on
+ * the keyboard, in ascending order. Sets the length of the stat to match.
+ *
+ * Parameters:
+ *   ngrams: The ngram array of the stat, reallocated to its length.
+ *   length: Where to store the number of ngrams in the stat.
+ *   size:   The number of entries in the array before packing.
+ *   keys:   The number of keys in each ngram.
+ */
+void pack_ngrams(int **ngrams, int *length, int size, int keys);
+
+/*
+ * Allocates the ngram array of a hand written stat over every ngram of its
+ * size, to be filled by the initialize functions and packed afterwards.
+ *
+ * Parameters:
+ *   size: The number of ngrams, such as DIM2 for bigrams.
+ * Returns: The array, uninitialized.
+ */
+int *full_ngrams(int size);
+
 /* 'l' for left hand, 'r' for right hand. */
 char hand(int row0, int col0);
 
-/* An integer representing the finger used (0-7). */
+/* An integer representing the finger used (0-7), -1 without a key. */
 int finger(int row0, int col0);
 
 /* pinky and index stretch */
@@ -75,7 +127,10 @@ int is_full_russor(int row0, int col0, int row1, int col1);
 /* 1u is half */
 int is_half_russor(int row0, int col0, int row1, int col1);
 
+/* middle finger next to an index stretch key of the same hand */
 int is_index_stretch_bi(int row0, int col0, int row1, int col1);
+
+/* ring finger next to a pinky stretch key of the same hand */
 int is_pinky_stretch_bi(int row0, int col0, int row1, int col1);
 
 /*                                                   */
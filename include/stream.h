@@ -0,0 +1,76 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stddef.h>
+
+/*
+ * A corpus read as a sequence of chunks, decompressed on its own thread while
+ * the previous chunks are counted. Plain text, gzip and xz are supported, and
+ * zstd when GULAG is built with it. The format is detected from the first
+ * bytes, so it also works on standard input.
+ */
+typedef struct stream stream;
+
+/*
+ * Checks whether a regular file starts with the magic bytes of a compression
+ * format, without moving its file offset.
+ *
+ * Parameters:
+ *   fd: The open file.
+ * Returns: 1 if the file is compressed, 0 if it is plain text.
+ */
+int compressed_file(int fd);
+
+/*
+ * Starts reading a file on a new decompression thread, which fills up to
+ * 'depth' chunks ahead of the reader.
+ *
+ * Parameters:
+ *   fd:     The open file, read from its current offset and closed by
+ *           close_stream unless it is standard input.
+ *   chunk:  The number of bytes in a full chunk.
+ *   prefix: The number of writable bytes before the data of every chunk,
+ *           so the reader can prepend the end of the previous chunk.
+ *   depth:  The number of chunks, at least 2.
+ * Returns: The stream, to be released with close_stream.
+ */
+stream *open_stream(int fd, size_t chunk, size_t prefix, int depth);
+
+/*
+ * Returns the name of the format of a stream, such as "xz".
+ *
+ * Parameters:
+ *   s: The stream.
+ */
+const char *stream_format(const stream *s);
+
+/*
+ * Waits for the next chunk of decompressed bytes. Every chunk is full except
+ * the last one.
+ *
+ * Parameters:
+ *   s:    The stream.
+ *   size: Where to store the number of bytes in the chunk.
+ * Returns: The data of the chunk, to be given back with stream_release, or
+ *          NULL at the end of the stream.
+ */
+unsigned char *stream_next(stream *s, size_t *size);
+
+/*
+ * Gives a chunk back to the decompression thread to be filled again.
+ *
+ * Parameters:
+ *   s:    The stream.
+ *   data: The data of the chunk, as returned by stream_next.
+ */
+void stream_release(stream *s, unsigned char *data);
+
+/*
+ * Waits for the decompression thread and frees the stream.
+ *
+ * Parameters:
+ *   s: The stream, read to its end.
+ */
+void close_stream(stream *s);
+
+#endif
@@ -1,20 +1,19 @@
 #ifndef STRUCTS_H
 #define STRUCTS_H
 
-/* Dimensions of the layout grid. */
-#define row 3
-#define col 12
-#define dim1 row * col
-#define dim2 dim1 * dim1
-#define dim3 dim2 * dim1
-#define dim4 dim3 * dim1
+/*
+ * Largest keyboard grid. The grid in use is ROW by COL, read at runtime from
+ * the keyboard file, see keyboard.c.
+ */
+#define MAX_ROW 8
+#define MAX_COL 16
 
 // ALL NAMES 60 CHARACTERS LONG FOR PRINTING IN 80 CHARACTER LINES
 
 /* Structure for a keyboard layout and its stats. */
 typedef struct layout {
     char name[61];
-    int matrix[row][col];
+    int matrix[MAX_ROW][MAX_COL];
     float *mono_score;
     float *bi_score;
     float *tri_score;
@@ -34,7 +33,8 @@ typedef struct layout_node {
 /* Structures to represent statistics based on ngrams. */
 typedef struct mono_stat {
     char name[61];
-    int ngrams[dim1];
+    /* flat indices of the 'length' ngrams in the stat */
+    int *ngrams;
     int length;
     float weight;
     int skip;
@@ -42,7 +42,8 @@ typedef struct mono_stat {
 
 typedef struct bi_stat {
     char name[61];
-    int ngrams[dim2];
+    /* flat indices of the 'length' ngrams in the stat */
+    int *ngrams;
     int length;
     float weight;
     int skip;
@@ -50,7 +51,8 @@ typedef struct bi_stat {
 
 typedef struct tri_stat {
     char name[61];
-    int ngrams[dim3];
+    /* flat indices of the 'length' ngrams in the stat */
+    int *ngrams;
     int length;
     float weight;
     int skip;
@@ -58,7 +60,8 @@ typedef struct tri_stat {
 
 typedef struct quad_stat {
     char name[61];
-    int ngrams[dim4];
+    /* flat indices of the 'length' ngrams in the stat */
+    int *ngrams;
     int length;
     float weight;
     int skip;
@@ -66,13 +69,35 @@ typedef struct quad_stat {
 
 typedef struct skip_stat {
     char name[61];
-    int ngrams[dim2];
+    /* flat indices of the 'length' ngrams in the stat */
+    int *ngrams;
     int length;
     /* multiple weights for skip-X-grams */
     float weight[10];
     int skip;
+    /* skip distances to evaluate, planned once the weights are read */
+    int distances[9];
+    int distance_count;
 } skip_stat;
 
+/*
+ * How the CPU analysis computes the stats of one ngram type. Most stats are
+ * gathered from the frequencies of their ngrams, but a stat that is the union
+ * of disjoint smaller stats is summed from their scores instead. Skipped
+ * stats may be gathered too, only to be summed into such a parent.
+ */
+typedef struct stat_plan {
+    /* 1 for every stat gathered from the frequencies of its ngrams */
+    char *gathered;
+    /* stats summed from the stats partitioning them, children first */
+    int *derived;
+    int derived_count;
+    /* the children of derived[d] are children[child_start[d]] up to
+       children[child_start[d + 1]] */
+    int *child_start;
+    int *children;
+} stat_plan;
+
 /*
  * Structure to represent a meta statistic which is based on
  * more than one kind of ngram, calculated through other stats
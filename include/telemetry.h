@@ -0,0 +1,46 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdatomic.h>
+
+/*
+ * Progress counters owned by a single annealing thread. Only the owning thread
+ * writes them (relaxed stores), the reporter thread only reads them, so the hot
+ * loop never takes a lock or prints. Aligned to a cache line so neighbouring
+ * threads do not false share.
+ */
+typedef struct thread_counters {
+    _Alignas(64) atomic_llong iterations;
+    atomic_llong accepts;
+    atomic_llong improvements;
+    _Atomic float best_score;
+} thread_counters;
+
+/*
+ * Allocates one set of counters per thread and starts the reporter thread,
+ * which samples them on a timer to print throughput and ETA, and optionally
+ * appends a time series to the file named by 'telemetry_name'.
+ *
+ * Parameters:
+ *   count: The number of annealing threads that will report.
+ *   total: The total number of iterations expected across all threads.
+ */
+void start_telemetry(int count, long long total);
+
+/*
+ * Returns the counters belonging to one annealing thread.
+ *
+ * Parameters:
+ *   thread_id: The index of the thread, 0 to count - 1.
+ */
+thread_counters *get_counters(int thread_id);
+
+/*
+ * Stops the reporter thread, prints the final progress line and closes the
+ * time series file.
+ *
+ * Returns: The total number of iterations reported by all threads.
+ */
+long long stop_telemetry();
+
+#endif
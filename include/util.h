@@ -120,9 +120,45 @@ size_t index_quad(int i, int j, int k, int l);
  */
 size_t index_skip(int skip_index, int j, int k);
 
+/*
+ * Allocates zeroed memory aligned to a cache line, so the flat frequency
+ * arrays can be processed with aligned vector loads.
+ * Parameters:
+ *   count: The number of elements.
+ *   size:  The size of each element.
+ * Returns: The allocated memory, to be released with free.
+ */
+void *aligned_calloc(size_t count, size_t size);
+
+/*
+ * Allocates the raw and normalized corpus arrays for the current language.
+ * Languages larger than DENSE_LANG_LENGTH get sparse tri, quad and skip
+ * tables, a dense quadgram array alone would take gigabytes.
+ */
+void alloc_corpus();
+
+/*
+ * Converts one flat table of counts to percentages of its total, in a single
+ * linear pass the compiler can vectorize.
+ * Parameters:
+ *   counts: The raw counts.
+ *   linear: Where to store the percentages.
+ *   size:   The number of entries.
+ */
+void normalize_table(const long long *counts, float *linear, size_t size);
+
 /* Normalizes the corpus data from raw frequencies to percentages. */
 void normalize_corpus();
 
+/* Zeroes the raw corpus counts, so another corpus can be counted into them. */
+void clear_corpus();
+
+/*
+ * Frees the raw corpus counts, only the normalized linear arrays are needed
+ * for scoring.
+ */
+void free_corpus();
+
 /*
  * Allocates memory for a new layout.
  * Parameters:
@@ -166,7 +202,8 @@ void create_node(layout *lt);
 void free_list();
 
 /*
- * Randomly shuffles the keys in a layout.
+ * Randomly shuffles the keys in a layout, leaving the gaps of the keyboard
+ * where they are.
  * Parameters:
  *   lt: Pointer to the layout to be shuffled.
  */
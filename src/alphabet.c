@@ -0,0 +1,263 @@
+/*
+ * alphabet.c - Character order of the frequency tables for the GULAG.
+ *
+ * The frequency tables are indexed by the order of the .lang file, padded to
+ * DENSE_LANG_LENGTH characters, so the few characters that carry most of the
+ * corpus are spread over the whole of every table. Once the corpus is
+ * normalized the characters are renumbered by frequency, the padding is cut
+ * off, and with --compact the characters no layout of the run holds are
+ * dropped, which shrinks the quadgram table with the fourth power of the
+ * alphabet. A language too large for dense tables becomes dense when few
+ * enough characters are left.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <dirent.h>
+
+#include "alphabet.h"
+#include "cache.h"
+#include "sparse.h"
+#include "io.h"
+#include "util.h"
+#include "global.h"
+#include "structs.h"
+
+#define UNICODE_MAX 65535
+
+/*
+ * Orders two characters by monogram frequency, the most frequent first and
+ * the earlier in the language on ties.
+ */
+static int by_frequency(const void *a, const void *b)
+{
+    int i = *(const int *)a;
+    int j = *(const int *)b;
+    if (linear_mono[i] != linear_mono[j]) {return linear_mono[i] < linear_mono[j] ? 1 : -1;}
+    return i - j;
+}
+
+/*
+ * Marks the characters of a layout file as used.
+ * Parameters:
+ *   name: The layout name, without the .glg extension.
+ *   used: One flag per character index.
+ */
+static void mark_layout(const char *name, char *used)
+{
+    /* only the matrix of the layout is filled */
+    layout lt;
+    read_named_layout(&lt, name); /* io.c */
+    for (int i = 0; i < ROW; i++) {
+        for (int j = 0; j < COL; j++) {
+            if (lt.matrix[i][j] > 0) {used[lt.matrix[i][j]] = 1;}
+        }
+    }
+}
+
+/*
+ * Marks the characters of every layout the run reads: all layouts of the
+ * language when ranking, both layouts when comparing, the first otherwise.
+ * Parameters:
+ *   used: One flag per character index.
+ */
+static void mark_used(char *used)
+{
+    if (run_mode != 'r') {
+        mark_layout(layout_name, used);
+        if (run_mode == 'c') {mark_layout(layout2_name, used);}
+        return;
+    }
+
+    char *path = (char*)malloc(strlen("./data//layouts") + strlen(lang_name) + 1);
+    if (path == NULL) {error("failed to malloc layouts path");}
+    sprintf(path, "./data/%s/layouts", lang_name);
+    DIR *dir = opendir(path);
+    free(path);
+    if (dir == NULL) {error("Error opening layouts directory");}
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strstr(entry->d_name, ".glg") == NULL) {continue;}
+        /* the name the same way rank() takes it */
+        char name[61];
+        int len = strlen(entry->d_name) - 4;
+        if (len > 60) {len = 60;}
+        strncpy(name, entry->d_name, len);
+        name[len] = '\0';
+        mark_layout(name, used);
+    }
+    closedir(dir);
+}
+
+/*
+ * Copies a dense table into the new character order.
+ * Parameters:
+ *   old:    The table in the old order.
+ *   table:  The table in the new order, 'blocks' * count^keys entries.
+ *   keys:   The number of characters of an entry.
+ *   blocks: The number of tables of 'keys' characters, one per skip distance.
+ *   order:  The old index of every new index.
+ *   count:  The new number of characters.
+ *   length: The old number of characters.
+ */
+static void remap_table(const float *old, float *table, int keys, int blocks,
+    const int *order, size_t count, size_t length)
+{
+    size_t size = blocks;
+    for (int k = 0; k < keys; k++) {size *= count;}
+    for (size_t t = 0; t < size; t++) {
+        size_t rest = t;
+        size_t index = 0;
+        size_t scale = 1;
+        for (int k = 0; k < keys; k++) {
+            index += order[rest % count] * scale;
+            rest /= count;
+            scale *= length;
+        }
+        /* what is left is the block */
+        table[t] = old[index + rest * scale];
+    }
+}
+
+/*
+ * Copies a sparse table into the new character order, into a dense table if
+ * the new alphabet is small enough, a new sparse table otherwise. Entries
+ * holding a dropped character are left out.
+ * Parameters:
+ *   old:    The sparse table in the old order.
+ *   keys:   The number of characters of an entry.
+ *   map:    The new index of every old index, -1 for dropped characters.
+ *   count:  The new number of characters.
+ *   length: The old number of characters.
+ *   dense:  The dense table to fill, or NULL.
+ *   sparse: The sparse table to fill when 'dense' is NULL.
+ */
+static void remap_sparse(const sparse_table *old, int keys, const int *map,
+    size_t count, size_t length, float *dense, sparse_table *sparse)
+{
+    for (size_t slot = 0; slot <= old->mask; slot++) {
+        if (old->keys[slot] == 0) {continue;}
+        uint64_t rest = old->keys[slot] - 1;
+        uint64_t index = 0;
+        uint64_t scale = 1;
+        int dropped = 0;
+        for (int k = 0; k < keys && !dropped; k++) {
+            int c = map[rest % length];
+            rest /= length;
+            dropped = c < 0;
+            index += (uint64_t)c * scale;
+            scale *= count;
+        }
+        if (dropped) {continue;}
+        index += rest * scale;
+        if (dense != NULL) {dense[index] = old->values[slot];}
+        else {sparse_add_value(sparse, index, old->values[slot]);} /* sparse.c */
+    }
+}
+
+/*
+ * Renumbers the characters of the language by corpus frequency, the most
+ * frequent first, so the hot rows of every frequency table are adjacent, and
+ * shrinks LANG_LENGTH to the characters of the language. With --compact the
+ * characters absent from every layout of the run are dropped as well. The
+ * frequency tables, 'lang_arr' and 'char_table' are rebuilt in the new order,
+ * so layouts read afterwards use it. Must run after the corpus is normalized
+ * and before any cache is written or the tables are used.
+ */
+void remap_alphabet()
+{
+    size_t length = LANG_LENGTH;
+    /* help and info read no layout */
+    int drop = compact && run_mode != 'h' && run_mode != 'f';
+    char *used = (char *)calloc(length, sizeof(char));
+    int *order = (int *)malloc(length * sizeof(int));
+    int *map = (int *)malloc(length * sizeof(int));
+    if (used == NULL || order == NULL || map == NULL) {error("failed to malloc alphabet map");}
+    if (drop) {mark_used(used);}
+
+    /* index 0 stays the invalid character, padding is cut off */
+    size_t count = 0;
+    for (size_t i = 1; i < length; i++) {
+        if (lang_arr[2 * i] == L'@' || (drop && !used[i])) {continue;}
+        order[count++] = i;
+    }
+    qsort(order, count, sizeof(int), by_frequency);
+    memmove(order + 1, order, count * sizeof(int));
+    order[0] = 0;
+    count++;
+    for (size_t i = 0; i < length; i++) {map[i] = -1;}
+    for (size_t n = 0; n < count; n++) {map[order[n]] = n;}
+    log_print('v',L"%d of %d characters kept... ", (int)count - 1, (int)length - 1);
+
+    float *mono = (float *)aligned_calloc(count, sizeof(float)); /* util.c */
+    float *bi = (float *)aligned_calloc(count * count, sizeof(float)); /* util.c */
+    remap_table(linear_mono, mono, 1, 1, order, count, length);
+    remap_table(linear_bi, bi, 2, 1, order, count, length);
+
+    float *tri = NULL, *quad = NULL, *skip = NULL;
+    sparse_table *new_tri = NULL, *new_quad = NULL, *new_skip = NULL;
+    int dense = count <= (size_t)DENSE_LANG_LENGTH;
+    if (dense) {
+        tri = (float *)aligned_calloc(count * count * count, sizeof(float)); /* util.c */
+        quad = (float *)aligned_calloc(count * count * count * count, sizeof(float)); /* util.c */
+        skip = (float *)aligned_calloc(10 * count * count, sizeof(float)); /* util.c */
+    }
+    if (sparse_quad != NULL) {
+        if (!dense) {
+            /* values only, like a table read from the cache */
+            new_tri = create_sparse(sparse_tri->used); /* sparse.c */
+            new_quad = create_sparse(sparse_quad->used); /* sparse.c */
+            new_skip = create_sparse(sparse_skip->used); /* sparse.c */
+            free_sparse_counts(new_tri); /* sparse.c */
+            free_sparse_counts(new_quad); /* sparse.c */
+            free_sparse_counts(new_skip); /* sparse.c */
+        }
+        remap_sparse(sparse_tri, 3, map, count, length, tri, new_tri);
+        remap_sparse(sparse_quad, 4, map, count, length, quad, new_quad);
+        remap_sparse(sparse_skip, 2, map, count, length, skip, new_skip);
+    } else {
+        remap_table(linear_tri, tri, 3, 1, order, count, length);
+        remap_table(linear_quad, quad, 4, 1, order, count, length);
+        remap_table(linear_skip, skip, 2, 10, order, count, length);
+    }
+
+    /* mapped tables are dropped with the mapping, the rest are freed */
+    release_linear_cache(); /* cache.c */
+    free(linear_mono);
+    free(linear_bi);
+    free(linear_tri);
+    free(linear_quad);
+    free(linear_skip);
+    free_sparse(sparse_tri); /* sparse.c */
+    free_sparse(sparse_quad); /* sparse.c */
+    free_sparse(sparse_skip); /* sparse.c */
+    linear_mono = mono;
+    linear_bi = bi;
+    linear_tri = tri;
+    linear_quad = quad;
+    linear_skip = skip;
+    sparse_tri = new_tri;
+    sparse_quad = new_quad;
+    sparse_skip = new_skip;
+
+    /* the characters and their lookup follow the tables */
+    wchar_t *old_lang = (wchar_t *)malloc((LANG_FILE_LENGTH + 1) * sizeof(wchar_t));
+    if (old_lang == NULL) {error("failed to malloc alphabet map");}
+    memcpy(old_lang, lang_arr, (LANG_FILE_LENGTH + 1) * sizeof(wchar_t));
+    for (int i = 2; i < LANG_FILE_LENGTH + 1; i++) {lang_arr[i] = L'@';}
+    for (size_t n = 1; n < count; n++) {
+        lang_arr[2 * n] = old_lang[2 * order[n]];
+        lang_arr[2 * n + 1] = old_lang[2 * order[n] + 1];
+    }
+    free(old_lang);
+    for (int c = 0; c <= UNICODE_MAX; c++) {
+        if (char_table[c] > 0) {char_table[c] = map[char_table[c]] > 0 ? map[char_table[c]] : 0;}
+    }
+
+    LANG_LENGTH = count;
+    free(used);
+    free(order);
+    free(map);
+}
@@ -9,6 +9,111 @@
 #include "structs.h"
 #include "util.h"
 #include "meta.h"
+#include "scorer.h"
+#include "gather.h"
+
+/*
+ * Looks up a normalized frequency in a dense linear array, or in the sparse
+ * table replacing it for large languages.
+ * Parameters:
+ *   dense:  The linear array.
+ *   sparse: The sparse table, NULL if the array is dense.
+ *   index:  The flat index of the ngram.
+ * Returns: The frequency of the ngram.
+ */
+static inline float frequency(const float *dense, const sparse_table *sparse, size_t index)
+{
+    return sparse != NULL ? sparse_value(sparse, index) : dense[index]; /* sparse.h */
+}
+
+/*
+ * Sums the stats planned as the union of disjoint stats from the scores of
+ * their children, which are computed first.
+ * Parameters:
+ *   plan:   The plan of one ngram type.
+ *   scores: The scores of that type, the derived ones are overwritten.
+ */
+static inline void sum_partitions(const stat_plan *plan, float *scores)
+{
+    for (int d = 0; d < plan->derived_count; d++)
+    {
+        float sum = 0;
+        for (int c = plan->child_start[d]; c < plan->child_start[d + 1]; c++) {sum += scores[plan->children[c]];}
+        scores[plan->derived[d]] = sum;
+    }
+}
+
+/*
+ * Completes the analysis of a layout whose gathered stats are scored: sums
+ * the stats planned as unions of disjoint stats, then the meta statistics.
+ *
+ * Parameters:
+ *   lt: A pointer to the layout.
+ */
+static void combine_stats(layout *lt)
+{
+    sum_partitions(&plan_mono, lt->mono_score);
+    sum_partitions(&plan_bi, lt->bi_score);
+    sum_partitions(&plan_tri, lt->tri_score);
+    sum_partitions(&plan_quad, lt->quad_score);
+
+    /* Perform meta-analysis, which may depend on previously calculated statistics. */
+    for (int i = 0; i < META_LENGTH; i++)
+    {
+        if (!stats_meta[i].skip)
+        {
+            lt->meta_score[i] = 0;
+            int j = 0;
+            while (stats_meta[i].stat_types[j] != 'x')
+            {
+                switch(stats_meta[i].stat_types[j]) {
+                default:
+                case 'm':
+                    lt->meta_score[i] += lt->mono_score[stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
+                    break;
+                case 'b':
+                    lt->meta_score[i] += lt->bi_score[stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
+                    break;
+                case 't':
+                    lt->meta_score[i] += lt->tri_score[stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
+                    break;
+                case 'q':
+                    lt->meta_score[i] += lt->quad_score[stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
+                    break;
+                case '1':
+                    lt->meta_score[i] += lt->skip_score[1][stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
+                    break;
+                case '2':
+                    lt->meta_score[i] += lt->skip_score[2][stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
+                    break;
+                case '3':
+                    lt->meta_score[i] += lt->skip_score[3][stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
+                    break;
+                case '4':
+                    lt->meta_score[i] += lt->skip_score[4][stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
+                    break;
+                case '5':
+                    lt->meta_score[i] += lt->skip_score[5][stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
+                    break;
+                case '6':
+                    lt->meta_score[i] += lt->skip_score[6][stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
+                    break;
+                case '7':
+                    lt->meta_score[i] += lt->skip_score[7][stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
+                    break;
+                case '8':
+                    lt->meta_score[i] += lt->skip_score[8][stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
+                    break;
+                case '9':
+                    lt->meta_score[i] += lt->skip_score[9][stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
+                    break;
+                }
+                j++;
+            }
+            if (stats_meta[i].absv && lt->meta_score[i] < 0) {lt->meta_score[i] *= -1;}
+        }
+    }
+}
 
 /*
  * Performs analysis on a single layout, calculating statistics for monograms,
@@ -20,54 +125,47 @@
  */
 void single_analyze(layout *lt)
 {
+    /* the same stats, from a scorer compiled for this configuration */
+    if (specialized_scorer != NULL)
+    {
+        specialized_scorer(&lt->matrix[0][0], lt->mono_score, lt->bi_score, lt->tri_score,
+            lt->quad_score, lt->skip_score, lt->meta_score); /* scorer.c */
+        return;
+    }
+
     int row0, col0, row1, col1, row2, col2, row3, col3;
 
+    const int *matrix = &lt->matrix[0][0];
+    /* every table but the skipgrams' is read from its start */
+    const int no_base = 0;
+
     /* Calculate monogram statistics. */
     for (int i = 0; i < MONO_LENGTH; i++)
     {
-        if(!stats_mono[i].skip)
+        if (plan_mono.gathered[i])
         {
-            lt->mono_score[i] = 0;
-            int length = stats_mono[i].length;
-            for (int j = 0; j < length; j++)
-            {
-                /* unflattens a 1D index into a 2D matrix coordinate */
-                unflat_mono(stats_mono[i].ngrams[j], &row0, &col0); /* util.c */
-                if (lt->matrix[row0][col0] != -1)
-                {
-                    /* calculates the index for a monogram in a linearized array */
-                    size_t index = index_mono(lt->matrix[row0][col0]); /* util.c */
-                    lt->mono_score[i] += linear_mono[index];
-                }
-            }
+            /* sums the frequencies of the ngrams on the decoded keys */
+            gather_sums(&gather_mono[i], matrix, linear_mono, &no_base, 1, &lt->mono_score[i]); /* gather.c */
         }
     }
 
     /* Calculate bigram statistics. */
     for (int i = 0; i < BI_LENGTH; i++)
     {
-        if(!stats_bi[i].skip)
+        if (plan_bi.gathered[i])
         {
-            lt->bi_score[i] = 0;
-            int length = stats_bi[i].length;
-            for (int j = 0; j < length; j++)
-            {
-                /* unflattens a 1D index into a 4D matrix coordinate */
-                unflat_bi(stats_bi[i].ngrams[j], &row0, &col0, &row1, &col1); /* util.c */
-                if (lt->matrix[row0][col0] != -1 && lt->matrix[row1][col1] != -1)
-                {
-                    /* calculates the index for a bigram in a linearized array */
-                    size_t index = index_bi(lt->matrix[row0][col0], lt->matrix[row1][col1]); /* util.c */
-                    lt->bi_score[i] += linear_bi[index];
-                }
-            }
+            gather_sums(&gather_bi[i], matrix, linear_bi, &no_base, 1, &lt->bi_score[i]); /* gather.c */
         }
     }
 
     /* Calculate trigram statistics. */
     for (int i = 0; i < TRI_LENGTH; i++)
     {
-        if(!stats_tri[i].skip)
+        if (plan_tri.gathered[i] && sparse_tri == NULL)
+        {
+            gather_sums(&gather_tri[i], matrix, linear_tri, &no_base, 1, &lt->tri_score[i]); /* gather.c */
+        }
+        else if (plan_tri.gathered[i])
         {
             lt->tri_score[i] = 0;
             int length = stats_tri[i].length;
@@ -79,7 +177,7 @@ void single_analyze(layout *lt)
                 {
                     /* calculates the index for a trigram in a linearized array */
                     size_t index = index_tri(lt->matrix[row0][col0], lt->matrix[row1][col1], lt->matrix[row2][col2]); /* util.c */
-                    lt->tri_score[i] += linear_tri[index];
+                    lt->tri_score[i] += frequency(linear_tri, sparse_tri, index);
                 }
             }
         }
@@ -88,7 +186,11 @@ void single_analyze(layout *lt)
     /* Calculate quadgram statistics. */
     for (int i = 0; i < QUAD_LENGTH; i++)
     {
-        if(!stats_quad[i].skip)
+        if (plan_quad.gathered[i] && sparse_quad == NULL)
+        {
+            gather_sums(&gather_quad[i], matrix, linear_quad, &no_base, 1, &lt->quad_score[i]); /* gather.c */
+        }
+        else if (plan_quad.gathered[i])
         {
             lt->quad_score[i] = 0;
             int length = stats_quad[i].length;
@@ -100,7 +202,7 @@ void single_analyze(layout *lt)
                 {
                     /* calculates the index for a quadgram in a linearized array */
                     size_t index = index_quad(lt->matrix[row0][col0], lt->matrix[row1][col1], lt->matrix[row2][col2], lt->matrix[row3][col3]); /* util.c */
-                    lt->quad_score[i] += linear_quad[index];
+                    lt->quad_score[i] += frequency(linear_quad, sparse_quad, index);
                 }
             }
         }
@@ -109,11 +211,22 @@ void single_analyze(layout *lt)
     /* Calculate skipgram statistics. */
     for (int i = 0; i < SKIP_LENGTH; i++)
     {
-        if(!stats_skip[i].skip)
+        if (!stats_skip[i].skip && sparse_skip == NULL)
+        {
+            /* the distances share one pass over the ngrams */
+            int bases[9];
+            float sums[9];
+            for (int d = 0; d < stats_skip[i].distance_count; d++) {bases[d] = index_skip(stats_skip[i].distances[d], 0, 0);} /* util.c */
+            gather_sums(&gather_skip[i], matrix, linear_skip, bases, stats_skip[i].distance_count, sums); /* gather.c */
+            for (int d = 0; d < stats_skip[i].distance_count; d++) {lt->skip_score[stats_skip[i].distances[d]][i] = sums[d];}
+        }
+        else if (!stats_skip[i].skip)
         {
             int length = stats_skip[i].length;
-            for (int k = 1; k <= 9; k++)
+            /* only the distances the score or a meta stat needs */
+            for (int d = 0; d < stats_skip[i].distance_count; d++)
             {
+                int k = stats_skip[i].distances[d];
                 lt->skip_score[k][i] = 0;
                 for (int j = 0; j < length; j++)
                 {
@@ -123,67 +236,91 @@ void single_analyze(layout *lt)
                     {
                         /* calculates the index for a skipgram in a linearized array */
                         size_t index = index_skip(k, lt->matrix[row0][col0], lt->matrix[row1][col1]); /* util.c */
-                        lt->skip_score[k][i] += linear_skip[index];
+                        lt->skip_score[k][i] += frequency(linear_skip, sparse_skip, index);
                     }
                 }
             }
         }
     }
 
-    /* Perform meta-analysis, which may depend on previously calculated statistics. */
-    for (int i = 0; i < META_LENGTH; i++)
+    /* Sum the partitioned stats, then perform meta-analysis. */
+    combine_stats(lt);
+}
+
+/*
+ * Performs analysis on many layouts, with the same results single_analyze
+ * gives for each. With a batch kernel the layouts are interleaved in groups
+ * of batch_lanes, one per vector lane, so every ngram of a stat is decoded
+ * once per group instead of once per layout.
+ *
+ * Parameters:
+ *   lts:   The layouts to analyze.
+ *   count: The number of layouts.
+ */
+void batch_analyze(layout **lts, int count)
+{
+    /* a compiled scorer or sparse tables score one layout at a time */
+    if (batch_sums == NULL || specialized_scorer != NULL || sparse_quad != NULL)
     {
-        if (!stats_meta[i].skip)
+        for (int i = 0; i < count; i++) {single_analyze(lts[i]);}
+        return;
+    }
+
+    const int lanes = batch_lanes;
+    const int positions = MAX_ROW * MAX_COL;
+    const int no_base = 0;
+    int soa[MAX_ROW * MAX_COL * BATCH_MAX] __attribute__((aligned(64)));
+    float sums[9 * BATCH_MAX];
+    int bases[9];
+
+    for (int start = 0; start < count; start += lanes)
+    {
+        int used = count - start < lanes ? count - start : lanes;
+        layout **batch = lts + start;
+
+        /* interleave the layouts, unused lanes are all empty keys */
+        for (int p = 0; p < positions; p++)
         {
-            lt->meta_score[i] = 0;
-            int j = 0;
-            while (stats_meta[i].stat_types[j] != 'x')
+            for (int l = 0; l < lanes; l++) {soa[p * lanes + l] = l < used ? (&batch[l]->matrix[0][0])[p] : -1;}
+        }
+
+        for (int i = 0; i < MONO_LENGTH; i++)
+        {
+            if (!plan_mono.gathered[i]) {continue;}
+            batch_sums(&gather_mono[i], soa, linear_mono, &no_base, 1, sums); /* gather.c */
+            for (int l = 0; l < used; l++) {batch[l]->mono_score[i] = sums[l];}
+        }
+        for (int i = 0; i < BI_LENGTH; i++)
+        {
+            if (!plan_bi.gathered[i]) {continue;}
+            batch_sums(&gather_bi[i], soa, linear_bi, &no_base, 1, sums); /* gather.c */
+            for (int l = 0; l < used; l++) {batch[l]->bi_score[i] = sums[l];}
+        }
+        for (int i = 0; i < TRI_LENGTH; i++)
+        {
+            if (!plan_tri.gathered[i]) {continue;}
+            batch_sums(&gather_tri[i], soa, linear_tri, &no_base, 1, sums); /* gather.c */
+            for (int l = 0; l < used; l++) {batch[l]->tri_score[i] = sums[l];}
+        }
+        for (int i = 0; i < QUAD_LENGTH; i++)
+        {
+            if (!plan_quad.gathered[i]) {continue;}
+            batch_sums(&gather_quad[i], soa, linear_quad, &no_base, 1, sums); /* gather.c */
+            for (int l = 0; l < used; l++) {batch[l]->quad_score[i] = sums[l];}
+        }
+        for (int i = 0; i < SKIP_LENGTH; i++)
+        {
+            if (stats_skip[i].skip) {continue;}
+            int distances = stats_skip[i].distance_count;
+            for (int d = 0; d < distances; d++) {bases[d] = index_skip(stats_skip[i].distances[d], 0, 0);} /* util.c */
+            batch_sums(&gather_skip[i], soa, linear_skip, bases, distances, sums); /* gather.c */
+            for (int d = 0; d < distances; d++)
             {
-                switch(stats_meta[i].stat_types[j]) {
-                default:
-                case 'm':
-                    lt->meta_score[i] += lt->mono_score[stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
-                    break;
-                case 'b':
-                    lt->meta_score[i] += lt->bi_score[stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
-                    break;
-                case 't':
-                    lt->meta_score[i] += lt->tri_score[stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
-                    break;
-                case 'q':
-                    lt->meta_score[i] += lt->quad_score[stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
-                    break;
-                case '1':
-                    lt->meta_score[i] += lt->skip_score[1][stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
-                    break;
-                case '2':
-                    lt->meta_score[i] += lt->skip_score[2][stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
-                    break;
-                case '3':
-                    lt->meta_score[i] += lt->skip_score[3][stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
-                    break;
-                case '4':
-                    lt->meta_score[i] += lt->skip_score[4][stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
-                    break;
-                case '5':
-                    lt->meta_score[i] += lt->skip_score[5][stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
-                    break;
-                case '6':
-                    lt->meta_score[i] += lt->skip_score[6][stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
-                    break;
-                case '7':
-                    lt->meta_score[i] += lt->skip_score[7][stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
-                    break;
-                case '8':
-                    lt->meta_score[i] += lt->skip_score[8][stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
-                    break;
-                case '9':
-                    lt->meta_score[i] += lt->skip_score[9][stats_meta[i].stat_indices[j]] * stats_meta[i].stat_weights[j];
-                    break;
-                }
-                j++;
+                int k = stats_skip[i].distances[d];
+                for (int l = 0; l < used; l++) {batch[l]->skip_score[k][i] = sums[d * lanes + l];}
             }
-            if (stats_meta[i].absv && lt->meta_score[i] < 0) {lt->meta_score[i] *= -1;}
         }
+
+        for (int l = 0; l < used; l++) {combine_stats(batch[l]);}
     }
 }
@@ -0,0 +1,326 @@
+/*
+ * blend.c - Weighted blends of corpora for the GULAG.
+ *
+ * A blend such as 'prose:0.7,code:0.2,chat:0.1' mixes the normalized
+ * frequencies of several corpora with the given weights, scaled to sum to 1,
+ * so the result is again a set of percentages. Each corpus is read from its
+ * own binary cache into private tables, and the blended tables are cached
+ * under a key derived from the weights and the counts of every corpus. Only
+ * the most recently used blend caches of a language are kept.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/stat.h>
+
+#include "blend.h"
+#include "cache.h"
+#include "pool.h"
+#include "io.h"
+#include "util.h"
+#include "global.h"
+
+/* The most blend caches kept per language, the least recently used are removed. */
+#define BLEND_LIMIT 4
+
+/* One corpus of the blend. */
+typedef struct blend_part {
+    char *name;
+    float weight;
+    /* identifies the counts in the corpus cache */
+    uint64_t stamp;
+    linear_tables tables;
+    int loaded;
+} blend_part;
+
+/* The parts of the blend and one table kind being blended into the globals. */
+typedef struct blend_task {
+    blend_part *parts;
+    int count;
+    char kind;
+} blend_task;
+
+/*
+ * Checks whether the selected corpus is a blend of several corpora, given as
+ * 'name:weight,name:weight,...'.
+ */
+int is_blend()
+{
+    return strchr(corpus_name, ':') != NULL || strchr(corpus_name, ',') != NULL;
+}
+
+/*
+ * Orders the parts of a blend by name, so the same blend written in another
+ * order shares its key and its sums.
+ */
+static int compare_parts(const void *a, const void *b)
+{
+    return strcmp(((const blend_part *)a)->name, ((const blend_part *)b)->name);
+}
+
+/*
+ * Splits the corpus selection into the parts of the blend.
+ * Parameters:
+ *   count: Where to store the number of parts.
+ * Returns: The allocated parts, sorted by name, weights summing to 1.
+ */
+static blend_part *parse_blend(int *count)
+{
+    char *spec = strdup(corpus_name);
+    int capacity = 1;
+    for (char *c = spec; *c; c++) {capacity += *c == ',';}
+    blend_part *parts = (blend_part *)calloc(capacity, sizeof(blend_part));
+    if (spec == NULL || parts == NULL) {error("failed to allocate corpus blend");}
+
+    *count = 0;
+    char *save = NULL;
+    for (char *item = strtok_r(spec, ",", &save); item != NULL; item = strtok_r(NULL, ",", &save)) {
+        /* a corpus without a weight counts once */
+        float weight = 1;
+        char *colon = strchr(item, ':');
+        if (colon != NULL) {
+            char *end;
+            *colon = '\0';
+            weight = strtof(colon + 1, &end);
+            if (end == colon + 1 || *end != '\0') {error("Corpus blend weight is not a number.");}
+        }
+        if (*item == '\0') {error("Corpus blend contains an empty corpus name.");}
+        if (strcmp(item, "-") == 0) {error("Standard input cannot be blended.");}
+        if (!(weight > 0) || isinf(weight)) {error("Corpus blend weights must be positive.");}
+        parts[*count].name = strdup(item);
+        parts[*count].weight = weight;
+        (*count)++;
+    }
+    free(spec);
+    if (*count == 0) {error("Corpus blend contains no corpus.");}
+
+    /* summed in name order, so a reordered blend scales to the same weights */
+    qsort(parts, *count, sizeof(blend_part), compare_parts);
+    float sum = 0;
+    for (int i = 0; i < *count; i++) {
+        if (i > 0 && strcmp(parts[i].name, parts[i - 1].name) == 0) {error("Corpus blend lists a corpus twice.");}
+        sum += parts[i].weight;
+    }
+    for (int i = 0; i < *count; i++) {parts[i].weight /= sum;}
+    return parts;
+}
+
+/*
+ * Counts a corpus without a valid cache and caches it, through the same
+ * steps as a single corpus, using the global count arrays.
+ * Parameters:
+ *   name: The name of the corpus.
+ */
+static void build_part(const char *name)
+{
+    char *selected = corpus_name;
+    corpus_name = (char *)name;
+    clear_sources(); /* cache.c */
+    clear_corpus(); /* util.c */
+    log_print('n',L"Caching %s... ", name);
+    if (!read_corpus_cache()) { /* io.c */
+        read_corpus(); /* io.c */
+        cache_corpus(); /* io.c */
+    }
+    corpus_name = selected;
+}
+
+/*
+ * Pool task that reads one corpus of the blend into its own tables.
+ * Parameters:
+ *   arg: A pointer to a blend_part.
+ */
+static void load_part(void *arg)
+{
+    blend_part *part = (blend_part *)arg;
+    part->loaded = read_cache_linear(part->name, &part->tables); /* cache.c */
+}
+
+/*
+ * Adds one weighted dense table to another.
+ * Parameters:
+ *   total:  The blended table.
+ *   linear: The table of one corpus.
+ *   weight: The weight of the corpus.
+ *   size:   The number of entries.
+ */
+static void add_weighted(float *total, const float *linear, float weight, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {total[i] += weight * linear[i];}
+}
+
+/*
+ * Adds one weighted sparse table to another.
+ * Parameters:
+ *   total:  The blended table.
+ *   sparse: The table of one corpus.
+ *   weight: The weight of the corpus.
+ */
+static void add_weighted_sparse(sparse_table *total, const sparse_table *sparse, float weight)
+{
+    for (size_t i = 0; sparse->values != NULL && i <= sparse->mask; i++) {
+        if (sparse->keys[i] != 0) {sparse_add_value(total, sparse->keys[i] - 1, weight * sparse->values[i]);} /* sparse.c */
+    }
+}
+
+/*
+ * Pool task that blends one kind of table of every part into the global
+ * linear arrays. Tasks write different tables.
+ * Parameters:
+ *   arg: A pointer to a blend_task.
+ */
+static void blend_kind(void *arg)
+{
+    blend_task *task = (blend_task *)arg;
+    size_t l = LANG_LENGTH;
+    for (int p = 0; p < task->count; p++) {
+        linear_tables *tables = &task->parts[p].tables;
+        float weight = task->parts[p].weight;
+        switch (task->kind) {
+            case 'm': add_weighted(linear_mono, tables->mono, weight, l); break;
+            case 'b': add_weighted(linear_bi, tables->bi, weight, l * l); break;
+            case 't':
+                if (sparse_tri != NULL) {add_weighted_sparse(sparse_tri, tables->sparse_tri, weight);}
+                else {add_weighted(linear_tri, tables->tri, weight, l * l * l);}
+                break;
+            case 'q':
+                if (sparse_quad != NULL) {add_weighted_sparse(sparse_quad, tables->sparse_quad, weight);}
+                else {add_weighted(linear_quad, tables->quad, weight, l * l * l * l);}
+                break;
+            default:
+                if (sparse_skip != NULL) {add_weighted_sparse(sparse_skip, tables->sparse_skip, weight);}
+                else {add_weighted(linear_skip, tables->skip, weight, 10 * l * l);}
+                break;
+        }
+    }
+}
+
+/* One blend cache while the corpora directory is pruned. */
+typedef struct blend_file {
+    char name[32];
+    struct timespec used;
+} blend_file;
+
+/*
+ * Orders blend caches by last use, the most recent first, for qsort.
+ */
+static int compare_used(const void *a, const void *b)
+{
+    const blend_file *x = (const blend_file *)a, *y = (const blend_file *)b;
+    if (x->used.tv_sec != y->used.tv_sec) {return x->used.tv_sec < y->used.tv_sec ? 1 : -1;}
+    if (x->used.tv_nsec != y->used.tv_nsec) {return x->used.tv_nsec < y->used.tv_nsec ? 1 : -1;}
+    return strcmp(x->name, y->name);
+}
+
+/*
+ * Removes the least recently used blend caches of the language beyond
+ * BLEND_LIMIT. A blend cache's modification time is its last use, it is
+ * touched whenever it is read.
+ * Parameters:
+ *   keep: The file name of the blend in use, never removed.
+ */
+static void prune_blends(const char *keep)
+{
+    char *path = corpora_path("", ""); /* cache.c */
+    DIR *dir = opendir(path);
+    if (dir == NULL) {free(path); return;}
+    int count = 0, capacity = BLEND_LIMIT + 1;
+    blend_file *files = (blend_file *)malloc(sizeof(blend_file) * capacity);
+    if (files == NULL) {error("failed to malloc blend list");}
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        /* blend-<16 hex digits>.glinear */
+        if (strlen(entry->d_name) != 30 || strncmp(entry->d_name, "blend-", 6) != 0
+            || strspn(entry->d_name + 6, "0123456789abcdef") != 16
+            || strcmp(entry->d_name + 22, ".glinear") != 0 || strcmp(entry->d_name, keep) == 0) {continue;}
+        char *file = corpora_path(entry->d_name, ""); /* cache.c */
+        struct stat info;
+        int found = stat(file, &info) == 0;
+        free(file);
+        if (!found) {continue;}
+        if (count == capacity) {
+            capacity *= 2;
+            files = (blend_file *)realloc(files, sizeof(blend_file) * capacity);
+            if (files == NULL) {error("failed to realloc blend list");}
+        }
+        strcpy(files[count].name, entry->d_name);
+        files[count].used = info.st_mtim;
+        count++;
+    }
+    closedir(dir);
+    free(path);
+
+    qsort(files, count, sizeof(blend_file), compare_used);
+    /* the blend in use takes one of the places */
+    for (int i = BLEND_LIMIT - 1; i < count; i++) {
+        char *file = corpora_path(files[i].name, ""); /* cache.c */
+        remove(file);
+        free(file);
+    }
+    free(files);
+}
+
+/*
+ * Fills the global linear arrays with a weighted blend of the normalized
+ * frequencies of several corpora. Corpora without a valid cache are counted
+ * and cached first, then every cache is read in parallel on the worker pool.
+ * The blend is cached under a key derived from the weights and the counts of
+ * each corpus, so repeating it only reads that cache. Only the BLEND_LIMIT
+ * most recently used blend caches of the language are kept.
+ */
+void read_blend()
+{
+    int count;
+    blend_part *parts = parse_blend(&count);
+
+    /* every corpus needs a valid cache, both for the key and to be read */
+    uint64_t key = lang_hash(); /* cache.c */
+    for (int i = 0; i < count; i++) {
+        if (!cache_stamp(parts[i].name, &parts[i].stamp)) { /* cache.c */
+            build_part(parts[i].name);
+            if (!cache_stamp(parts[i].name, &parts[i].stamp)) {error("Corpus cache failed to be read back.");} /* cache.c */
+        }
+        uint32_t weight;
+        memcpy(&weight, &parts[i].weight, sizeof(weight));
+        key = (key ^ parts[i].stamp) * 1099511628211ULL;
+        key = (key ^ weight) * 1099511628211ULL;
+    }
+
+    char name[32];
+    sprintf(name, "blend-%016llx", (unsigned long long)key);
+    char *path = corpora_path(name, ".glinear"); /* cache.c */
+    if (read_linear_cache(path, key)) { /* cache.c */
+        log_print('v',L"Blend cache found... ");
+        /* mark it used, so pruning keeps it */
+        utime(path, NULL);
+    } else {
+        log_print('v',L"Reading %d corpora... ", count);
+        for (int i = 0; i < count; i++) {pool_submit(load_part, &parts[i]);} /* pool.c */
+        pool_wait(); /* pool.c */
+        for (int i = 0; i < count; i++) {
+            if (!parts[i].loaded) {error("Corpus cache changed while the blend was read.");}
+        }
+
+        log_print('v',L"Blending... ");
+        blend_task tasks[5] = {{parts, count, 'm'}, {parts, count, 'b'}, {parts, count, 't'},
+            {parts, count, 'q'}, {parts, count, 's'}};
+        for (int t = 0; t < 5; t++) {pool_submit(blend_kind, &tasks[t]);} /* pool.c */
+        pool_wait(); /* pool.c */
+
+        log_print('v',L"Caching blend... ");
+        write_linear_cache(path, key); /* cache.c */
+        strcat(name, ".glinear");
+        prune_blends(name);
+    }
+    free(path);
+
+    for (int i = 0; i < count; i++) {
+        free_tables(&parts[i].tables); /* cache.c */
+        free(parts[i].name);
+    }
+    free(parts);
+}
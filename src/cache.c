@@ -0,0 +1,1110 @@
+/*
+ * cache.c - Binary corpus cache for the GULAG.
+ *
+ * The binary cache stores every table of ngram counts of a corpus behind a
+ * small versioned header, so it can be mapped with mmap and copied into the
+ * flat corpus arrays without any parsing. Tables with few nonzero counts are
+ * stored sparse, the rest dense. The tables of languages kept in sparse tables
+ * are always stored sparse. The cache also lists the text files counted into
+ * it, so it is rebuilt as soon as one of them changes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+#include "io.h"
+#include "util.h"
+#include "global.h"
+
+/* Mono, bi, tri, quad and the nine skipgram tables. */
+#define BLOCK_COUNT 13
+
+/* The kind of each block, in file order. */
+static const uint32_t block_kinds[BLOCK_COUNT] =
+    {'m', 'b', 't', 'q', '1', '2', '3', '4', '5', '6', '7', '8', '9'};
+
+/*
+ * Returns the number of entries of a dense table.
+ * Parameters:
+ *   kind: The kind of the table.
+ */
+static uint64_t table_size(uint32_t kind)
+{
+    uint64_t l = LANG_LENGTH;
+    switch (kind) {
+        case 'm': return l;
+        case 'b': return l * l;
+        case 't': return l * l * l;
+        case 'q': return l * l * l * l;
+        default:  return l * l;
+    }
+}
+
+/*
+ * Returns the sparse table holding a table, NULL if it is stored dense. The
+ * skipgram blocks all share one sparse table.
+ * Parameters:
+ *   kind: The kind of the table.
+ */
+static sparse_table *sparse_of(uint32_t kind)
+{
+    switch (kind) {
+        case 'm': return NULL;
+        case 'b': return NULL;
+        case 't': return sparse_tri;
+        case 'q': return sparse_quad;
+        default:  return sparse_skip;
+    }
+}
+
+/*
+ * Returns the flat index of the first entry of a table, nonzero for the
+ * skipgram tables past the first.
+ * Parameters:
+ *   kind: The kind of the table.
+ */
+static uint64_t table_base(uint32_t kind)
+{
+    return kind >= '1' && kind <= '9' ? index_skip(kind - '0', 0, 0) : 0; /* util.c */
+}
+
+/*
+ * Returns the flat corpus array of a table.
+ * Parameters:
+ *   kind: The kind of the table.
+ */
+static long long *table_of(uint32_t kind)
+{
+    switch (kind) {
+        case 'm': return corpus_mono;
+        case 'b': return corpus_bi;
+        case 't': return corpus_tri;
+        case 'q': return corpus_quad;
+        default:  return corpus_skip + table_base(kind);
+    }
+}
+
+/*
+ * Hashes the current language's character set, a cache built for another
+ * character set (or another order of it) is rejected.
+ */
+uint64_t lang_hash()
+{
+    uint64_t hash = 14695981039346656037ULL;
+    /* every pair in use and one padding character, 101 for small languages */
+    for (int i = 0; i < 2 * (LANG_LENGTH - 1) + 1; i++) {
+        uint32_t c = (uint32_t)lang_arr[i];
+        for (int b = 0; b < 4; b++) {
+            hash ^= (c >> (8 * b)) & 0xff;
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+/* Text files counted into the corpus arrays, the corpus itself first. */
+static cache_source *sources = NULL;
+static int sources_used = 0;
+
+/*
+ * Builds the path of a file in the corpora directory of the current language.
+ */
+char *corpora_path(const char *name, const char *extension)
+{
+    char *path = (char*)malloc(strlen("./data//corpora/") + strlen(lang_name) +
+        strlen(name) + strlen(extension) + 1);
+    if (path == NULL) {error("failed to malloc corpus path");}
+    strcpy(path, "./data/");
+    strcat(path, lang_name);
+    strcat(path, "/corpora/");
+    strcat(path, name);
+    strcat(path, extension);
+    return path;
+}
+
+/*
+ * Builds the path of a file next to the corpus, in the corpora directory of
+ * the current language.
+ */
+char *corpus_path(const char *extension)
+{
+    return corpora_path(corpus_name, extension);
+}
+
+/*
+ * Finds the text file of a corpus in the corpora directory, plain or
+ * compressed.
+ */
+char *source_path(const char *name)
+{
+    const char *extensions[] = {".txt", ".txt.gz", ".txt.xz", ".txt.zst",
+        ".freq", ".freq.gz", ".freq.xz", ".freq.zst"};
+    for (int i = 0; i < 8; i++) {
+        char *path = corpora_path(name, extensions[i]);
+        if (access(path, F_OK) == 0) {return path;}
+        free(path);
+    }
+    return corpora_path(name, ".txt");
+}
+
+/*
+ * Hashes the content of a file, 8 bytes per step of FNV-1a so even a large
+ * corpus hashes at memory speed.
+ * Parameters:
+ *   path: The path of the file.
+ *   hash: Where to store the hash.
+ * Returns: 1 if the file was hashed, 0 if it could not be read.
+ */
+static int content_hash(const char *path, uint64_t *hash)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {return 0;}
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return 0;
+    }
+    size_t size = info.st_size;
+    *hash = 14695981039346656037ULL ^ size;
+    if (size == 0) {
+        close(fd);
+        return 1;
+    }
+    const unsigned char *data = (const unsigned char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {return 0;}
+    madvise((void *)data, size, MADV_SEQUENTIAL);
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        *hash = (*hash ^ word) * 1099511628211ULL;
+    }
+    for (; i < size; i++) {*hash = (*hash ^ data[i]) * 1099511628211ULL;}
+    munmap((void *)data, size);
+    return 1;
+}
+
+/*
+ * Checks whether a corpus file is a word frequency list.
+ */
+int is_word_list(const char *path)
+{
+    const char *name = strrchr(path, '/');
+    return strstr(name == NULL ? path : name, ".freq") != NULL;
+}
+
+/*
+ * Hashes the content of a source file. The counts of a word list also depend
+ * on the word separator, so it is part of the hash of a word list.
+ * Parameters:
+ *   path: The path of the file.
+ *   hash: Where to store the hash.
+ * Returns: 1 if the file was hashed, 0 if it could not be read.
+ */
+static int source_hash(const char *path, uint64_t *hash)
+{
+    if (!content_hash(path, hash)) {return 0;}
+    if (is_word_list(path)) {*hash = (*hash ^ (uint32_t)word_separator) * 1099511628211ULL;}
+    return 1;
+}
+
+/*
+ * Fills the size and modification time of a source from its file.
+ * Parameters:
+ *   source: The source, its name set.
+ * Returns: 1 if the file exists, 0 otherwise.
+ */
+static int stat_source(cache_source *source)
+{
+    char *path = source_path(source->name);
+    struct stat info;
+    int found = stat(path, &info) == 0;
+    free(path);
+    if (!found) {return 0;}
+    source->size = info.st_size;
+    source->mtime_sec = info.st_mtim.tv_sec;
+    source->mtime_nsec = info.st_mtim.tv_nsec;
+    return 1;
+}
+
+/*
+ * Checks one source of a cache against its file.
+ * Parameters:
+ *   source: The source as stored in the cache, its size and modification
+ *           time are updated if only those changed.
+ * Returns: 1 if the file is missing or unchanged, 0 if its content changed.
+ */
+static int check_source(cache_source *source)
+{
+    cache_source current = *source;
+    /* a cache shipped without its text is all there is */
+    if (!stat_source(&current)) {return 1;}
+    char *path = source_path(source->name);
+    /* a word list is small, and its hash covers the separator as well */
+    if (!is_word_list(path) && current.size == source->size && current.mtime_sec == source->mtime_sec
+        && current.mtime_nsec == source->mtime_nsec) {
+        free(path);
+        return 1;
+    }
+    /* touched or copied, only the content decides */
+    int hashed = source_hash(path, &current.hash);
+    free(path);
+    if (!hashed || current.size != source->size || current.hash != source->hash) {return 0;}
+    *source = current;
+    return 1;
+}
+
+/*
+ * Returns the number of text files counted into the corpus arrays, as read
+ * from the cache or recorded since.
+ */
+int source_count()
+{
+    return sources_used;
+}
+
+/*
+ * Returns the name of a text file counted into the corpus arrays.
+ */
+const char *source_name(int i)
+{
+    return sources[i].name;
+}
+
+/*
+ * Records that a text file of the corpora directory was counted into the
+ * corpus arrays, with its current size, modification time and content hash.
+ * A source of the same name is updated in place.
+ */
+void record_source(const char *name)
+{
+    if (strlen(name) >= SOURCE_NAME_LENGTH) {error("Corpus name too long to be cached.");}
+    int i = 0;
+    while (i < sources_used && strcmp(sources[i].name, name) != 0) {i++;}
+    if (i == sources_used) {
+        sources = (cache_source *)realloc(sources, (sources_used + 1) * sizeof(cache_source));
+        if (sources == NULL) {error("failed to realloc cache sources");}
+        memset(&sources[i], 0, sizeof(cache_source));
+        strcpy(sources[i].name, name);
+        sources_used++;
+    }
+
+    char *path = source_path(name);
+    if (!stat_source(&sources[i]) || !source_hash(path, &sources[i].hash)) {
+        error("Corpus file changed while it was counted.");
+    }
+    free(path);
+}
+
+/*
+ * Forgets a source, used when a file counted before no longer exists.
+ */
+void drop_source(int i)
+{
+    memmove(&sources[i], &sources[i + 1], (sources_used - i - 1) * sizeof(cache_source));
+    sources_used--;
+}
+
+/* Forgets every source, before counting a different corpus. */
+void clear_sources()
+{
+    free(sources);
+    sources = NULL;
+    sources_used = 0;
+}
+
+/*
+ * Checks whether a text file is a source whose content did not change since
+ * it was counted.
+ */
+int source_unchanged(const char *name)
+{
+    for (int i = 0; i < sources_used; i++) {
+        if (strcmp(sources[i].name, name) != 0) {continue;}
+        uint64_t hash;
+        char *path = source_path(name);
+        int hashed = source_hash(path, &hash);
+        free(path);
+        return hashed && hash == sources[i].hash;
+    }
+    return 0;
+}
+
+/* A binary cache mapped into memory by open_cache. */
+typedef struct mapped_cache {
+    unsigned char *map;
+    size_t size;
+    cache_header *header;
+    cache_block *blocks;
+    /* copy of the sources, with the modification times of touched files */
+    cache_source *sources;
+    uint64_t sources_offset;
+    int refreshed;
+    /* the source that changed, -1 if none did */
+    int changed;
+} mapped_cache;
+
+/* What open_cache found. */
+#define CACHE_MISSING 0
+#define CACHE_VALID 1
+#define CACHE_STALE 2
+#define CACHE_CORRUPT 3
+
+/*
+ * Releases a cache mapped by open_cache, safe to call on any result.
+ * Parameters:
+ *   cache: The cache.
+ */
+static void close_cache(mapped_cache *cache)
+{
+    if (cache->map != NULL) {munmap(cache->map, cache->size);}
+    free(cache->sources);
+    cache->map = NULL;
+    cache->sources = NULL;
+}
+
+/*
+ * Maps the binary cache of a corpus and validates its header, its sources and
+ * every block. Writes nothing, so several caches can be opened at once.
+ * Parameters:
+ *   name:  The name of the corpus.
+ *   cache: Where to store the mapping, its sources are kept even if stale.
+ * Returns: CACHE_VALID, CACHE_MISSING if there is no usable cache for this
+ *          language and version, CACHE_STALE if a source changed, or
+ *          CACHE_CORRUPT if a block is out of bounds.
+ */
+static int open_cache(const char *name, mapped_cache *cache)
+{
+    memset(cache, 0, sizeof(mapped_cache));
+    cache->changed = -1;
+    char *path = corpora_path(name, ".gcache");
+    int fd = open(path, O_RDONLY);
+    free(path);
+    if (fd < 0) {return CACHE_MISSING;}
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(cache_header)) {
+        close(fd);
+        return CACHE_MISSING;
+    }
+    size_t size = info.st_size;
+    unsigned char *map = (unsigned char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {return CACHE_MISSING;}
+    cache->map = map;
+    cache->size = size;
+
+    /* only trust a cache of this version, built for this exact language */
+    cache_header *header = (cache_header *)map;
+    uint64_t sources_offset = sizeof(cache_header) + (uint64_t)header->block_count * sizeof(cache_block);
+    if (memcmp(header->magic, CACHE_MAGIC, 8) != 0 || header->version != CACHE_VERSION
+        || header->lang_length != (uint32_t)LANG_LENGTH || header->lang_hash != lang_hash()
+        || sources_offset + (uint64_t)header->source_count * sizeof(cache_source) > size) {
+        close_cache(cache);
+        return CACHE_MISSING;
+    }
+    cache->header = header;
+    cache->blocks = (cache_block *)(map + sizeof(cache_header));
+    cache->sources_offset = sources_offset;
+
+    /* keep the sources even if stale, a rebuild recounts all of them */
+    int count = header->source_count;
+    cache->sources = (cache_source *)malloc((count + 1) * sizeof(cache_source));
+    if (cache->sources == NULL) {error("failed to malloc cache sources");}
+    memcpy(cache->sources, map + sources_offset, count * sizeof(cache_source));
+    for (int i = 0; i < count; i++) {
+        cache->sources[i].name[SOURCE_NAME_LENGTH - 1] = '\0';
+        cache_source stored = cache->sources[i];
+        if (!check_source(&cache->sources[i])) {
+            cache->changed = i;
+            return CACHE_STALE;
+        }
+        cache->refreshed |= memcmp(&stored, &cache->sources[i], sizeof(cache_source)) != 0;
+    }
+
+    /* validate every block before anything reads them */
+    cache_block *blocks = cache->blocks;
+    for (uint32_t b = 0; b < header->block_count; b++) {
+        uint64_t width = blocks[b].format == BLOCK_DENSE ? sizeof(uint64_t) : sizeof(cache_entry);
+        int known = 0;
+        for (int k = 0; k < BLOCK_COUNT; k++) {known |= blocks[b].kind == block_kinds[k];}
+        if (!known || (blocks[b].format == BLOCK_DENSE && blocks[b].entries != table_size(blocks[b].kind))
+            || (blocks[b].format == BLOCK_DENSE && sparse_of(blocks[b].kind) != NULL)
+            || blocks[b].offset % 8 != 0 || blocks[b].offset > size
+            || blocks[b].entries > (size - blocks[b].offset) / width) {
+            return CACHE_CORRUPT;
+        }
+    }
+    return CACHE_VALID;
+}
+
+/*
+ * Stores the new modification times of touched sources in a cache, so the
+ * next run skips hashing them.
+ * Parameters:
+ *   name:   The name of the corpus.
+ *   list:   The sources with their new modification times.
+ *   count:  The number of sources.
+ *   offset: The offset of the sources in the cache file.
+ */
+static void refresh_sources(const char *name, const cache_source *list, int count, uint64_t offset)
+{
+    char *path = corpora_path(name, ".gcache");
+    int out = open(path, O_WRONLY);
+    free(path);
+    if (out < 0) {return;}
+    ssize_t bytes = count * sizeof(cache_source);
+    if (pwrite(out, list, bytes, offset) != bytes) {log_print('v',L"Cache sources not refreshed... ");}
+    close(out);
+}
+
+/*
+ * Reads the binary cache of the current corpus with mmap and fills the global
+ * corpus arrays from it.
+ */
+int read_binary_cache()
+{
+    mapped_cache cache;
+    int found = open_cache(corpus_name, &cache);
+
+    /* keep the sources of a stale cache, a rebuild recounts all of them */
+    if (cache.sources != NULL) {
+        free(sources);
+        sources = cache.sources;
+        sources_used = cache.header->source_count;
+        cache.sources = NULL;
+    }
+    if (found != CACHE_VALID) {
+        if (found == CACHE_MISSING) {log_print('v',L"Binary cache not found or outdated... ");}
+        else if (found == CACHE_CORRUPT) {log_print('v',L"Binary cache corrupt... ");}
+        else {log_print('n',L"Corpus %s changed, cache stale... ", sources[cache.changed].name);}
+        close_cache(&cache);
+        return 0;
+    }
+    log_print('v',L"Binary cache found... ");
+
+    log_print('v',L"Reading binary cache... ");
+    cache_block *blocks = cache.blocks;
+    for (uint32_t b = 0; b < cache.header->block_count; b++) {
+        long long *table = table_of(blocks[b].kind);
+        sparse_table *sparse = sparse_of(blocks[b].kind);
+        uint64_t limit = table_size(blocks[b].kind);
+        if (sparse != NULL) {
+            cache_entry *entries = (cache_entry *)(cache.map + blocks[b].offset);
+            uint64_t base = table_base(blocks[b].kind);
+            for (uint64_t i = 0; i < blocks[b].entries; i++) {
+                if (entries[i].index < limit) {sparse_add(sparse, base + entries[i].index, entries[i].count);} /* sparse.c */
+            }
+        } else if (blocks[b].format == BLOCK_DENSE) {
+            /* same layout as the corpus array, a straight copy */
+            memcpy(table, cache.map + blocks[b].offset, limit * sizeof(uint64_t));
+        } else {
+            cache_entry *entries = (cache_entry *)(cache.map + blocks[b].offset);
+            for (uint64_t i = 0; i < blocks[b].entries; i++) {
+                if (entries[i].index < limit) {table[entries[i].index] = entries[i].count;}
+            }
+        }
+    }
+
+    if (cache.refreshed) {refresh_sources(corpus_name, sources, sources_used, cache.sources_offset);}
+    close_cache(&cache);
+    return 1;
+}
+
+/*
+ * Identifies the counts in the binary cache of a corpus, without reading
+ * them. The stamp changes whenever the counts or their sources change.
+ */
+int cache_stamp(const char *name, uint64_t *stamp)
+{
+    mapped_cache cache;
+    if (open_cache(name, &cache) != CACHE_VALID) {
+        close_cache(&cache);
+        return 0;
+    }
+    uint64_t hash = 14695981039346656037ULL;
+    for (uint32_t b = 0; b < cache.header->block_count; b++) {
+        uint64_t fields[3] = {cache.blocks[b].kind, cache.blocks[b].entries, cache.blocks[b].total};
+        for (int f = 0; f < 3; f++) {hash = (hash ^ fields[f]) * 1099511628211ULL;}
+    }
+    /* the modification times change on a touch, the content does not */
+    for (uint32_t i = 0; i < cache.header->source_count; i++) {
+        hash = (hash ^ cache.sources[i].size) * 1099511628211ULL;
+        hash = (hash ^ cache.sources[i].hash) * 1099511628211ULL;
+        for (const char *c = cache.sources[i].name; *c; c++) {hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;}
+    }
+    if (cache.refreshed) {refresh_sources(name, cache.sources, cache.header->source_count, cache.sources_offset);}
+    close_cache(&cache);
+    *stamp = hash;
+    return 1;
+}
+
+/*
+ * Returns the dense table of a set of normalized tables for a block kind.
+ * Parameters:
+ *   tables: The tables.
+ *   kind:   The kind of the block.
+ */
+static float *linear_of(linear_tables *tables, uint32_t kind)
+{
+    switch (kind) {
+        case 'm': return tables->mono;
+        case 'b': return tables->bi;
+        case 't': return tables->tri;
+        case 'q': return tables->quad;
+        default:  return tables->skip == NULL ? NULL : tables->skip + table_base(kind);
+    }
+}
+
+/*
+ * Returns the sparse table of a set of normalized tables for a block kind,
+ * NULL if it is dense.
+ * Parameters:
+ *   tables: The tables.
+ *   kind:   The kind of the block.
+ */
+static sparse_table *sparse_linear_of(linear_tables *tables, uint32_t kind)
+{
+    switch (kind) {
+        case 'm': return NULL;
+        case 'b': return NULL;
+        case 't': return tables->sparse_tri;
+        case 'q': return tables->sparse_quad;
+        default:  return tables->sparse_skip;
+    }
+}
+
+/*
+ * Reads the binary cache of a corpus into its own normalized tables, without
+ * touching the global arrays, so several corpora can be read at once.
+ */
+int read_cache_linear(const char *name, linear_tables *tables)
+{
+    mapped_cache cache;
+    if (open_cache(name, &cache) != CACHE_VALID) {
+        close_cache(&cache);
+        return 0;
+    }
+
+    size_t l = LANG_LENGTH;
+    memset(tables, 0, sizeof(linear_tables));
+    tables->mono = (float *)aligned_calloc(l, sizeof(float)); /* util.c */
+    tables->bi = (float *)aligned_calloc(l * l, sizeof(float)); /* util.c */
+    if (sparse_quad != NULL) {
+        tables->sparse_tri = create_sparse(l * l); /* sparse.c */
+        tables->sparse_quad = create_sparse(l * l); /* sparse.c */
+        tables->sparse_skip = create_sparse(l * l); /* sparse.c */
+        /* only normalized values are stored */
+        free_sparse_counts(tables->sparse_tri); /* sparse.c */
+        free_sparse_counts(tables->sparse_quad); /* sparse.c */
+        free_sparse_counts(tables->sparse_skip); /* sparse.c */
+    } else {
+        tables->tri = (float *)aligned_calloc(l * l * l, sizeof(float)); /* util.c */
+        tables->quad = (float *)aligned_calloc(l * l * l * l, sizeof(float)); /* util.c */
+        tables->skip = (float *)aligned_calloc(10 * l * l, sizeof(float)); /* util.c */
+    }
+
+    /* every block is normalized on its own, like normalize_corpus does */
+    cache_block *blocks = cache.blocks;
+    for (uint32_t b = 0; b < cache.header->block_count; b++) {
+        uint32_t kind = blocks[b].kind;
+        long long total = blocks[b].total;
+        float *linear = linear_of(tables, kind);
+        sparse_table *sparse = sparse_linear_of(tables, kind);
+        uint64_t limit = table_size(kind);
+        if (total <= 0) {continue;}
+        if (blocks[b].format == BLOCK_DENSE) {
+            normalize_table((const long long *)(cache.map + blocks[b].offset), linear, limit); /* util.c */
+            continue;
+        }
+        cache_entry *entries = (cache_entry *)(cache.map + blocks[b].offset);
+        uint64_t base = table_base(kind);
+        for (uint64_t i = 0; i < blocks[b].entries; i++) {
+            if (entries[i].index >= limit) {continue;}
+            float value = (float)(long long)entries[i].count * 100 / total;
+            if (sparse != NULL) {sparse_add_value(sparse, base + entries[i].index, value);} /* sparse.c */
+            else {linear[entries[i].index] = value;}
+        }
+    }
+    close_cache(&cache);
+    return 1;
+}
+
+/*
+ * Frees the tables allocated by read_cache_linear.
+ */
+void free_tables(linear_tables *tables)
+{
+    free(tables->mono);
+    free(tables->bi);
+    free(tables->tri);
+    free(tables->quad);
+    free(tables->skip);
+    free_sparse(tables->sparse_tri); /* sparse.c */
+    free_sparse(tables->sparse_quad); /* sparse.c */
+    free_sparse(tables->sparse_skip); /* sparse.c */
+    memset(tables, 0, sizeof(linear_tables));
+}
+
+/*
+ * Writes 'count' bytes to a file, terminating the program on failure.
+ * Parameters:
+ *   file:  The file to write to.
+ *   data:  The bytes to write.
+ *   count: The number of bytes.
+ */
+static void write_bytes(FILE *file, const void *data, size_t count)
+{
+    if (fwrite(data, 1, count, file) != count) {error("Corpus cache file failed to be written.");}
+}
+
+/*
+ * Orders sparse cache entries by index, for qsort.
+ */
+static int compare_entries(const void *a, const void *b)
+{
+    uint64_t x = ((const cache_entry *)a)->index;
+    uint64_t y = ((const cache_entry *)b)->index;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Collects the nonzero counts of one table from a sparse table, sorted by
+ * their index in the table.
+ * Parameters:
+ *   sparse: The sparse table.
+ *   base:   The flat index of the first entry of the table.
+ *   size:   The number of entries of the table.
+ *   count:  Where to store the number of entries collected.
+ *   total:  Where to store the sum of their counts.
+ * Returns: The allocated entries, to be freed by the caller.
+ */
+static cache_entry *collect_sparse(const sparse_table *sparse, uint64_t base, uint64_t size,
+    uint64_t *count, uint64_t *total)
+{
+    cache_entry *entries = (cache_entry *)malloc((sparse->used + 1) * sizeof(cache_entry));
+    if (entries == NULL) {error("failed to malloc sparse cache entries");}
+    *count = 0;
+    *total = 0;
+    for (size_t i = 0; i <= sparse->mask; i++) {
+        uint64_t index = sparse->keys[i] - 1;
+        if (sparse->keys[i] == 0 || index < base || index >= base + size || sparse->counts[i] <= 0) {continue;}
+        entries[*count].index = index - base;
+        entries[*count].count = sparse->counts[i];
+        *total += sparse->counts[i];
+        (*count)++;
+    }
+    qsort(entries, *count, sizeof(cache_entry), compare_entries);
+    return entries;
+}
+
+/*
+ * Writes the global corpus arrays to the binary cache of the current corpus.
+ * Each table is stored dense or sparse, whichever is smaller. The cache is
+ * written to a temporary file and renamed over the old one, so a reader never
+ * sees a partial cache.
+ */
+void write_binary_cache()
+{
+    cache_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, 8);
+    header.version = CACHE_VERSION;
+    header.lang_length = LANG_LENGTH;
+    header.lang_hash = lang_hash();
+    header.block_count = BLOCK_COUNT;
+    header.source_count = sources_used;
+
+    /* count nonzero entries to choose each block's format and its offset */
+    cache_block blocks[BLOCK_COUNT];
+    /* the sorted entries of the tables kept in sparse tables */
+    cache_entry *collected[BLOCK_COUNT] = {NULL};
+    uint64_t offset = sizeof(cache_header) + sizeof(blocks) + sources_used * sizeof(cache_source);
+    for (int b = 0; b < BLOCK_COUNT; b++) {
+        uint32_t kind = block_kinds[b];
+        long long *table = table_of(kind);
+        sparse_table *sparse = sparse_of(kind);
+        uint64_t size = table_size(kind), nonzero = 0, total = 0;
+        if (sparse != NULL) {
+            collected[b] = collect_sparse(sparse, table_base(kind), size, &nonzero, &total);
+            blocks[b].kind = kind;
+            blocks[b].total = total;
+            blocks[b].offset = offset;
+            blocks[b].format = BLOCK_SPARSE;
+            blocks[b].entries = nonzero;
+            offset += nonzero * sizeof(cache_entry);
+            continue;
+        }
+        for (uint64_t i = 0; i < size; i++) {
+            uint64_t count = table[i];
+            if (count > 0) {nonzero++;}
+            total += count;
+        }
+        blocks[b].kind = kind;
+        blocks[b].total = total;
+        blocks[b].offset = offset;
+        if (nonzero * sizeof(cache_entry) < size * sizeof(uint64_t)) {
+            blocks[b].format = BLOCK_SPARSE;
+            blocks[b].entries = nonzero;
+            offset += nonzero * sizeof(cache_entry);
+        } else {
+            blocks[b].format = BLOCK_DENSE;
+            blocks[b].entries = size;
+            offset += size * sizeof(uint64_t);
+        }
+    }
+
+    char *path = corpus_path(".gcache");
+    char *temp = (char*)malloc(strlen(path) + 32);
+    if (temp == NULL) {error("failed to malloc corpus cache path");}
+    sprintf(temp, "%s.%ld.tmp", path, (long)getpid());
+    FILE *cache = fopen(temp, "wb");
+    if (cache == NULL) {error("Corpus cache file failed to be created.");}
+    log_print('n',L"Created cache file... ");
+
+    write_bytes(cache, &header, sizeof(header));
+    write_bytes(cache, blocks, sizeof(blocks));
+    write_bytes(cache, sources, sources_used * sizeof(cache_source));
+    for (int b = 0; b < BLOCK_COUNT; b++) {
+        long long *table = table_of(blocks[b].kind);
+        uint64_t size = table_size(blocks[b].kind);
+        if (collected[b] != NULL) {
+            write_bytes(cache, collected[b], blocks[b].entries * sizeof(cache_entry));
+            free(collected[b]);
+            continue;
+        }
+        if (blocks[b].format == BLOCK_DENSE) {
+            write_bytes(cache, table, size * sizeof(uint64_t));
+            continue;
+        }
+        for (uint64_t i = 0; i < size; i++) {
+            uint64_t count = table[i];
+            if (count > 0) {
+                cache_entry entry = {i, count};
+                write_bytes(cache, &entry, sizeof(entry));
+            }
+        }
+    }
+
+    if (fflush(cache) != 0 || fsync(fileno(cache)) != 0) {error("Corpus cache file failed to be written.");}
+    fclose(cache);
+    /* atomically replace any previous cache */
+    if (rename(temp, path) != 0) {
+        remove(temp);
+        error("Corpus cache file failed to be replaced.");
+    }
+    free(temp);
+    free(path);
+}
+
+/*
+ * Returns the global normalized tables as a set of tables.
+ */
+static linear_tables global_tables()
+{
+    linear_tables tables = {linear_mono, linear_bi, linear_tri, linear_quad, linear_skip,
+        sparse_tri, sparse_quad, sparse_skip};
+    return tables;
+}
+
+/* The cache of normalized frequencies whose tables are used in place. */
+static unsigned char *linear_map = NULL;
+static size_t linear_map_size = 0;
+
+/*
+ * Returns the global linear array used in place for a block kind, NULL for
+ * the skipgrams, whose nine blocks are copied into one array, and for the
+ * sparse tables of large languages.
+ * Parameters:
+ *   kind: The kind of the block.
+ */
+static float **mapped_global(uint32_t kind)
+{
+    int sparse = LANG_LENGTH > DENSE_LANG_LENGTH;
+    switch (kind) {
+        case 'm': return &linear_mono;
+        case 'b': return &linear_bi;
+        case 't': return sparse ? NULL : &linear_tri;
+        case 'q': return sparse ? NULL : &linear_quad;
+        default:  return NULL;
+    }
+}
+
+/*
+ * Unmaps the cache of normalized frequencies, clearing the global linear
+ * arrays that pointed into it.
+ */
+void release_linear_cache()
+{
+    if (linear_map == NULL) {return;}
+    const uint32_t kinds[4] = {'m', 'b', 't', 'q'};
+    for (int k = 0; k < 4; k++) {
+        float **global = mapped_global(kinds[k]);
+        if (global != NULL && (unsigned char *)*global >= linear_map
+            && (unsigned char *)*global < linear_map + linear_map_size) {
+            *global = NULL;
+        }
+    }
+    munmap(linear_map, linear_map_size);
+    linear_map = NULL;
+    linear_map_size = 0;
+}
+
+/*
+ * Reads a cache of normalized frequencies into the global linear arrays, or
+ * the sparse tables of large languages. Dense mono to quad tables are used in
+ * place from the mapping, the rest is copied.
+ */
+int read_linear_cache(const char *path, uint64_t key)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {return 0;}
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(linear_header)) {
+        close(fd);
+        return 0;
+    }
+    size_t size = info.st_size;
+    /* private and writable, a stray write copies the page instead of faulting */
+    unsigned char *map = (unsigned char *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {return 0;}
+
+    linear_header *header = (linear_header *)map;
+    cache_block *blocks = (cache_block *)(map + sizeof(linear_header));
+    int sparse_language = LANG_LENGTH > DENSE_LANG_LENGTH;
+    int valid = memcmp(header->magic, LINEAR_MAGIC, 8) == 0 && header->version == LINEAR_VERSION
+        && header->lang_length == (uint32_t)LANG_LENGTH && header->lang_hash == lang_hash()
+        && header->key == key && header->block_count <= BLOCK_COUNT
+        && sizeof(linear_header) + header->block_count * sizeof(cache_block) <= size;
+    for (uint32_t b = 0; valid && b < header->block_count; b++) {
+        uint32_t kind = blocks[b].kind;
+        uint64_t width = blocks[b].format == BLOCK_DENSE ? sizeof(float) : sizeof(linear_entry);
+        int known = 0;
+        for (int k = 0; k < BLOCK_COUNT; k++) {known |= kind == block_kinds[k];}
+        valid = known && blocks[b].offset % 64 == 0 && blocks[b].offset <= size
+            && blocks[b].entries <= (size - blocks[b].offset) / width
+            && (blocks[b].format != BLOCK_DENSE || (blocks[b].entries == table_size(kind)
+                && (!sparse_language || kind == 'm' || kind == 'b')));
+    }
+    if (!valid) {
+        munmap(map, size);
+        return 0;
+    }
+
+    release_linear_cache();
+    size_t l = LANG_LENGTH;
+    int mapped = 0;
+    for (uint32_t b = 0; b < header->block_count; b++) {
+        uint32_t kind = blocks[b].kind;
+        float **global = mapped_global(kind);
+        if (global != NULL && blocks[b].format == BLOCK_DENSE) {
+            free(*global);
+            *global = (float *)(map + blocks[b].offset);
+            mapped = 1;
+            continue;
+        }
+
+        /* everything else is copied, into tables allocated when missing */
+        sparse_table **sparse = NULL;
+        if (sparse_language && kind != 'm' && kind != 'b') {
+            sparse = kind == 't' ? &sparse_tri : kind == 'q' ? &sparse_quad : &sparse_skip;
+            if (*sparse == NULL) {
+                *sparse = create_sparse(l * l); /* sparse.c */
+                free_sparse_counts(*sparse); /* sparse.c */
+            }
+        } else if (global == NULL) {
+            /* the nine skipgram blocks share one array */
+            if (linear_skip == NULL) {linear_skip = (float *)aligned_calloc(10 * l * l, sizeof(float));} /* util.c */
+        } else if (*global == NULL) {
+            *global = (float *)aligned_calloc(table_size(kind), sizeof(float)); /* util.c */
+        }
+        float *linear = sparse != NULL ? NULL : global != NULL ? *global : linear_skip + table_base(kind);
+        uint64_t limit = table_size(kind);
+        if (blocks[b].format == BLOCK_DENSE) {
+            memcpy(linear, map + blocks[b].offset, limit * sizeof(float));
+            continue;
+        }
+        linear_entry *entries = (linear_entry *)(map + blocks[b].offset);
+        uint64_t base = table_base(kind);
+        for (uint64_t i = 0; i < blocks[b].entries; i++) {
+            if (entries[i].index >= limit) {continue;}
+            if (sparse != NULL) {sparse_add_value(*sparse, base + entries[i].index, entries[i].value);} /* sparse.c */
+            else {linear[entries[i].index] = entries[i].value;}
+        }
+    }
+
+    if (mapped) {
+        linear_map = map;
+        linear_map_size = size;
+    } else {
+        munmap(map, size);
+    }
+    return 1;
+}
+
+/*
+ * Orders sparse linear entries by index, for qsort.
+ */
+static int compare_linear(const void *a, const void *b)
+{
+    uint64_t x = ((const linear_entry *)a)->index;
+    uint64_t y = ((const linear_entry *)b)->index;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Collects the nonzero frequencies of one table, sorted by their index in the
+ * table.
+ * Parameters:
+ *   linear: The dense table, used if 'sparse' is NULL.
+ *   sparse: The sparse table holding the table, or NULL.
+ *   base:   The flat index of the first entry of the table in 'sparse'.
+ *   size:   The number of entries of the table.
+ *   count:  Where to store the number of entries collected.
+ * Returns: The allocated entries, to be freed by the caller.
+ */
+static linear_entry *collect_linear(const float *linear, const sparse_table *sparse, uint64_t base,
+    uint64_t size, uint64_t *count)
+{
+    uint64_t capacity = 0;
+    if (sparse != NULL) {capacity = sparse->used;}
+    else {for (uint64_t i = 0; i < size; i++) {capacity += linear[i] != 0;}}
+    linear_entry *entries = (linear_entry *)malloc((capacity + 1) * sizeof(linear_entry));
+    if (entries == NULL) {error("failed to malloc linear cache entries");}
+    *count = 0;
+    if (sparse == NULL) {
+        for (uint64_t i = 0; i < size; i++) {
+            if (linear[i] == 0) {continue;}
+            entries[*count].index = i;
+            entries[*count].value = linear[i];
+            entries[*count].reserved = 0;
+            (*count)++;
+        }
+        return entries;
+    }
+    for (size_t i = 0; sparse->values != NULL && i <= sparse->mask; i++) {
+        uint64_t index = sparse->keys[i] - 1;
+        if (sparse->keys[i] == 0 || index < base || index >= base + size || sparse->values[i] == 0) {continue;}
+        entries[*count].index = index - base;
+        entries[*count].value = sparse->values[i];
+        entries[*count].reserved = 0;
+        (*count)++;
+    }
+    qsort(entries, *count, sizeof(linear_entry), compare_linear);
+    return entries;
+}
+
+/*
+ * Writes the global linear arrays, or the sparse tables of large languages,
+ * to a cache of normalized frequencies. Dense arrays are stored dense, the
+ * skipgram blocks dense or sparse, whichever is smaller, and the file is
+ * replaced atomically.
+ */
+void write_linear_cache(const char *path, uint64_t key)
+{
+    linear_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LINEAR_MAGIC, 8);
+    header.version = LINEAR_VERSION;
+    header.lang_length = LANG_LENGTH;
+    header.lang_hash = lang_hash();
+    header.key = key;
+    header.block_count = BLOCK_COUNT;
+
+    /* mono to quad are always dense so they can be mapped, the small
+       skipgram blocks are copied anyway and take the smaller format */
+    linear_tables tables = global_tables();
+    cache_block blocks[BLOCK_COUNT];
+    linear_entry *collected[BLOCK_COUNT] = {NULL};
+    uint64_t offset = sizeof(linear_header) + sizeof(blocks);
+    for (int b = 0; b < BLOCK_COUNT; b++) {
+        uint32_t kind = block_kinds[b];
+        uint64_t size = table_size(kind), nonzero = 0;
+        sparse_table *sparse = sparse_linear_of(&tables, kind);
+        int skip = kind >= '1' && kind <= '9';
+        if (sparse != NULL || skip) {
+            collected[b] = collect_linear(linear_of(&tables, kind), sparse, table_base(kind), size, &nonzero);
+        }
+        blocks[b].kind = kind;
+        blocks[b].total = 0;
+        /* every block starts on a cache line, ready to be used in place */
+        offset = (offset + 63) / 64 * 64;
+        blocks[b].offset = offset;
+        if (sparse != NULL || (skip && nonzero * sizeof(linear_entry) < size * sizeof(float))) {
+            blocks[b].format = BLOCK_SPARSE;
+            blocks[b].entries = nonzero;
+            offset += nonzero * sizeof(linear_entry);
+        } else {
+            blocks[b].format = BLOCK_DENSE;
+            blocks[b].entries = size;
+            offset += size * sizeof(float);
+        }
+    }
+
+    char *temp = (char*)malloc(strlen(path) + 32);
+    if (temp == NULL) {error("failed to malloc linear cache path");}
+    sprintf(temp, "%s.%ld.tmp", path, (long)getpid());
+    FILE *cache = fopen(temp, "wb");
+    if (cache == NULL) {error("Linear cache file failed to be created.");}
+
+    static const unsigned char padding[64] = {0};
+    uint64_t written = sizeof(header) + sizeof(blocks);
+    write_bytes(cache, &header, sizeof(header));
+    write_bytes(cache, blocks, sizeof(blocks));
+    for (int b = 0; b < BLOCK_COUNT; b++) {
+        write_bytes(cache, padding, blocks[b].offset - written);
+        if (blocks[b].format == BLOCK_DENSE) {
+            write_bytes(cache, linear_of(&tables, blocks[b].kind), blocks[b].entries * sizeof(float));
+            written = blocks[b].offset + blocks[b].entries * sizeof(float);
+        } else {
+            write_bytes(cache, collected[b], blocks[b].entries * sizeof(linear_entry));
+            written = blocks[b].offset + blocks[b].entries * sizeof(linear_entry);
+        }
+        free(collected[b]);
+    }
+
+    if (fflush(cache) != 0 || fsync(fileno(cache)) != 0) {error("Linear cache file failed to be written.");}
+    fclose(cache);
+    if (rename(temp, path) != 0) {
+        remove(temp);
+        error("Linear cache file failed to be replaced.");
+    }
+    free(temp);
+}
+
+/*
+ * Reads the normalized frequencies of the current corpus from its
+ * '<corpus>.glinear' cache.
+ */
+int read_normalized_cache()
+{
+    uint64_t stamp;
+    if (corpus_from_stdin() || append_name != NULL) {return 0;} /* io.c */
+    if (!cache_stamp(corpus_name, &stamp)) {return 0;}
+    char *path = corpus_path(".glinear");
+    int found = read_linear_cache(path, stamp);
+    free(path);
+    return found;
+}
+
+/*
+ * Writes the normalized frequencies of the current corpus to its
+ * '<corpus>.glinear' cache.
+ */
+void write_normalized_cache()
+{
+    uint64_t stamp;
+    if (corpus_from_stdin() || !cache_stamp(corpus_name, &stamp)) {return;} /* io.c */
+    char *path = corpus_path(".glinear");
+    write_linear_cache(path, stamp);
+    free(path);
+}
@@ -0,0 +1,745 @@
+/*
+ * corpus.c - Parallel corpus ingestion for the GULAG.
+ *
+ * A corpus file is mapped into memory and split into byte ranges aligned to
+ * UTF-8 character boundaries. Every range is counted by a task on the worker
+ * pool into its own flat tables, which are then summed into the global corpus
+ * arrays, again in parallel, one leading character per task. Characters are
+ * decoded by hand, with a fast path for runs of ASCII, and kept in a ring
+ * buffer window with a bit mask of which are valid in the language. Languages
+ * too large for dense tables count tri, quad and skipgrams into sparse tables,
+ * merged with one task per table. Compressed corpora and standard input are
+ * counted chunk by chunk as a separate thread decompresses them. Word
+ * frequency lists are counted one word at a time, weighted by their counts.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "corpus.h"
+#include "stream.h"
+#include "cache.h"
+#include "pool.h"
+#include "io.h"
+#include "io_util.h"
+#include "util.h"
+#include "global.h"
+
+#define UNICODE_MAX 65535
+
+/* Characters of context a range reads before its start, for skip-9. */
+#define WINDOW 10
+
+/* Smallest range worth its own task and private tables. */
+#define MIN_RANGE_BYTES (1 << 20)
+
+/* Largest range, its private 32-bit counts can then never overflow. */
+#define MAX_RANGE_BYTES (1 << 30)
+
+/* Decompressed bytes counted by one task when streaming. */
+#define CHUNK_BYTES (1 << 22)
+
+/* Room for the context and a cut short character copied before a chunk. */
+#define CONTEXT_BYTES (WINDOW * 4 + 4)
+
+/*
+ * Private flat counts of one range, indexed like the index_* functions. Large
+ * languages count tri, quad and skipgrams into sparse tables instead.
+ */
+typedef struct range_counts {
+    int *mono;
+    int *bi;
+    int *tri;
+    int *quad;
+    int *skip;
+    sparse_table *sparse_tri;
+    sparse_table *sparse_quad;
+    sparse_table *sparse_skip;
+} range_counts;
+
+/* One byte range of the mapped corpus and its counts. */
+typedef struct ingest_task {
+    const unsigned char *data;
+    /* language index of every code point, 0 if not valid in the language */
+    const unsigned char *codes;
+    size_t size;
+    size_t begin;
+    size_t end;
+    range_counts counts;
+} ingest_task;
+
+/* The ranges being summed by the reduction tasks. */
+typedef struct reduce_task {
+    ingest_task *tasks;
+    int count;
+    int first;
+} reduce_task;
+
+/* The ranges whose sparse tables of one kind are being merged. */
+typedef struct merge_task {
+    ingest_task *tasks;
+    int count;
+    char kind;
+} merge_task;
+
+/*
+ * Moves a byte offset forward to the start of the next UTF-8 character.
+ * Parameters:
+ *   data:   The mapped corpus.
+ *   size:   The size of the corpus in bytes.
+ *   offset: The offset to align.
+ * Returns: The aligned offset.
+ */
+static size_t align_utf8(const unsigned char *data, size_t size, size_t offset)
+{
+    while (offset < size && (data[offset] & 0xC0) == 0x80) {offset++;}
+    return offset;
+}
+
+/*
+ * Decodes one UTF-8 character, rejecting the same overlong, surrogate and
+ * truncated sequences as the C library does.
+ * Parameters:
+ *   data:   The mapped corpus.
+ *   size:   The offset decoding must not pass.
+ *   offset: The offset of the character, advanced past it. An invalid
+ *           sequence only advances by one byte.
+ * Returns: The code point, or -1 if the sequence is invalid.
+ */
+static inline int decode_utf8(const unsigned char *data, size_t size, size_t *offset)
+{
+    const unsigned char *p = data + *offset;
+    size_t left = size - *offset;
+    unsigned char b0 = p[0];
+    if (b0 < 0x80) {
+        *offset += 1;
+        return b0;
+    }
+    if (b0 >= 0xC2 && b0 <= 0xDF) {
+        if (left >= 2 && (p[1] & 0xC0) == 0x80) {
+            *offset += 2;
+            return ((b0 & 0x1F) << 6) | (p[1] & 0x3F);
+        }
+    } else if (b0 >= 0xE0 && b0 <= 0xEF) {
+        /* E0 needs A0 or more to not be overlong, ED less than A0 to not be a surrogate */
+        unsigned char low = b0 == 0xE0 ? 0xA0 : 0x80;
+        unsigned char high = b0 == 0xED ? 0x9F : 0xBF;
+        if (left >= 3 && p[1] >= low && p[1] <= high && (p[2] & 0xC0) == 0x80) {
+            *offset += 3;
+            return ((b0 & 0x0F) << 12) | ((p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+        }
+    } else if (b0 >= 0xF0 && b0 <= 0xF4) {
+        /* F0 needs 90 or more to not be overlong, F4 less than 90 to stay in range */
+        unsigned char low = b0 == 0xF0 ? 0x90 : 0x80;
+        unsigned char high = b0 == 0xF4 ? 0x8F : 0xBF;
+        if (left >= 4 && p[1] >= low && p[1] <= high && (p[2] & 0xC0) == 0x80 && (p[3] & 0xC0) == 0x80) {
+            *offset += 4;
+            return ((b0 & 0x07) << 18) | ((p[1] & 0x3F) << 12) | ((p[2] & 0x3F) << 6) | (p[3] & 0x3F);
+        }
+    }
+    *offset += 1;
+    return -1;
+}
+
+/*
+ * The last 11 characters seen, as a ring buffer of language indices with a
+ * mask of which of them are valid in the language, bit k for k characters
+ * ago, so no shifting or range checks are needed per character.
+ */
+typedef struct window {
+    int ring[16];
+    unsigned head;
+    unsigned valid;
+} window;
+
+/*
+ * Pushes one character into the window.
+ * Parameters:
+ *   w:    The window.
+ *   code: The language index of the character, 0 if it is not valid.
+ */
+static inline void push_char(window *w, int code)
+{
+    w->head = (w->head + 1) & 15;
+    w->ring[w->head] = code;
+    w->valid = ((w->valid << 1) | (code != 0)) & 0x7FF;
+}
+
+/*
+ * Counts every ngram ending at the newest character of the window.
+ * Parameters:
+ *   counts: The tables to count into.
+ *   w:      The window.
+ */
+static inline void count_window(range_counts *counts, window *w)
+{
+    unsigned valid = w->valid;
+    if (!(valid & 1)) {return;}
+    int c0 = w->ring[w->head];
+    int c1 = w->ring[(w->head - 1) & 15];
+    int c2 = w->ring[(w->head - 2) & 15];
+    int c3 = w->ring[(w->head - 3) & 15];
+
+    counts->mono[c0]++;
+    if ((valid & 0x3) == 0x3) {
+        counts->bi[index_bi(c1, c0)]++; /* util.c */
+        if (counts->sparse_tri != NULL) {
+            if ((valid & 0x7) == 0x7) {
+                sparse_add(counts->sparse_tri, index_tri(c2, c1, c0), 1); /* sparse.c */
+                if ((valid & 0xF) == 0xF) {
+                    sparse_add(counts->sparse_quad, index_quad(c3, c2, c1, c0), 1); /* sparse.c */
+                }
+            }
+        } else if ((valid & 0x7) == 0x7) {
+            counts->tri[index_tri(c2, c1, c0)]++; /* util.c */
+            if ((valid & 0xF) == 0xF) {
+                counts->quad[index_quad(c3, c2, c1, c0)]++; /* util.c */
+            }
+        }
+    }
+
+    /* skip-1 to skip-9, only for the valid characters 2 to 10 back */
+    unsigned skips = valid & 0x7FC;
+    while (skips) {
+        int back = __builtin_ctz(skips);
+        size_t index = index_skip(back - 1, w->ring[(w->head - back) & 15], c0); /* util.c */
+        if (counts->sparse_skip != NULL) {sparse_add(counts->sparse_skip, index, 1);} /* sparse.c */
+        else {counts->skip[index]++;}
+        skips &= skips - 1;
+    }
+}
+
+/*
+ * Pool task that counts every ngram ending inside one byte range.
+ * Parameters:
+ *   arg: A pointer to an ingest_task.
+ */
+static void ingest_range(void *arg)
+{
+    ingest_task *task = (ingest_task *)arg;
+    range_counts *counts = &task->counts;
+    const unsigned char *data = task->data;
+    const unsigned char *codes = task->codes;
+    window w;
+    memset(&w, 0, sizeof(w));
+
+    /* every character is at most 4 bytes, so this reaches WINDOW characters */
+    size_t offset = task->begin > WINDOW * 4 ? task->begin - WINDOW * 4 : 0;
+    offset = align_utf8(data, task->size, offset);
+    while (offset < task->begin) {
+        int c = decode_utf8(data, task->size, &offset);
+        push_char(&w, c >= 0 && c <= UNICODE_MAX ? codes[c] : 0);
+    }
+
+    size_t end = task->end;
+    while (offset < end) {
+        /* fast path for runs of ASCII, 8 bytes at a time */
+        while (offset + 8 <= end) {
+            uint64_t word;
+            memcpy(&word, data + offset, 8);
+            if (word & 0x8080808080808080ULL) {break;}
+            for (int b = 0; b < 8; b++) {
+                push_char(&w, codes[data[offset + b]]);
+                count_window(counts, &w);
+            }
+            offset += 8;
+        }
+        if (offset >= end) {break;}
+
+        /* convert characters based on the lang file */
+        int c = decode_utf8(data, task->size, &offset);
+        push_char(&w, c >= 0 && c <= UNICODE_MAX ? codes[c] : 0);
+        count_window(counts, &w);
+    }
+}
+
+/*
+ * Adds a slice of one range's counts to a flat corpus array.
+ * Parameters:
+ *   total:  The corpus array.
+ *   counts: The range's counts, indexed the same way.
+ *   start:  The first index of the slice.
+ *   length: The number of entries in the slice.
+ */
+static void add_slice(long long *total, const int *counts, size_t start, size_t length)
+{
+    for (size_t i = start; i < start + length; i++) {total[i] += counts[i];}
+}
+
+/*
+ * Pool task that sums the counts of every range for all ngrams starting with
+ * one character into the global corpus arrays. Tasks write disjoint slices.
+ * Parameters:
+ *   arg: A pointer to a reduce_task.
+ */
+static void reduce_first(void *arg)
+{
+    reduce_task *reduce = (reduce_task *)arg;
+    int i = reduce->first;
+    size_t l = LANG_LENGTH;
+
+    for (int t = 0; t < reduce->count; t++) {
+        range_counts *counts = &reduce->tasks[t].counts;
+        add_slice(corpus_mono, counts->mono, index_mono(i), 1); /* util.c */
+        add_slice(corpus_bi, counts->bi, index_bi(i, 0), l); /* util.c */
+        if (counts->sparse_tri != NULL) {continue;}
+        add_slice(corpus_tri, counts->tri, index_tri(i, 0, 0), l * l); /* util.c */
+        add_slice(corpus_quad, counts->quad, index_quad(i, 0, 0, 0), l * l * l); /* util.c */
+        for (int skip = 1; skip <= 9; skip++) {
+            add_slice(corpus_skip, counts->skip, index_skip(skip, i, 0), l); /* util.c */
+        }
+    }
+}
+
+/*
+ * Pool task that merges the sparse tables of one kind of every range into the
+ * global sparse table of that kind.
+ * Parameters:
+ *   arg: A pointer to a merge_task.
+ */
+static void merge_kind(void *arg)
+{
+    merge_task *merge = (merge_task *)arg;
+    for (int t = 0; t < merge->count; t++) {
+        range_counts *counts = &merge->tasks[t].counts;
+        switch (merge->kind) {
+            case 't': merge_sparse(sparse_tri, counts->sparse_tri); break; /* sparse.c */
+            case 'q': merge_sparse(sparse_quad, counts->sparse_quad); break; /* sparse.c */
+            default:  merge_sparse(sparse_skip, counts->sparse_skip); break; /* sparse.c */
+        }
+    }
+}
+
+/*
+ * Builds the language index of every code point, 0 if it is not valid in the
+ * language, the only lookup the counting loop needs.
+ * Returns: The allocated table of UNICODE_MAX + 1 entries.
+ */
+static unsigned char *build_codes()
+{
+    unsigned char *codes = (unsigned char *)calloc(UNICODE_MAX + 1, 1);
+    if (codes == NULL) {error("failed to calloc corpus code table");}
+    for (int c = 0; c <= UNICODE_MAX; c++) {
+        int index = convert_char(c); /* io_util.c */
+        if (index > 0 && index < LANG_LENGTH) {codes[c] = index;}
+    }
+    return codes;
+}
+
+/*
+ * Allocates the private counts of one range, sparse for large languages.
+ * Parameters:
+ *   counts: The counts to allocate.
+ */
+static void alloc_counts(range_counts *counts)
+{
+    size_t l = LANG_LENGTH;
+    memset(counts, 0, sizeof(range_counts));
+    counts->mono = (int *)calloc(l, sizeof(int));
+    counts->bi = (int *)calloc(l * l, sizeof(int));
+    if (counts->mono == NULL || counts->bi == NULL) {error("failed to calloc corpus range counts");}
+    if (sparse_quad != NULL) {
+        counts->sparse_tri = create_sparse(l * l); /* sparse.c */
+        counts->sparse_quad = create_sparse(l * l); /* sparse.c */
+        counts->sparse_skip = create_sparse(l * l); /* sparse.c */
+    } else {
+        counts->tri = (int *)calloc(l * l * l, sizeof(int));
+        counts->quad = (int *)calloc(l * l * l * l, sizeof(int));
+        counts->skip = (int *)calloc(10 * l * l, sizeof(int));
+        if (counts->tri == NULL || counts->quad == NULL || counts->skip == NULL) {
+            error("failed to calloc corpus range counts");
+        }
+    }
+}
+
+/*
+ * Frees the private counts of one range.
+ * Parameters:
+ *   counts: The counts to free.
+ */
+static void free_counts(range_counts *counts)
+{
+    free(counts->mono);
+    free(counts->bi);
+    free(counts->tri);
+    free(counts->quad);
+    free(counts->skip);
+    free_sparse(counts->sparse_tri); /* sparse.c */
+    free_sparse(counts->sparse_quad); /* sparse.c */
+    free_sparse(counts->sparse_skip); /* sparse.c */
+}
+
+/*
+ * Sums the counts of every range into the global corpus arrays, with one
+ * pool task per leading character and one per sparse table.
+ * Parameters:
+ *   tasks: The ranges.
+ *   count: The number of ranges.
+ */
+static void sum_counts(ingest_task *tasks, int count)
+{
+    size_t l = LANG_LENGTH;
+    reduce_task *reduces = (reduce_task *)malloc(l * sizeof(reduce_task));
+    if (reduces == NULL) {error("failed to malloc corpus reduction");}
+    for (size_t i = 0; i < l; i++) {
+        reduces[i].tasks = tasks;
+        reduces[i].count = count;
+        reduces[i].first = i;
+        pool_submit(reduce_first, &reduces[i]); /* pool.c */
+    }
+    /* one task per sparse table, they cannot be split by leading character */
+    merge_task merges[3] = {{tasks, count, 't'}, {tasks, count, 'q'}, {tasks, count, 's'}};
+    if (sparse_quad != NULL) {
+        for (int m = 0; m < 3; m++) {pool_submit(merge_kind, &merges[m]);} /* pool.c */
+    }
+    pool_wait(); /* pool.c */
+    free(reduces);
+}
+
+/*
+ * Counts a plain text file mapped into memory, split into one byte range per
+ * worker.
+ * Parameters:
+ *   fd:   The open file.
+ *   size: The size of the file in bytes, not 0.
+ * Returns: 1 if the file was counted, 0 if it could not be mapped.
+ */
+static int ingest_mapped(int fd, size_t size)
+{
+    const unsigned char *data = (const unsigned char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {return 0;}
+    madvise((void *)data, size, MADV_SEQUENTIAL);
+    unsigned char *codes = build_codes();
+
+    /* one range per worker, unless the ranges would get too small */
+    int count = pool_size(); /* pool.c */
+    if ((size_t)count > size / MIN_RANGE_BYTES) {count = size / MIN_RANGE_BYTES;}
+    if (count < 1) {count = 1;}
+    if ((size - 1) / count >= MAX_RANGE_BYTES) {count = (size - 1) / MAX_RANGE_BYTES + 1;}
+
+    ingest_task *tasks = (ingest_task *)malloc(count * sizeof(ingest_task));
+    if (tasks == NULL) {error("failed to malloc corpus ranges");}
+    log_print('v',L"Counting %d range%s... ", count, count == 1 ? "" : "s");
+    for (int t = 0; t < count; t++) {
+        tasks[t].data = data;
+        tasks[t].codes = codes;
+        tasks[t].size = size;
+        tasks[t].begin = align_utf8(data, size, size / count * t);
+        tasks[t].end = t == count - 1 ? size : align_utf8(data, size, size / count * (t + 1));
+        alloc_counts(&tasks[t].counts);
+        pool_submit(ingest_range, &tasks[t]); /* pool.c */
+    }
+    pool_wait(); /* pool.c */
+
+    log_print('v',L"Merging... ");
+    sum_counts(tasks, count);
+
+    for (int t = 0; t < count; t++) {free_counts(&tasks[t].counts);}
+    free(tasks);
+    free(codes);
+    munmap((void *)data, size);
+    return 1;
+}
+
+/*
+ * Finds where the last complete character of a chunk ends, so a character
+ * split between two chunks is only counted with the second.
+ * Parameters:
+ *   data: The chunk.
+ *   size: The number of bytes in the chunk.
+ * Returns: The offset just past the last character that is not cut short.
+ */
+static size_t complete_utf8(const unsigned char *data, size_t size)
+{
+    for (size_t back = 1; back <= 4 && back <= size; back++) {
+        unsigned char b = data[size - back];
+        if ((b & 0xC0) == 0x80) {continue;}
+        size_t length = b < 0xC0 ? 1 : b < 0xE0 ? 2 : b < 0xF0 ? 3 : 4;
+        return length > back ? size - back : size;
+    }
+    return size;
+}
+
+/*
+ * Counts a compressed file or a pipe as it is decompressed. Every chunk is
+ * counted by a pool task into the private counts of one of the workers, with
+ * the end of the previous chunk copied in front of it as context, while the
+ * decompression thread fills the next chunks. The counts are summed into the
+ * corpus arrays before they could overflow, and at the end.
+ * Parameters:
+ *   fd: The open file, closed here unless it is standard input.
+ */
+static void ingest_stream(int fd)
+{
+    unsigned char *codes = build_codes();
+    int count = pool_size(); /* pool.c */
+    stream *input = open_stream(fd, CHUNK_BYTES, CONTEXT_BYTES, 2 * count); /* stream.c */
+    log_print('v',L"Streaming %s... ", stream_format(input)); /* stream.c */
+
+    ingest_task *tasks = (ingest_task *)malloc(count * sizeof(ingest_task));
+    unsigned char **chunks = (unsigned char **)malloc(count * sizeof(unsigned char *));
+    if (tasks == NULL || chunks == NULL) {error("failed to malloc corpus ranges");}
+    for (int t = 0; t < count; t++) {
+        tasks[t].codes = codes;
+        alloc_counts(&tasks[t].counts);
+    }
+
+    /* the uncounted end of the last chunk and the context before it */
+    unsigned char carry[CONTEXT_BYTES];
+    size_t carry_size = 0;
+    size_t carry_begin = 0;
+    size_t counted = 0;
+    int ended = 0;
+    while (!ended) {
+        int used = 0;
+        size_t size;
+        unsigned char *data;
+        while (used < count && (data = stream_next(input, &size)) != NULL) { /* stream.c */
+            ingest_task *task = &tasks[used];
+            memcpy(data - carry_size, carry, carry_size);
+            task->data = data - carry_size;
+            task->size = carry_size + size;
+            task->begin = carry_begin;
+            task->end = complete_utf8(task->data, task->size);
+            pool_submit(ingest_range, task); /* pool.c */
+            chunks[used++] = data;
+
+            size_t context = task->end > WINDOW * 4 ? task->end - WINDOW * 4 : 0;
+            carry_size = task->size - context;
+            carry_begin = task->end - context;
+            memcpy(carry, task->data + context, carry_size);
+        }
+        ended = used < count;
+        pool_wait(); /* pool.c */
+        for (int c = 0; c < used; c++) {stream_release(input, chunks[c]);} /* stream.c */
+
+        /* a worker counts at most one chunk per round */
+        counted += CHUNK_BYTES;
+        if (ended || counted + CHUNK_BYTES > MAX_RANGE_BYTES) {
+            /* a character cut short at the very end is counted alone */
+            if (ended && carry_begin < carry_size) {
+                tasks[0].data = carry;
+                tasks[0].size = carry_size;
+                tasks[0].begin = carry_begin;
+                tasks[0].end = carry_size;
+                ingest_range(&tasks[0]);
+            }
+            sum_counts(tasks, count);
+            for (int t = 0; t < count && !ended; t++) {
+                free_counts(&tasks[t].counts);
+                alloc_counts(&tasks[t].counts);
+            }
+            counted = 0;
+        }
+    }
+    close_stream(input); /* stream.c */
+
+    for (int t = 0; t < count; t++) {free_counts(&tasks[t].counts);}
+    free(chunks);
+    free(tasks);
+    free(codes);
+}
+
+/*
+ * Counts every ngram ending at the newest character of the window straight
+ * into the global corpus arrays, a number of times at once.
+ * Parameters:
+ *   w:      The window.
+ *   weight: The number of times to count them.
+ */
+static void count_weighted(window *w, long long weight)
+{
+    unsigned valid = w->valid;
+    if (!(valid & 1)) {return;}
+    int c0 = w->ring[w->head];
+    int c1 = w->ring[(w->head - 1) & 15];
+    int c2 = w->ring[(w->head - 2) & 15];
+    int c3 = w->ring[(w->head - 3) & 15];
+
+    corpus_mono[index_mono(c0)] += weight; /* util.c */
+    if ((valid & 0x3) == 0x3) {
+        corpus_bi[index_bi(c1, c0)] += weight; /* util.c */
+        if ((valid & 0x7) == 0x7) {
+            size_t tri = index_tri(c2, c1, c0); /* util.c */
+            if (sparse_tri != NULL) {sparse_add(sparse_tri, tri, weight);} /* sparse.c */
+            else {corpus_tri[tri] += weight;}
+            if ((valid & 0xF) == 0xF) {
+                size_t quad = index_quad(c3, c2, c1, c0); /* util.c */
+                if (sparse_quad != NULL) {sparse_add(sparse_quad, quad, weight);} /* sparse.c */
+                else {corpus_quad[quad] += weight;}
+            }
+        }
+    }
+
+    unsigned skips = valid & 0x7FC;
+    while (skips) {
+        int back = __builtin_ctz(skips);
+        size_t index = index_skip(back - 1, w->ring[(w->head - back) & 15], c0); /* util.c */
+        if (sparse_skip != NULL) {sparse_add(sparse_skip, index, weight);} /* sparse.c */
+        else {corpus_skip[index] += weight;}
+        skips &= skips - 1;
+    }
+}
+
+/*
+ * Parses a whole number of occurrences.
+ * Parameters:
+ *   text: The field.
+ *   size: The length of the field.
+ *   count: Where to store the number.
+ * Returns: 1 if the field is a number, 0 otherwise.
+ */
+static int parse_count(const unsigned char *text, size_t size, long long *count)
+{
+    if (size == 0 || size > 18) {return 0;}
+    *count = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (text[i] < '0' || text[i] > '9') {return 0;}
+        *count = *count * 10 + (text[i] - '0');
+    }
+    return 1;
+}
+
+/*
+ * Counts one line of a word list, 'word count' or 'count word' separated by
+ * spaces or tabs, or a word alone which counts once. The word is counted with
+ * the separator before and after it, but only the one after counts on its
+ * own, so every occurrence adds one separator like the space after a word of
+ * running text.
+ * Parameters:
+ *   line:      The line, without its line break.
+ *   size:      The length of the line.
+ *   codes:     The language index of every code point.
+ *   separator: The language index of the separator, 0 for none.
+ * Returns: 1 if a word was counted, 0 for an empty line.
+ */
+static int count_word(const unsigned char *line, size_t size, const unsigned char *codes, int separator)
+{
+    /* trim the line, then split off the first and last field */
+    size_t begin = 0;
+    while (begin < size && (line[begin] == ' ' || line[begin] == '\t')) {begin++;}
+    while (size > begin && (line[size - 1] == ' ' || line[size - 1] == '\t' || line[size - 1] == '\r')) {size--;}
+    if (begin == size) {return 0;}
+    size_t last = size;
+    while (last > begin && line[last - 1] != ' ' && line[last - 1] != '\t') {last--;}
+    size_t first = begin;
+    while (first < size && line[first] != ' ' && line[first] != '\t') {first++;}
+
+    long long count = 1;
+    size_t word_begin = begin, word_end = size;
+    if (last > begin && parse_count(line + last, size - last, &count)) {
+        word_end = last;
+    } else if (first < size && parse_count(line + begin, first - begin, &count)) {
+        word_begin = first;
+    }
+    while (word_begin < word_end && (line[word_begin] == ' ' || line[word_begin] == '\t')) {word_begin++;}
+    while (word_end > word_begin && (line[word_end - 1] == ' ' || line[word_end - 1] == '\t')) {word_end--;}
+    if (word_begin == word_end || count == 0) {return 0;}
+
+    window w;
+    memset(&w, 0, sizeof(w));
+    if (separator) {push_char(&w, separator);}
+    size_t offset = word_begin;
+    while (offset < word_end) {
+        int c = decode_utf8(line, word_end, &offset);
+        push_char(&w, c >= 0 && c <= UNICODE_MAX ? codes[c] : 0);
+        count_weighted(&w, count);
+    }
+    if (separator) {
+        push_char(&w, separator);
+        count_weighted(&w, count);
+    }
+    return 1;
+}
+
+/*
+ * Counts a word frequency list, expanding every word once and weighting its
+ * ngrams by its count, which is far less work than the running text it
+ * stands for. Ngrams spanning two words are not counted, as the list does not
+ * say which words follow each other. The list is read through a stream, so it
+ * may be compressed as well.
+ * Parameters:
+ *   path: The path of the word list.
+ * Returns: 1 if the list was counted, 0 if it could not be opened.
+ */
+static int ingest_words(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {return 0;}
+    unsigned char *codes = build_codes();
+    /* a separator outside the language only ends the word, as in text */
+    int separator = word_separator > 0 && word_separator <= UNICODE_MAX ? codes[word_separator] : 0;
+    if (separator == 0) {log_print('v',L"Words counted alone... ");}
+
+    stream *input = open_stream(fd, CHUNK_BYTES, 0, 2); /* stream.c */
+    unsigned char *line = NULL;
+    size_t line_size = 0, line_capacity = 0;
+    long long words = 0;
+    size_t size;
+    unsigned char *data;
+    while ((data = stream_next(input, &size)) != NULL) { /* stream.c */
+        size_t start = 0;
+        while (start < size) {
+            unsigned char *newline = (unsigned char *)memchr(data + start, '\n', size - start);
+            size_t end = newline == NULL ? size : (size_t)(newline - data);
+            /* a line split between chunks is gathered first */
+            if (line_size > 0 || newline == NULL) {
+                if (line_size + end - start > line_capacity) {
+                    line_capacity = (line_size + end - start) * 2;
+                    line = (unsigned char *)realloc(line, line_capacity);
+                    if (line == NULL) {error("failed to realloc word list line");}
+                }
+                memcpy(line + line_size, data + start, end - start);
+                line_size += end - start;
+                if (newline != NULL) {
+                    words += count_word(line, line_size, codes, separator);
+                    line_size = 0;
+                }
+            } else {
+                words += count_word(data + start, end - start, codes, separator);
+            }
+            start = end + 1;
+        }
+        stream_release(input, data); /* stream.c */
+    }
+    if (line_size > 0) {words += count_word(line, line_size, codes, separator);}
+    close_stream(input); /* stream.c */
+    log_print('v',L"%lld words... ", words);
+
+    free(line);
+    free(codes);
+    return 1;
+}
+
+/*
+ * Counts every ngram of a UTF-8 text file into the global corpus arrays.
+ * Plain files are mapped and split into byte ranges, compressed files and
+ * pipes are streamed.
+ */
+int ingest_file(const char *path)
+{
+    if (strcmp(path, "-") != 0 && is_word_list(path)) {return ingest_words(path);} /* cache.c */
+    int fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+    if (fd < 0) {return 0;}
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        if (fd != STDIN_FILENO) {close(fd);}
+        return 0;
+    }
+    if (S_ISREG(info.st_mode) && !compressed_file(fd)) { /* stream.c */
+        if (info.st_size == 0) {
+            if (fd != STDIN_FILENO) {close(fd);}
+            return 1;
+        }
+        return ingest_mapped(fd, info.st_size);
+    }
+    ingest_stream(fd);
+    return 1;
+}
@@ -0,0 +1,337 @@
+/*
+ * gather.c - Vectorized ngram accumulation for the GULAG.
+ *
+ * Gathering a stat reads the characters at the keys of each of its ngrams
+ * from the layout, skips the ngram if a key is empty, and adds the frequency
+ * at the index the characters form. The ngrams are decoded into matrix
+ * offsets once, after the stats are cleaned, so the kernels are straight
+ * gathers: AVX-512 and AVX2 read 16 or 8 ngrams at a time with gather
+ * instructions and mask out the empty keys, the scalar kernel reads one. The
+ * kernel is picked at run time from what the cpu supports, so a binary built
+ * without -march=native still takes the vector path.
+ *
+ * Scoring many layouts, the batch kernels instead hold one layout per lane,
+ * with the layouts interleaved so the characters at a key are one load. Each
+ * ngram is then read once per batch, and each lane adds up its layout in the
+ * same order the scalar kernel does.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gather.h"
+#include "io.h"
+#include "util.h"
+#include "global.h"
+#include "structs.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GATHER_X86 1
+#include <immintrin.h>
+#else
+#define GATHER_X86 0
+#endif
+
+/* The offset lists are padded to whole AVX-512 vectors. */
+#define GATHER_PAD 16
+
+/* How many vectors ahead the offsets are prefetched. */
+#define PREFETCH_AHEAD 4
+
+gather_function gather_sums = NULL;
+batch_function batch_sums = NULL;
+int batch_lanes = 1;
+gather_list *gather_mono = NULL;
+gather_list *gather_bi = NULL;
+gather_list *gather_tri = NULL;
+gather_list *gather_quad = NULL;
+gather_list *gather_skip = NULL;
+
+/*
+ * Sums the frequencies one ngram at a time, in the order the ngrams are
+ * listed.
+ */
+static void gather_scalar(const gather_list *list, const int *matrix, const float *table,
+    const int *bases, int count, float *sums)
+{
+    for (int t = 0; t < count; t++) {sums[t] = 0;}
+    for (int j = 0; j < list->length; j++)
+    {
+        int index = 0;
+        int k = 0;
+        for (; k < list->keys; k++)
+        {
+            int c = matrix[list->offsets[k][j]];
+            if (c == -1) {break;}
+            index = index * LANG_LENGTH + c;
+        }
+        if (k < list->keys) {continue;}
+        for (int t = 0; t < count; t++) {sums[t] += table[bases[t] + index];}
+    }
+}
+
+#if GATHER_X86
+
+/*
+ * Sums the frequencies eight ngrams at a time with AVX2 gathers, one partial
+ * sum per lane.
+ */
+__attribute__((target("avx2")))
+static void gather_avx2(const gather_list *list, const int *matrix, const float *table,
+    const int *bases, int count, float *sums)
+{
+    const __m256i none = _mm256_set1_epi32(-1);
+    const __m256i lang = _mm256_set1_epi32(LANG_LENGTH);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256 partial[9];
+    for (int t = 0; t < count; t++) {partial[t] = _mm256_setzero_ps();}
+
+    for (int j = 0; j < list->length; j += 8)
+    {
+        /* lanes past the end are off from the start, the padding is zeros */
+        __m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32(list->length - j), lanes);
+        __m256i index = _mm256_setzero_si256();
+        for (int k = 0; k < list->keys; k++)
+        {
+            _mm_prefetch((const char *)(list->offsets[k] + j + 8 * PREFETCH_AHEAD), _MM_HINT_T0);
+            __m256i offset = _mm256_load_si256((const __m256i *)(list->offsets[k] + j));
+            __m256i c = _mm256_i32gather_epi32(matrix, offset, 4);
+            valid = _mm256_andnot_si256(_mm256_cmpeq_epi32(c, none), valid);
+            index = _mm256_add_epi32(_mm256_mullo_epi32(index, lang), c);
+        }
+        for (int t = 0; t < count; t++)
+        {
+            __m256 f = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), table + bases[t], index,
+                _mm256_castsi256_ps(valid), 4);
+            partial[t] = _mm256_add_ps(partial[t], f);
+        }
+    }
+
+    for (int t = 0; t < count; t++)
+    {
+        __m128 half = _mm_add_ps(_mm256_castps256_ps128(partial[t]), _mm256_extractf128_ps(partial[t], 1));
+        half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+        half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+        sums[t] = _mm_cvtss_f32(half);
+    }
+}
+
+/*
+ * Sums the frequencies sixteen ngrams at a time with AVX-512 gathers, the
+ * empty keys and the tail masked off.
+ */
+__attribute__((target("avx512f")))
+static void gather_avx512(const gather_list *list, const int *matrix, const float *table,
+    const int *bases, int count, float *sums)
+{
+    const __m512i none = _mm512_set1_epi32(-1);
+    const __m512i lang = _mm512_set1_epi32(LANG_LENGTH);
+    __m512 partial[9];
+    for (int t = 0; t < count; t++) {partial[t] = _mm512_setzero_ps();}
+
+    for (int j = 0; j < list->length; j += 16)
+    {
+        int left = list->length - j;
+        __mmask16 valid = left >= 16 ? 0xFFFF : (__mmask16)((1u << left) - 1);
+        __m512i index = _mm512_setzero_si512();
+        for (int k = 0; k < list->keys; k++)
+        {
+            _mm_prefetch((const char *)(list->offsets[k] + j + 16 * PREFETCH_AHEAD), _MM_HINT_T0);
+            __m512i offset = _mm512_load_si512((const void *)(list->offsets[k] + j));
+            __m512i c = _mm512_i32gather_epi32(offset, matrix, 4);
+            valid = _mm512_mask_cmpneq_epi32_mask(valid, c, none);
+            index = _mm512_add_epi32(_mm512_mullo_epi32(index, lang), c);
+        }
+        for (int t = 0; t < count; t++)
+        {
+            __m512 f = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), valid, index, table + bases[t], 4);
+            partial[t] = _mm512_add_ps(partial[t], f);
+        }
+    }
+
+    for (int t = 0; t < count; t++) {sums[t] = _mm512_reduce_add_ps(partial[t]);}
+}
+
+/*
+ * Sums the frequencies for eight layouts at a time with AVX2, one layout per
+ * lane, the empty keys masked off.
+ */
+__attribute__((target("avx2")))
+static void batch_avx2(const gather_list *list, const int *soa, const float *table,
+    const int *bases, int count, float *sums)
+{
+    const __m256i none = _mm256_set1_epi32(-1);
+    const __m256i lang = _mm256_set1_epi32(LANG_LENGTH);
+    __m256 partial[9];
+    for (int t = 0; t < count; t++) {partial[t] = _mm256_setzero_ps();}
+
+    for (int j = 0; j < list->length; j++)
+    {
+        __m256i valid = _mm256_set1_epi32(-1);
+        __m256i index = _mm256_setzero_si256();
+        for (int k = 0; k < list->keys; k++)
+        {
+            __m256i c = _mm256_load_si256((const __m256i *)(soa + list->offsets[k][j] * 8));
+            valid = _mm256_andnot_si256(_mm256_cmpeq_epi32(c, none), valid);
+            index = _mm256_add_epi32(_mm256_mullo_epi32(index, lang), c);
+        }
+        for (int t = 0; t < count; t++)
+        {
+            __m256 f = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), table + bases[t], index,
+                _mm256_castsi256_ps(valid), 4);
+            partial[t] = _mm256_add_ps(partial[t], f);
+        }
+    }
+
+    for (int t = 0; t < count; t++) {_mm256_storeu_ps(sums + t * 8, partial[t]);}
+}
+
+/*
+ * Sums the frequencies for sixteen layouts at a time with AVX-512, one layout
+ * per lane, the empty keys masked off.
+ */
+__attribute__((target("avx512f")))
+static void batch_avx512(const gather_list *list, const int *soa, const float *table,
+    const int *bases, int count, float *sums)
+{
+    const __m512i none = _mm512_set1_epi32(-1);
+    const __m512i lang = _mm512_set1_epi32(LANG_LENGTH);
+    __m512 partial[9];
+    for (int t = 0; t < count; t++) {partial[t] = _mm512_setzero_ps();}
+
+    for (int j = 0; j < list->length; j++)
+    {
+        __mmask16 valid = 0xFFFF;
+        __m512i index = _mm512_setzero_si512();
+        for (int k = 0; k < list->keys; k++)
+        {
+            __m512i c = _mm512_load_si512((const void *)(soa + list->offsets[k][j] * 16));
+            valid = _mm512_mask_cmpneq_epi32_mask(valid, c, none);
+            index = _mm512_add_epi32(_mm512_mullo_epi32(index, lang), c);
+        }
+        for (int t = 0; t < count; t++)
+        {
+            __m512 f = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), valid, index, table + bases[t], 4);
+            partial[t] = _mm512_add_ps(partial[t], f);
+        }
+    }
+
+    for (int t = 0; t < count; t++) {_mm512_storeu_ps(sums + t * 16, partial[t]);}
+}
+
+#endif
+
+/*
+ * Decodes the ngrams of one stat into matrix offsets.
+ * Parameters:
+ *   list:   The list to fill.
+ *   ngrams: The flat indices of the ngrams.
+ *   length: The number of ngrams.
+ *   keys:   The number of keys of an ngram.
+ */
+static void decode_list(gather_list *list, const int *ngrams, int length, int keys)
+{
+    int padded = (length + GATHER_PAD - 1) / GATHER_PAD * GATHER_PAD;
+    list->keys = keys;
+    list->length = length;
+    for (int k = 0; k < keys; k++)
+    {
+        list->offsets[k] = (int *)aligned_calloc(padded > 0 ? padded : GATHER_PAD, sizeof(int)); /* util.c */
+        for (int j = 0; j < length; j++)
+        {
+            int ngram = ngrams[j];
+            for (int i = keys - 1; i > k; i--) {ngram /= DIM1;}
+            int position = ngram % DIM1;
+            list->offsets[k][j] = position / COL * MAX_COL + position % COL;
+        }
+    }
+}
+
+/*
+ * Decodes the ngrams of every stat single_analyze gathers and picks the
+ * widest kernels the cpu and --simd allow: AVX-512, AVX2 or scalar, for
+ * single layouts and for batches. Must run after the stats are cleaned.
+ */
+void prepare_gather()
+{
+    gather_mono = (gather_list *)calloc(MONO_LENGTH, sizeof(gather_list));
+    gather_bi = (gather_list *)calloc(BI_LENGTH, sizeof(gather_list));
+    gather_tri = (gather_list *)calloc(TRI_LENGTH, sizeof(gather_list));
+    gather_quad = (gather_list *)calloc(QUAD_LENGTH, sizeof(gather_list));
+    gather_skip = (gather_list *)calloc(SKIP_LENGTH, sizeof(gather_list));
+    if ((MONO_LENGTH && gather_mono == NULL) || (BI_LENGTH && gather_bi == NULL)
+        || (TRI_LENGTH && gather_tri == NULL) || (QUAD_LENGTH && gather_quad == NULL)
+        || (SKIP_LENGTH && gather_skip == NULL)) {
+        error("failed to calloc gather lists");
+    }
+
+    for (int i = 0; i < MONO_LENGTH; i++) {
+        if (plan_mono.gathered[i]) {decode_list(&gather_mono[i], stats_mono[i].ngrams, stats_mono[i].length, 1);}
+    }
+    for (int i = 0; i < BI_LENGTH; i++) {
+        if (plan_bi.gathered[i]) {decode_list(&gather_bi[i], stats_bi[i].ngrams, stats_bi[i].length, 2);}
+    }
+    for (int i = 0; i < TRI_LENGTH; i++) {
+        if (plan_tri.gathered[i]) {decode_list(&gather_tri[i], stats_tri[i].ngrams, stats_tri[i].length, 3);}
+    }
+    for (int i = 0; i < QUAD_LENGTH; i++) {
+        if (plan_quad.gathered[i]) {decode_list(&gather_quad[i], stats_quad[i].ngrams, stats_quad[i].length, 4);}
+    }
+    for (int i = 0; i < SKIP_LENGTH; i++) {
+        if (!stats_skip[i].skip) {decode_list(&gather_skip[i], stats_skip[i].ngrams, stats_skip[i].length, 2);}
+    }
+
+    /* the widest kernel allowed, falling back to the next one down */
+    const char *kernel = "scalar";
+    gather_sums = gather_scalar;
+    batch_sums = NULL;
+    batch_lanes = 1;
+#if GATHER_X86
+    __builtin_cpu_init();
+    if ((simd_level == 'a' || simd_level == '5') && __builtin_cpu_supports("avx512f")) {
+        kernel = "AVX-512";
+        gather_sums = gather_avx512;
+        batch_sums = batch_avx512;
+        batch_lanes = 16;
+    } else if (simd_level != 's' && __builtin_cpu_supports("avx2")) {
+        kernel = "AVX2";
+        gather_sums = gather_avx2;
+        batch_sums = batch_avx2;
+        batch_lanes = 8;
+    }
+#endif
+    if ((simd_level == '5' && strcmp(kernel, "AVX-512") != 0) || (simd_level == '2' && gather_sums == gather_scalar)) {
+        log_print('n',L"requested instructions unsupported, ");
+    }
+    log_print('n',L"%s kernel... ", kernel);
+}
+
+/*
+ * Frees the decoded ngram lists of one type.
+ * Parameters:
+ *   lists:  The lists.
+ *   length: The number of stats of the type.
+ */
+static void free_lists(gather_list *lists, int length)
+{
+    if (lists == NULL) {return;}
+    for (int i = 0; i < length; i++) {
+        for (int k = 0; k < lists[i].keys; k++) {free(lists[i].offsets[k]);}
+    }
+    free(lists);
+}
+
+/* Frees the decoded ngram lists. */
+void free_gather()
+{
+    free_lists(gather_mono, MONO_LENGTH);
+    free_lists(gather_bi, BI_LENGTH);
+    free_lists(gather_tri, TRI_LENGTH);
+    free_lists(gather_quad, QUAD_LENGTH);
+    free_lists(gather_skip, SKIP_LENGTH);
+    gather_mono = gather_bi = gather_tri = gather_quad = gather_skip = NULL;
+    gather_sums = NULL;
+    batch_sums = NULL;
+    batch_lanes = 1;
+}
@@ -12,29 +12,40 @@
 #include "global.h"
 #include "structs.h"
 
-/* Defining dimensions for the layout grid. */
-#define row 3
-#define col 12
-#define dim1 row * col
-#define dim2 dim1 * dim1
-#define dim3 dim2 * dim1
-#define dim4 dim3 * dim1
-
 /* Character count in the chosen language. */
 int LANG_LENGTH = 51;
 
 /* Maximum length of a language definition file. */
-int LANG_FILE_LENGTH = 100;
+int LANG_FILE_LENGTH = 500;
+
+/* Largest character count whose tri, quad and skip tables are stored dense. */
+int DENSE_LANG_LENGTH = 51;
+
+/*
+ * Dimensions of the keyboard grid and the number of ngrams of each size,
+ * read from the keyboard file.
+ */
+int ROW = 0;
+int COL = 0;
+int DIM1 = 0;
+int DIM2 = 0;
+int DIM3 = 0;
+int DIM4 = 0;
+
+/* Number of grid positions with a key. */
+int KEY_COUNT = 0;
 
-/* Re-iterate the dimensions for external use. */
-int ROW = row;
-int COL = col;
-int DIM1 = dim1;
-int DIM2 = dim2;
-int DIM3 = dim3;
-int DIM4 = dim4;
+/* Row of the home keys, the top row is above it and the bottom row below. */
+int HOME_ROW = 1;
 
-int MAX_SWAPS = dim1 / 2;
+/* Finger of every grid position (0-7), -1 where the grid has no key. */
+int key_fingers[MAX_ROW][MAX_COL];
+
+/* 1 for the stretch positions (pinky and index stretch), 0 otherwise. */
+int key_stretch[MAX_ROW][MAX_COL];
+
+/* Half the keys, set with the keyboard. */
+int MAX_SWAPS = 0;
 int WORKERS = 16;
 
 /* Paths to data files. */
@@ -44,6 +55,39 @@ char *layout_name = NULL;
 char *layout2_name = NULL;
 char *weight_name = NULL;
 
+/* Keyboard geometry in data/keyboards/, NULL for the standard keyboard. */
+char *keyboard_name = NULL;
+
+/* Optional output file for the improvement time series (CSV or JSONL). */
+char *telemetry_name = NULL;
+
+/* Comma separated text files to count into the corpus cache, NULL for none. */
+char *append_name = NULL;
+
+/* Custom stat definitions in data/stats/, NULL for none. */
+char *custom_stats_name = NULL;
+
+/* 1 to score with a scorer compiled for the configuration, see scorer.c. */
+int specialize = 0;
+
+/* Instruction set of the gather kernels, 'a'uto, '5' AVX-512, '2' AVX2, 's'calar. */
+char simd_level = 'a';
+
+/* 1 to drop the characters no layout of the run holds, see alphabet.c. */
+int compact = 0;
+
+/* Character counted after every word of a word list corpus, 0 for none. */
+int word_separator = ' ';
+
+/* Stagnation detection for the annealing threads, 0 disables a criterion. */
+int stagnation_limit = 0;
+float stagnation_accept = 0;
+char stagnation_action = 'r';
+
+/* Target acceptance rates of worse moves used to calibrate the temperature. */
+float accept_start = 0.4;
+float accept_end = 0.005;
+
 /* Control flags for program execution. */
 char run_mode = 'a';
 int repetitions = 10000;
@@ -61,17 +105,20 @@ wchar_t *lang_arr;
 int *char_table;
 
 /* Pinned key positions on the layout for improvement. */
-int pins[row][col];
+int pins[MAX_ROW][MAX_COL];
 
 /* Head of the linked list for layout ranking. */
 layout_node *head_node;
 
-/* Arrays to store raw frequency counts from the corpus. */
-int *corpus_mono;
-int **corpus_bi;
-int ***corpus_tri;
-int ****corpus_quad;
-int ***corpus_skip;
+/*
+ * Arrays to store raw frequency counts from the corpus, flat and indexed like
+ * the linear arrays. Freed once the corpus is normalized.
+ */
+long long *corpus_mono;
+long long *corpus_bi;
+long long *corpus_tri;
+long long *corpus_quad;
+long long *corpus_skip;
 
 /* Arrays to store normalized frequency data (percentages). */
 float *linear_mono;
@@ -80,6 +127,14 @@ float *linear_tri;
 float *linear_quad;
 float *linear_skip;
 
+/*
+ * Sparse tables replacing the tri, quad and skip arrays (both raw and linear)
+ * for languages larger than DENSE_LANG_LENGTH, NULL otherwise.
+ */
+sparse_table *sparse_tri;
+sparse_table *sparse_quad;
+sparse_table *sparse_skip;
+
 /* total umber of statistics for each ngram type. */
 int MONO_LENGTH = 0;
 int BI_LENGTH = 0;
@@ -88,6 +143,12 @@ int QUAD_LENGTH = 0;
 int SKIP_LENGTH = 0;
 int META_LENGTH = 0;
 
+/* How the analysis computes each type of statistic, see stats/plan.c. */
+stat_plan plan_mono;
+stat_plan plan_bi;
+stat_plan plan_tri;
+stat_plan plan_quad;
+
 /* Arrays to hold all statistics after processing. */
 mono_stat *stats_mono;
 bi_stat *stats_bi;
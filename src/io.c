@@ -13,9 +13,14 @@
 #include <getopt.h>
 #include <unistd.h>
 #include <stdarg.h>
+#include <sys/stat.h>
 
 #include "io.h"
 #include "io_util.h"
+#include "cache.h"
+#include "corpus.h"
+#include "blend.h"
+#include "skip.h"
 #include "util.h"
 #include "global.h"
 #include "structs.h"
@@ -121,9 +126,6 @@ void read_config()
     }
     log_print('q',L"config.conf found... ");
 
-    char c;
-    int i = 0;
-
     /* Read and set pinned key positions. */
     if (fscanf(config, " %s", discard) != 1) {
         error("Failed to read from config file.");
@@ -132,14 +134,26 @@ void read_config()
         error("Expected 'pins:' at the start of the config file.");
     }
 
-    while (i < ROW * COL && fscanf(config, " %c", &c) == 1) {
-        if (c != '.') {
-            pins[i / COL][i % COL] = 1;
-        } else {
-            pins[i / COL][i % COL] = 0;
+    /*
+     * One line per row of the grid, which is not known until the keyboard is
+     * read, so the rows run up to the first 'name= value' line.
+     */
+    if (fgets(buff, sizeof(buff), config) == NULL) {
+        error("Failed to read pins from config file.");
+    }
+    long line_start = ftell(config);
+    int pin_row = 0;
+    while (fgets(buff, sizeof(buff), config) != NULL && strchr(buff, '=') == NULL) {
+        line_start = ftell(config);
+        int j = 0;
+        for (char *c = buff; *c != '\0'; c++) {
+            if (*c == ' ' || *c == '\t' || *c == '\n' || *c == '\r') {continue;}
+            if (pin_row >= MAX_ROW || j >= MAX_COL) {error("More pins than the largest keyboard in the config file.");}
+            pins[pin_row][j++] = *c != '.';
         }
-        i++;
+        if (j > 0) {pin_row++;}
     }
+    fseek(config, line_start, SEEK_SET);
 
     /* Read and set various parameters from the configuration file. */
     if (fscanf(config, "%s %s", discard, buff) != 2) {
@@ -203,6 +217,41 @@ void read_config()
     fclose(config);
 }
 
+/* Values returned by getopt_long for options without a short form. */
+enum long_only_options {
+    OPT_TELEMETRY = 256,
+    OPT_STAGNATION,
+    OPT_MIN_ACCEPT,
+    OPT_ON_STAGNATION,
+    OPT_ACCEPT_START,
+    OPT_ACCEPT_END,
+    OPT_APPEND,
+    OPT_SEPARATOR,
+    OPT_STATS,
+    OPT_KEYBOARD,
+    OPT_SPECIALIZE,
+    OPT_COMPACT,
+    OPT_SIMD,
+};
+
+/* Long options, these can only be set on the command line. */
+static struct option long_options[] = {
+    {"telemetry", required_argument, NULL, OPT_TELEMETRY},
+    {"stagnation", required_argument, NULL, OPT_STAGNATION},
+    {"min-accept", required_argument, NULL, OPT_MIN_ACCEPT},
+    {"on-stagnation", required_argument, NULL, OPT_ON_STAGNATION},
+    {"accept-start", required_argument, NULL, OPT_ACCEPT_START},
+    {"accept-end", required_argument, NULL, OPT_ACCEPT_END},
+    {"append", required_argument, NULL, OPT_APPEND},
+    {"separator", required_argument, NULL, OPT_SEPARATOR},
+    {"stats", required_argument, NULL, OPT_STATS},
+    {"keyboard", required_argument, NULL, OPT_KEYBOARD},
+    {"specialize", no_argument, NULL, OPT_SPECIALIZE},
+    {"compact", no_argument, NULL, OPT_COMPACT},
+    {"simd", required_argument, NULL, OPT_SIMD},
+    {NULL, 0, NULL, 0}
+};
+
 /*
  * Processes command line arguments to override configuration settings.
  * It parses arguments passed to the main function and updates
@@ -214,7 +263,7 @@ void read_args(int argc, char **argv)
 {
     int opt;
     /* Parse command line arguments. */
-    while ((opt = getopt(argc, argv, "l:c:1:2:w:r:t:m:o:b:")) != -1) {
+    while ((opt = getopt_long(argc, argv, "l:c:1:2:w:r:t:m:o:b:", long_options, NULL)) != -1) {
     switch (opt) {
         case 'l':
             free(lang_name);
@@ -254,10 +303,59 @@ void read_args(int argc, char **argv)
             /* validate and convert backend mode */
             backend_mode = check_backend_mode(optarg); /* io_util.c */
             break;
+        case OPT_TELEMETRY:
+            free(telemetry_name);
+            telemetry_name = strdup(optarg);
+            break;
+        case OPT_STAGNATION:
+            stagnation_limit = atoi(optarg);
+            break;
+        case OPT_MIN_ACCEPT:
+            stagnation_accept = atof(optarg);
+            break;
+        case OPT_ON_STAGNATION:
+            /* validate and convert stagnation action */
+            stagnation_action = check_stagnation_action(optarg); /* io_util.c */
+            break;
+        case OPT_ACCEPT_START:
+            accept_start = atof(optarg);
+            break;
+        case OPT_ACCEPT_END:
+            accept_end = atof(optarg);
+            break;
+        case OPT_APPEND:
+            free(append_name);
+            append_name = strdup(optarg);
+            break;
+        case OPT_SEPARATOR:
+            /* validate and convert word separator */
+            word_separator = check_separator(optarg); /* io_util.c */
+            break;
+        case OPT_STATS:
+            free(custom_stats_name);
+            custom_stats_name = strdup(optarg);
+            break;
+        case OPT_KEYBOARD:
+            free(keyboard_name);
+            keyboard_name = strdup(optarg);
+            break;
+        case OPT_SPECIALIZE:
+            specialize = 1;
+            break;
+        case OPT_COMPACT:
+            compact = 1;
+            break;
+        case OPT_SIMD:
+            /* validate and convert instruction set */
+            simd_level = check_simd(optarg); /* io_util.c */
+            break;
         case '?':
             error("Improper Usage: %s -l lang_name -c corpus_name "
                 "-1 layout_name -2 layout2_name -w weight_name -r repetitions "
-                "-t threads -m run_mode -o output_mode -b backend_mode");
+                "-t threads -m run_mode -o output_mode -b backend_mode "
+                "[--telemetry file] [--stagnation evals] [--min-accept rate] "
+                "[--on-stagnation action] [--accept-start rate] [--accept-end rate] "
+                "[--append corpus,...] [--separator char] [--stats name] [--keyboard name] [--specialize] [--compact] [--simd isa]");
         default:
             abort();
         }
@@ -273,6 +371,8 @@ void check_setup()
     /* Ensure necessary parameters are set and have valid values. */
     if (lang_name == NULL) {error("no lang selected");}
     if (corpus_name == NULL) {error("no corpus selected");}
+    if (append_name != NULL && is_blend()) {error("--append needs a single corpus, not a blend");} /* blend.c */
+    if (append_name != NULL && corpus_from_stdin()) {error("--append needs a cached corpus, not standard input");}
     if (layout_name == NULL) {error("no layout selected");}
     if (layout2_name == NULL) {error("no layout2 selected");}
     if (weight_name == NULL) {error("no weight selected");}
@@ -291,6 +391,14 @@ void check_setup()
     }
     if (threads < 1) {error("invalid threads selected");}
     if (repetitions < threads) {error("invalid repetitions selected");}
+    if (stagnation_limit < 0) {error("invalid stagnation limit selected");}
+    if (stagnation_accept < 0 || stagnation_accept >= 1) {
+        error("invalid minimum acceptance rate selected");
+    }
+    /* the sigmoid never accepts a worse move with probability 0.5 or more */
+    if (accept_end <= 0 || accept_end >= accept_start || accept_start >= 0.5) {
+        error("invalid temperature acceptance rates selected");
+    }
 }
 
 /*
@@ -318,15 +426,18 @@ void read_lang()
 
     log_print('v',L"Reading... ");
     wchar_t a;
-    /* Read the language file character set into lang_arr. */
-    for (int i = 0; i < 101; i++) {
-        if ((a = fgetwc(lang)) == EOF || a == L'\n') {lang_arr[i] = L'@';}
+    int length = 0;
+    /* Read the first line of the language file into lang_arr, '@' pads the rest. */
+    for (int i = 0; i < LANG_FILE_LENGTH + 1; i++) {
+        if (length < i || (a = fgetwc(lang)) == WEOF || a == L'\n') {lang_arr[i] = L'@';}
         else if (a == L'@') {
             error("'@' found in lang, illegal character.");
         } else {
             lang_arr[i] = a;
+            length++;
         }
     }
+    fclose(lang);
 
     log_print('v',L"Checking correctness... ");
 
@@ -335,10 +446,18 @@ void read_lang()
         error("Lang file must begin with 2 spaces");
     }
 
-    if (lang_arr[100] != L'@') {
-        error("Lang file too long (>100 characters)");
+    if (lang_arr[LANG_FILE_LENGTH] != L'@') {
+        error("Lang file too long (>500 characters)");
     }
 
+    /*
+     * One index per pair of characters, index 0 being the invalid pair of
+     * spaces. Small languages keep the size of the original 100 character
+     * format, so their tables and caches are unchanged.
+     */
+    LANG_LENGTH = (length + 1) / 2 + 1;
+    if (LANG_LENGTH < DENSE_LANG_LENGTH) {LANG_LENGTH = DENSE_LANG_LENGTH;}
+
     /*
      * Check for duplicate characters this allows duplicate characters that are
      * side by side for of shifted pair
@@ -349,7 +468,7 @@ void read_lang()
     }
 
     /* Populate the character table for code lookups. */
-    for (int i = 0; i < 101; i++) {
+    for (int i = 0; i < LANG_FILE_LENGTH + 1; i++) {
         if (lang_arr[i] == L'@') {
             char_table[L'@'] = -1;
         } else if (lang_arr[i] < UNICODE_MAX) {
@@ -361,30 +480,48 @@ void read_lang()
 }
 
 /*
- * Attempts to read corpus data from a cache file. If the cache file exists,
- * it reads the pre-computed ngram frequencies into the global corpus arrays.
+ * Checks whether the corpus is read from standard input, selected as '-'.
+ */
+int corpus_from_stdin()
+{
+    return strcmp(corpus_name, "-") == 0;
+}
+
+/*
+ * Attempts to read corpus data from a cache file. The binary cache is read if
+ * it is valid, otherwise an old text cache is imported and converted to a
+ * binary cache for the next run.
  *
  * Returns:
- *   1 if the cache file was successfully read, 0 otherwise.
+ *   1 if a cache file was successfully read, 0 otherwise.
  */
 int read_corpus_cache()
 {
+    if (corpus_from_stdin()) {
+        log_print('v',L"Standard input is not cached... ");
+        return 0;
+    }
+    if (read_binary_cache()) {return 1;} /* cache.c */
+    /* text caches predate large languages, their counts are never sparse */
+    if (sparse_quad != NULL) {return 0;}
+    /* a stale binary cache is newer than any text cache */
+    if (source_count() > 0) {return 0;} /* cache.c */
+
     FILE *corpus;
-    /* Construct the path to the corpus cache file. */
-    char *path = (char*)malloc(strlen("./data//corpora/.cache") +
-        strlen(lang_name) + strlen(corpus_name) + 1);
-    strcpy(path, "./data/");
-    strcat(path, lang_name);
-    strcat(path, "/corpora/");
-    strcat(path, corpus_name);
-    strcat(path, ".cache");
-    corpus = fopen(path, "r");
+    /* Construct the path to the text corpus cache file. */
+    char *path = corpus_path(".cache"); /* cache.c */
+    char *text_path = source_path(corpus_name); /* cache.c */
+    struct stat cache_info, text_info;
+    int text = stat(text_path, &text_info) == 0;
+    int edited = text && stat(path, &cache_info) == 0 && text_info.st_mtime > cache_info.st_mtime;
+    free(text_path);
+    corpus = edited ? NULL : fopen(path, "r");
     if (corpus == NULL) {
         free(path);
-        log_print('v',L"Cache not found... ");
+        log_print('v',edited ? L"Text cache older than corpus... " : L"Cache not found... ");
         return 0;
     }
-    log_print('v',L"Cache found... ");
+    log_print('v',L"Text cache found... ");
     log_print('v',L"Reading cache... ");
     wchar_t curr;
     int i,j,k,l, value;
@@ -394,55 +531,55 @@ int read_corpus_cache()
         {
             case 'q':
                 fwscanf(corpus, L" %d %d %d %d %d ", &i, &j, &k, &l, &value);
-                corpus_quad[i][j][k][l] = value;
+                corpus_quad[index_quad(i, j, k, l)] = value; /* util.c */
                 break;
             case 't':
                 fwscanf(corpus, L" %d %d %d %d ", &i, &j, &k, &value);
-                corpus_tri[i][j][k] = value;
+                corpus_tri[index_tri(i, j, k)] = value; /* util.c */
                 break;
             case 'b':
                 fwscanf(corpus, L" %d %d %d ", &i, &j, &value);
-                corpus_bi[i][j] = value;
+                corpus_bi[index_bi(i, j)] = value; /* util.c */
                 break;
             case 'm':
                 fwscanf(corpus, L" %d %d ", &i, &value);
-                corpus_mono[i] = value;
+                corpus_mono[index_mono(i)] = value; /* util.c */
                 break;
             case '1':
                 fwscanf(corpus, L" %d %d %d ", &i, &j, &value);
-                corpus_skip[1][i][j] = value;
+                corpus_skip[index_skip(1, i, j)] = value; /* util.c */
                 break;
             case '2':
                 fwscanf(corpus, L" %d %d %d ", &i, &j, &value);
-                corpus_skip[2][i][j] = value;
+                corpus_skip[index_skip(2, i, j)] = value; /* util.c */
                 break;
             case '3':
                 fwscanf(corpus, L" %d %d %d ", &i, &j, &value);
-                corpus_skip[3][i][j] = value;
+                corpus_skip[index_skip(3, i, j)] = value; /* util.c */
                 break;
             case '4':
                 fwscanf(corpus, L" %d %d %d ", &i, &j, &value);
-                corpus_skip[4][i][j] = value;
+                corpus_skip[index_skip(4, i, j)] = value; /* util.c */
                 break;
             case '5':
                 fwscanf(corpus, L" %d %d %d ", &i, &j, &value);
-                corpus_skip[5][i][j] = value;
+                corpus_skip[index_skip(5, i, j)] = value; /* util.c */
                 break;
             case '6':
                 fwscanf(corpus, L" %d %d %d ", &i, &j, &value);
-                corpus_skip[6][i][j] = value;
+                corpus_skip[index_skip(6, i, j)] = value; /* util.c */
                 break;
             case '7':
                 fwscanf(corpus, L" %d %d %d ", &i, &j, &value);
-                corpus_skip[7][i][j] = value;
+                corpus_skip[index_skip(7, i, j)] = value; /* util.c */
                 break;
             case '8':
                 fwscanf(corpus, L" %d %d %d ", &i, &j, &value);
-                corpus_skip[8][i][j] = value;
+                corpus_skip[index_skip(8, i, j)] = value; /* util.c */
                 break;
             case '9':
                 fwscanf(corpus, L" %d %d %d ", &i, &j, &value);
-                corpus_skip[9][i][j] = value;
+                corpus_skip[index_skip(9, i, j)] = value; /* util.c */
                 break;
             default:
                 break;
@@ -450,130 +587,88 @@ int read_corpus_cache()
     }
     fclose(corpus);
     free(path);
+
+    /* convert so the next run can map it */
+    log_print('v',L"Converting to binary cache... ");
+    if (text) {record_source(corpus_name);} /* cache.c */
+    cache_corpus(); /* io.c */
     return 1;
 }
 
 /*
- * Reads and processes a corpus text file to collect ngram frequency data. Reads
- * the corpus character by character, updating the frequency counts in the
- * global corpus arrays for monograms, bigrams, trigrams, quadgrams,
- * and skipgrams.
+ * Reads and processes a corpus text file to collect ngram frequency data. The
+ * corpus is counted in parallel on the worker pool, updating the frequency
+ * counts in the global corpus arrays for monograms, bigrams, trigrams,
+ * quadgrams, and skipgrams. Files appended to a stale cache are recounted.
  */
 void read_corpus()
 {
-    FILE *corpus;
+    if (corpus_from_stdin()) {
+        if (!ingest_file("-")) {error("Standard input could not be read.");} /* corpus.c */
+        log_print('v',L"Standard input read... ");
+        return;
+    }
     /* Construct the path to the corpus text file. */
-    char *path = (char*)malloc(strlen("./data//corpora/.txt") +
-        strlen(lang_name) + strlen(corpus_name) + 1);
-    strcpy(path, "./data/");
-    strcat(path, lang_name);
-    strcat(path, "/corpora/");
-    strcat(path, corpus_name);
-    strcat(path, ".txt");
-    corpus = fopen(path, "r");
-    if (corpus == NULL) {
-        error("Corpus file not found, make sure the file ends in .txt, but the name in config/parameters does not");
+    char *path = source_path(corpus_name); /* cache.c */
+    if (!ingest_file(path)) { /* corpus.c */
+        error("Corpus file not found, make sure the file ends in .txt (or .txt.gz, .txt.xz, .txt.zst), but the name in config/parameters does not");
     }
-    log_print('v',L"Corpus file found... ");
-
-    /* Memory for the last 11 seen characters */
-    int mem[] = {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1};
-
-    wchar_t curr;
-    while ((curr = fgetwc(corpus)) != WEOF) {
-        /* convert characters based on the lang file */
-        mem[0] = convert_char(curr); /* io_util.c */
-        /* If character is valid in the language */
-        if (mem[0] > 0 && mem[0] < 51) {
-            corpus_mono[mem[0]]++;
-
-            /* If there is a previous character, record the bigram */
-            if (mem[1] > 0 && mem[1] < 51) {
-                corpus_bi[mem[1]][mem[0]]++;
-                /* If there are two, record the trigram */
-                if (mem[2] > 0 && mem[2] < 51) {
-                    corpus_tri[mem[2]][mem[1]][mem[0]]++;
-                    /* If there are three, record the quadgram */
-                    if (mem[3] > 0 && mem[3] < 51) {
-                        corpus_quad[mem[3]][mem[2]][mem[1]][mem[0]]++;
-                    }
-                }
-            }
-
-            /* Record skipgrams from skip-1 to skip-9 */
-            for (int i = 2; i < 11; i++)
-            {
-                if (mem[i] > 0 && mem[i] < 51)
-                {
-                    corpus_skip[i-1][mem[i]][mem[0]]++;
-                }
-            }
+    log_print('v',L"Corpus file read... ");
+    free(path);
+    record_source(corpus_name); /* cache.c */
+
+    /* recount the files appended to a stale cache, unless they are gone */
+    for (int i = 0; i < source_count(); i++) { /* cache.c */
+        const char *name = source_name(i); /* cache.c */
+        if (strcmp(name, corpus_name) == 0) {continue;}
+        path = source_path(name); /* cache.c */
+        if (ingest_file(path)) { /* corpus.c */
+            log_print('v',L"Appended %s read... ", name);
+            record_source(name); /* cache.c */
+        } else {
+            log_print('n',L"Appended %s missing, dropped... ", name);
+            drop_source(i--); /* cache.c */
         }
-        /* shift over an array one index, dropping the last value */
-        iterate(mem, 11); /* io_util.c */
+        free(path);
     }
+}
 
-    fclose(corpus);
-    free(path);
+/*
+ * Counts the text files named by --append into the corpus arrays and adds
+ * them to the cache, so new text is counted without rereading the corpus.
+ * Files already counted with the same content are skipped.
+ */
+void append_corpus()
+{
+    char *names = strdup(append_name);
+    int appended = 0;
+    for (char *name = strtok(names, ","); name != NULL; name = strtok(NULL, ",")) {
+        if (source_unchanged(name)) { /* cache.c */
+            log_print('n',L"%s already counted... ", name);
+            continue;
+        }
+        char *path = source_path(name); /* cache.c */
+        if (!ingest_file(path)) { /* corpus.c */
+            error("Appended corpus file not found, make sure the file ends in .txt (or .txt.gz, .txt.xz, .txt.zst), but the name in the parameters does not");
+        }
+        free(path);
+        log_print('n',L"%s counted... ", name);
+        record_source(name); /* cache.c */
+        appended++;
+    }
+    free(names);
+    if (appended > 0) {cache_corpus();} /* io.c */
 }
 
 /*
  * Creates or updates a cache file with the current corpus frequency data.
  * This function writes the current state of the global corpus arrays to a
- * cache file, allowing for quicker initialization in future runs.
+ * binary cache file, allowing for quicker initialization in future runs.
  */
 void cache_corpus()
 {
-    FILE *corpus;
-    /* Construct the path to the corpus cache file. */
-    char *path = (char*)malloc(strlen("./data//corpora/.cache") +
-        strlen(lang_name) + strlen(corpus_name) + 1);
-    strcpy(path, "./data/");
-    strcat(path, lang_name);
-    strcat(path, "/corpora/");
-    strcat(path, corpus_name);
-    strcat(path, ".cache");
-    corpus = fopen(path, "w");
-    if (corpus == NULL) {
-        error("Corpus cache file failed to be created.");
-    }
-    log_print('n',L"Created cache file... ");
-
-    for (int i = 0; i < 51; i++) {
-        for (int j = 0; j < 51; j++) {
-            for (int k = 0; k < 51; k++) {
-                for (int l = 0; l < 51; l++) {
-                    /* Write all quadgrams to the cache file. */
-                    if (corpus_quad[i][j][k][l] > 0) {
-                        fprintf(corpus, "q %d %d %d %d %d\n", i, j, k, l,
-                            corpus_quad[i][j][k][l]);
-                    }
-                }
-                /* Write all trigrams to the cache file. */
-                if (corpus_tri[i][j][k] > 0) {
-                    fprintf(corpus, "t %d %d %d %d\n", i, j, k,
-                        corpus_tri[i][j][k]);
-                }
-            }
-            /* Write all bigrams to the cache file. */
-            if (corpus_bi[i][j] > 0) {
-                fprintf(corpus, "b %d %d %d\n", i, j, corpus_bi[i][j]);
-            }
-            /* Write all skipgrams to the cache file. */
-            for (int skip = 1; skip < 10; skip++) {
-                if (corpus_skip[skip][i][j] > 0) {
-                    fprintf(corpus, "%d %d %d %d\n", skip, i, j,
-                        corpus_skip[skip][i][j]);
-                }
-            }
-        }
-        /* Write all monograms to the cache file. */
-        if (corpus_mono[i] > 0) {
-            fprintf(corpus, "m %d %d\n", i, corpus_mono[i]);
-        }
-    }
-    fclose(corpus);
-    free(path);
+    if (corpus_from_stdin()) {return;}
+    write_binary_cache(); /* cache.c */
 }
 
 /*
@@ -707,21 +802,31 @@ void read_weights()
  *   which_layout: An integer indicating which layout to read (1 or 2).
  */
 void read_layout(layout *lt, int which_layout)
+{
+    if (which_layout == 1) {read_named_layout(lt, layout_name);}
+    else if (which_layout == 2) {read_named_layout(lt, layout2_name);}
+    else {error("invalid layout selected to read");}
+}
+
+/*
+ * Reads and initializes a layout from the named file in the current language's
+ * layouts directory. Does not touch any globals, so it is safe to call from
+ * pool tasks.
+ *
+ * Parameters:
+ *   lt:   A pointer to the layout structure to be initialized.
+ *   name: The layout name, without the .glg extension.
+ */
+void read_named_layout(layout *lt, const char *name)
 {
     FILE *layout_file;
-    /* Construct the path to the layout file based on 'which_layout' parameter. */
+    /* Construct the path to the layout file. */
     char *path = (char*)malloc(strlen("./data//layouts/.glg")
-            + strlen(lang_name) + strlen(layout_name) + 1);
-    if (which_layout == 2) {
-        path = (char*)realloc(path, strlen("./data//layouts/.glg")
-            + strlen(lang_name) + strlen(layout2_name) + 1);
-    }
+            + strlen(lang_name) + strlen(name) + 1);
     strcpy(path, "./data/");
     strcat(path, lang_name);
     strcat(path, "/layouts/");
-    if (which_layout == 1) {strcat(path, layout_name);}
-    else if (which_layout == 2) {strcat(path, layout2_name);}
-    else {error("invalid layout selected to read");}
+    strcat(path, name);
     strcat(path, ".glg");
     layout_file = fopen(path, "r");
     if (layout_file == NULL) {
@@ -729,17 +834,20 @@ void read_layout(layout *lt, int which_layout)
     }
 
     /* Set the layout name in the layout structure. */
-    if (which_layout == 1) {strncpy(lt->name, layout_name, 60);}
-    else if (which_layout == 2) {strncpy(lt->name, layout2_name, 60);}
+    strncpy(lt->name, name, 60);
+    lt->name[60] = '\0';
 
     wchar_t curr;
     /* Read the layout matrix from the file. */
     for (int i = 0; i < ROW; i++) {
         for (int j = 0; j < COL; j++) {
             if (fwscanf(layout_file, L" %lc ", &curr) != 1) {
-                error("layout not 3x12 (fill dead-keys with @'s)");
+                error("layout does not fill the keyboard grid (fill dead-keys with @'s)");
             }
             lt->matrix[i][j] = convert_char(curr);
+            if (key_fingers[i][j] == -1 && lt->matrix[i][j] != -1) {
+                error("layout has a key where the keyboard has none (fill gaps with @'s)");
+            }
         }
     }
 
@@ -803,8 +911,9 @@ void normal_print(layout *lt)
             log_print('n',L"%s :\n    |", stats_skip[i].name);
             for (int j = 1; j <= 9; j++)
             {
-                log_print('n',L"%06.3f", lt->skip_score[j][i]);
-                log_print('n',L"%|");
+                /* distances that are not evaluated have no weight */
+                if (evaluates_distance(&stats_skip[i], j)) {log_print('n',L"%06.3f%%|", lt->skip_score[j][i]);} /* stats/skip.c */
+                else {log_print('n',L"   --  |");}
             }
             log_print('n',L"\n");
         }
@@ -36,7 +36,7 @@ int convert_char(wchar_t c)
  */
 wchar_t convert_back(int i)
 {
-    if (i < 50 && i >= 0) {
+    if (i >= 0 && i * 2 < LANG_FILE_LENGTH) {
         return lang_arr[i*2];
     }
     return L'@';
@@ -68,8 +68,8 @@ void iterate(int *mem, int size)
 int check_duplicates(wchar_t *arr)
 {
     int dups = -1;
-    for (int i = 0; i < 101; i++) {
-        for (int j = i + 2; j < 101; j++) {
+    for (int i = 0; i < LANG_FILE_LENGTH + 1; i++) {
+        for (int j = i + 2; j < LANG_FILE_LENGTH + 1; j++) {
             if (arr[i] == arr[j] && arr[i] != L'@') {
                 dups++;
             }
@@ -174,3 +174,59 @@ char check_backend_mode(char *optarg)
         return 'c';
     }
 }
+
+/*
+ * Validates and converts a stagnation action string to its corresponding
+ * character representation.
+ * Parameters:
+ *   optarg: The string representing the stagnation action.
+ * Returns: The character representing the validated stagnation action, or 'r'
+ *          if invalid.
+ */
+char check_stagnation_action(char *optarg)
+{
+    if (strcmp(optarg, "r") == 0 || strcmp(optarg, "restart") == 0) {
+        return 'r';
+    } else if (strcmp(optarg, "h") == 0 || strcmp(optarg, "reheat") == 0) {
+        return 'h';
+    } else if (strcmp(optarg, "s") == 0 || strcmp(optarg, "stop") == 0) {
+        return 's';
+    } else {
+        error("Invalid stagnation action in arguments.");
+        return 'r';
+    }
+}
+
+/*
+ * Validates and converts a word separator, given as a single character or as
+ * 'space' or 'none'.
+ * Parameters:
+ *   optarg: The string representing the separator.
+ * Returns: The code point of the separator, or 0 for none.
+ */
+int check_separator(char *optarg)
+{
+    if (strcmp(optarg, "none") == 0) {return 0;}
+    if (strcmp(optarg, "space") == 0) {return ' ';}
+    wchar_t separator[2];
+    if (mbstowcs(separator, optarg, 2) != 1) {
+        error("Invalid word separator in arguments, give one character, space or none.");
+    }
+    return separator[0];
+}
+
+/*
+ * Validates and converts the instruction set of the gather kernels.
+ * Parameters:
+ *   optarg: 'auto', 'avx512', 'avx2' or 'scalar'.
+ * Returns: 'a', '5', '2' or 's'.
+ */
+char check_simd(char *optarg)
+{
+    if (strcmp(optarg, "auto") == 0) {return 'a';}
+    if (strcmp(optarg, "avx512") == 0) {return '5';}
+    if (strcmp(optarg, "avx2") == 0) {return '2';}
+    if (strcmp(optarg, "scalar") == 0) {return 's';}
+    error("Invalid instruction set in arguments, give auto, avx512, avx2 or scalar.");
+    return 'a';
+}
@@ -8,16 +8,15 @@
 
 #include "include/structs.h"
 
-#define ROW 3
-#define COL 12
 #define DIM1 ROW * COL
 #define DIM2 DIM1 * DIM1
 #define DIM3 DIM2 * DIM1
 #define DIM4 DIM3 * DIM1
-#define LANG_LENGTH 51
 
 /*
  * Global variables accessible to the kernel, defined in mode.c: [0 - infinite]
+ * ROW, COL: [1 - MAX_ROW], [1 - MAX_COL]
+ *     Dimensions of the keyboard grid.
  * MONO_LENGTH, BI_LENGTH, TRI_LENGTH, QUAD_LENGTH, SKIP_LENGTH, META_LENGTH:
  *     Define the number of statistics for each ngram type.
  * THREADS: [1 - infinite]
@@ -28,6 +27,8 @@
  *     Maximum number of key swaps to perform in each iteration.
  * WORKERS: [Max of X_LENGTHs]
  *     Number of work items per work group.
+ * LANG_LENGTH: [2 - 51]
+ *     Characters kept after ranking plus the invalid one, the frequency arrays are dense.
  */
 
 /*
@@ -259,11 +260,15 @@ inline void swap_keys(__local cl_layout *lt, int row1, int col1, int row2, int c
  *   working: Pointer to the cl_layout being analyzed.
  *   local_id: The local ID of the work item.
  *   stats_mono: Constant pointer to the array of mono_stat structures.
+ *   ngrams: Global pointer to the ngrams of every stat, packed.
+ *   ngram_offsets: Constant pointer to the start of each stat in ngrams.
  *   linear_mono: Constant pointer to the linearized monogram frequency data.
  */
 inline void calculate_mono_stats(__local cl_layout *working,
                                  size_t local_id,
                                  __constant mono_stat *stats_mono,
+                                 __global const int *ngrams,
+                                 __constant int *ngram_offsets,
                                  __constant float *linear_mono) {
     int row0, col0;
     for (int i = local_id; i < MONO_LENGTH; i += WORKERS) {
@@ -272,7 +277,7 @@ inline void calculate_mono_stats(__local cl_layout *working,
             working->mono_score[i] = 0;
             int length = stats_mono[i].length;
             for (int j = 0; j < length; j++) {
-                int n = stats_mono[i].ngrams[j];
+                int n = ngrams[ngram_offsets[i] + j];
                 row0 = n / COL;
                 col0 = n % COL;
                 if (working->matrix[row0][col0] != -1) {
@@ -290,11 +295,15 @@ inline void calculate_mono_stats(__local cl_layout *working,
  *   working: Pointer to the cl_layout being analyzed.
  *   local_id: The local ID of the work item.
  *   stats_bi: Constant pointer to the array of bi_stat structures.
+ *   ngrams: Global pointer to the ngrams of every stat, packed.
+ *   ngram_offsets: Constant pointer to the start of each stat in ngrams.
  *   linear_bi: Constant pointer to the linearized bigram frequency data.
  */
 inline void calculate_bi_stats(__local cl_layout *working,
                                size_t local_id,
                                __constant bi_stat *stats_bi,
+                               __global const int *ngrams,
+                               __constant int *ngram_offsets,
                                __constant float *linear_bi) {
     int row0, col0, row1, col1;
     for (int i = local_id; i < BI_LENGTH; i += WORKERS) {
@@ -303,7 +312,7 @@ inline void calculate_bi_stats(__local cl_layout *working,
             working->bi_score[i] = 0;
             int length = stats_bi[i].length;
             for (int j = 0; j < length; j++) {
-                int n = stats_bi[i].ngrams[j];
+                int n = ngrams[ngram_offsets[MONO_LENGTH + i] + j];
                 row1 = (n % (DIM1)) / COL;
                 col1 = n % COL;
                 n /= (DIM1);
@@ -324,11 +333,15 @@ inline void calculate_bi_stats(__local cl_layout *working,
  *   working: Pointer to the cl_layout being analyzed.
  *   local_id: The local ID of the work item.
  *   stats_tri: Constant pointer to the array of tri_stat structures.
+ *   ngrams: Global pointer to the ngrams of every stat, packed.
+ *   ngram_offsets: Constant pointer to the start of each stat in ngrams.
  *   linear_tri: Constant pointer to the linearized trigram frequency data.
  */
 inline void calculate_tri_stats(__local cl_layout *working,
                                 size_t local_id,
                                 __constant tri_stat *stats_tri,
+                                __global const int *ngrams,
+                                __constant int *ngram_offsets,
                                 __constant float *linear_tri) {
     int row0, col0, row1, col1, row2, col2;
     for (int i = local_id; i < TRI_LENGTH; i += WORKERS) {
@@ -337,7 +350,7 @@ inline void calculate_tri_stats(__local cl_layout *working,
             working->tri_score[i] = 0;
             int length = stats_tri[i].length;
             for (int j = 0; j < length; j++) {
-                int n = stats_tri[i].ngrams[j];
+                int n = ngrams[ngram_offsets[MONO_LENGTH + BI_LENGTH + i] + j];
                 row2 = (n % (DIM1)) / COL;
                 col2 = n % COL;
                 n /= (DIM1);
@@ -361,11 +374,15 @@ inline void calculate_tri_stats(__local cl_layout *working,
  *   working: Pointer to the cl_layout being analyzed.
  *   local_id: The local ID of the work item.
  *   stats_quad: Constant pointer to the array of quad_stat structures.
+ *   ngrams: Global pointer to the ngrams of every stat, packed.
+ *   ngram_offsets: Constant pointer to the start of each stat in ngrams.
  *   linear_quad: Constant pointer to the linearized quadgram frequency data.
  */
 inline void calculate_quad_stats(__local cl_layout *working,
                                  size_t local_id,
                                  __constant quad_stat *stats_quad,
+                                 __global const int *ngrams,
+                                 __constant int *ngram_offsets,
                                  __constant float *linear_quad) {
     int row0, col0, row1, col1, row2, col2, row3, col3;
     for (int i = local_id; i < QUAD_LENGTH; i += WORKERS) {
@@ -374,7 +391,7 @@ inline void calculate_quad_stats(__local cl_layout *working,
             working->quad_score[i] = 0;
             int length = stats_quad[i].length;
             for (int j = 0; j < length; j++) {
-                int n = stats_quad[i].ngrams[j];
+                int n = ngrams[ngram_offsets[MONO_LENGTH + BI_LENGTH + TRI_LENGTH + i] + j];
                 row3 = (n % (DIM1)) / COL;
                 col3 = n % COL;
                 n /= (DIM1);
@@ -401,21 +418,26 @@ inline void calculate_quad_stats(__local cl_layout *working,
  *   working: Pointer to the cl_layout being analyzed.
  *   local_id: The local ID of the work item.
  *   stats_skip: Constant pointer to the array of skip_stat structures.
+ *   ngrams: Global pointer to the ngrams of every stat, packed.
+ *   ngram_offsets: Constant pointer to the start of each stat in ngrams.
  *   linear_skip: Constant pointer to the linearized skipgram frequency data.
  */
 inline void calculate_skip_stats(__local cl_layout *working,
                                  size_t local_id,
                                  __constant skip_stat *stats_skip,
+                                 __global const int *ngrams,
+                                 __constant int *ngram_offsets,
                                  __constant float *linear_skip) {
     int row0, col0, row1, col1;
     for (int i = local_id; i < SKIP_LENGTH; i += WORKERS) {
         if(!stats_skip[i].skip)
         {
             int length = stats_skip[i].length;
-            for (int k = 1; k <= 9; k++) {
+            for (int d = 0; d < stats_skip[i].distance_count; d++) {
+                int k = stats_skip[i].distances[d];
                 working->skip_score[k][i] = 0;
                 for (int j = 0; j < length; j++) {
-                    int n = stats_skip[i].ngrams[j];
+                    int n = ngrams[ngram_offsets[MONO_LENGTH + BI_LENGTH + TRI_LENGTH + QUAD_LENGTH + i] + j];
                     row1 = (n % (DIM1)) / COL;
                     col1 = n % COL;
                     n /= (DIM1);
@@ -512,7 +534,9 @@ __kernel void improve_kernel(__constant float *linear_mono,
                              __global layout *layouts,
                              __constant int *pins,
                              int seed,
-                             __global int *reps) {
+                             __global int *reps,
+                             __global const int *ngrams,
+                             __constant int *ngram_offsets) {
     /* Identify the work item */
     size_t global_id = get_global_id(0);
     size_t group_id = get_group_id(0);
@@ -532,7 +556,7 @@ __kernel void improve_kernel(__constant float *linear_mono,
     barrier(CLK_LOCAL_MEM_FENCE);
 
     /* Simulated Annealing Logic */
-    float T = 1000;
+    float T = START_T;
     int initial_swap_count = MAX_SWAPS;
     int swap_count;
     float max_T = T;
@@ -579,11 +603,11 @@ __kernel void improve_kernel(__constant float *linear_mono,
         barrier(CLK_LOCAL_MEM_FENCE);
 
         /* Calculate statistics */
-        calculate_mono_stats(&working, local_id, stats_mono, linear_mono);
-        calculate_bi_stats(&working, local_id, stats_bi, linear_bi);
-        calculate_tri_stats(&working, local_id, stats_tri, linear_tri);
-        calculate_quad_stats(&working, local_id, stats_quad, linear_quad);
-        calculate_skip_stats(&working, local_id, stats_skip, linear_skip);
+        calculate_mono_stats(&working, local_id, stats_mono, ngrams, ngram_offsets, linear_mono);
+        calculate_bi_stats(&working, local_id, stats_bi, ngrams, ngram_offsets, linear_bi);
+        calculate_tri_stats(&working, local_id, stats_tri, ngrams, ngram_offsets, linear_tri);
+        calculate_quad_stats(&working, local_id, stats_quad, ngrams, ngram_offsets, linear_quad);
+        calculate_skip_stats(&working, local_id, stats_skip, ngrams, ngram_offsets, linear_skip);
 
         barrier(CLK_LOCAL_MEM_FENCE);
         cl_meta_analysis(&working, local_id, stats_meta);
@@ -613,7 +637,7 @@ __kernel void improve_kernel(__constant float *linear_mono,
                 } else {
                     max_T *= 1.05;
                 }
-                max_T = max_T > 1500.0 ? 1500.0 : max_T;
+                max_T = max_T > 1.5f * START_T ? 1.5f * START_T : max_T;
                 max_T = max_T < T ? T : max_T;
                 improvement_counter = 0;
             }
@@ -633,8 +657,8 @@ __kernel void improve_kernel(__constant float *linear_mono,
 
             /* Temperature cooling */
             float progress = (float)i / (REPETITIONS / THREADS);
-            T = max_T * (1.0 - progress);
-            T = T < 1.0 ? 1.0 : T;
+            T = max_T + (END_T - max_T) * progress;
+            T = T < END_T ? END_T : T;
         }
         barrier(CLK_LOCAL_MEM_FENCE);
     }
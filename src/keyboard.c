@@ -0,0 +1,170 @@
+/*
+ * keyboard.c - Keyboard geometry for the GULAG.
+ *
+ * The grid of keys, the finger of every key and which keys are stretches are
+ * read from './data/keyboards/<name>.kbd' at start up, in place of a fixed
+ * 3x12 grid. Every stat is classified from these tables, so the stats follow
+ * the keyboard. Positions of the grid without a key are gaps: they are pinned,
+ * and no ngram touching one falls under any stat.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "keyboard.h"
+#include "util.h"
+#include "global.h"
+#include "structs.h"
+
+/* Longest line of a keyboard file. */
+#define KEYBOARD_LINE 256
+
+/*
+ * Stops with an error pointing at a line of the keyboard file.
+ * Parameters:
+ *   line: The line number, from 1.
+ *   what: What is wrong with it.
+ */
+static void keyboard_error(int line, const char *what)
+{
+    char message[160];
+    snprintf(message, sizeof(message), "Keyboard line %d: %s.", line, what);
+    error(message);
+}
+
+/*
+ * Reads the number of a 'name: number' line.
+ * Parameters:
+ *   text:  The line, without surrounding spaces.
+ *   name:  The name, including the colon.
+ *   line:  The line number, for errors.
+ *   value: Where to store the number.
+ * Returns: 1 if the line is the named one, 0 otherwise.
+ */
+static int read_value(const char *text, const char *name, int line, int *value)
+{
+    size_t length = strlen(name);
+    if (strncmp(text, name, length) != 0) {return 0;}
+    if (sscanf(text + length, " %d", value) != 1) {keyboard_error(line, "expected a number");}
+    return 1;
+}
+
+/*
+ * Reads one row of the finger or stretch grid, one character per position,
+ * spaces between them optional.
+ * Parameters:
+ *   text:     The line.
+ *   line:     The line number, for errors.
+ *   grid_row: The row of the grid.
+ *   grid:     'f' for the finger grid, 's' for the stretch grid.
+ */
+static void read_grid_row(const char *text, int line, int grid_row, char grid)
+{
+    int j = 0;
+    for (const char *c = text; *c != '\0'; c++) {
+        if (isspace((unsigned char)*c)) {continue;}
+        if (j == COL) {keyboard_error(line, "more positions than cols");}
+        if (grid == 'f') {
+            if (*c == '.') {key_fingers[grid_row][j] = -1;}
+            else if (*c >= '0' && *c <= '7') {key_fingers[grid_row][j] = *c - '0';}
+            else {keyboard_error(line, "fingers are 0 to 7, or . for no key");}
+        } else {
+            if (*c == '1') {key_stretch[grid_row][j] = 1;}
+            else if (*c == '0' || *c == '.') {key_stretch[grid_row][j] = 0;}
+            else {keyboard_error(line, "stretch positions are 1, others 0 or .");}
+        }
+        j++;
+    }
+    if (j != COL) {keyboard_error(line, "fewer positions than cols");}
+}
+
+/*
+ * Reads the keyboard geometry of './data/keyboards/<keyboard_name>.kbd',
+ * 'standard' when no keyboard is selected with --keyboard. Sets the grid
+ * dimensions, the finger and stretch of every position and the home row,
+ * pins every position without a key, and sets MAX_SWAPS from the number of
+ * keys. Must run before the stats are initialized or a layout is read.
+ */
+void read_keyboard()
+{
+    const char *name = keyboard_name != NULL ? keyboard_name : "standard";
+    char *path = (char *)malloc(strlen("./data/keyboards/.kbd") + strlen(name) + 1);
+    if (path == NULL) {error("failed to malloc keyboard path");}
+    sprintf(path, "./data/keyboards/%s.kbd", name);
+    FILE *file = fopen(path, "r");
+    free(path);
+    if (file == NULL) {error("Keyboard file not found.");}
+
+    ROW = 0;
+    COL = 0;
+    HOME_ROW = 1;
+    for (int i = 0; i < MAX_ROW; i++) {
+        for (int j = 0; j < MAX_COL; j++) {
+            key_fingers[i][j] = -1;
+            key_stretch[i][j] = 0;
+        }
+    }
+
+    char text[KEYBOARD_LINE];
+    char grid = 0;
+    int grid_row = 0;
+    int has_fingers = 0;
+    for (int line = 1; fgets(text, sizeof(text), file) != NULL; line++) {
+        if (strchr(text, '\n') == NULL && !feof(file)) {keyboard_error(line, "line too long");}
+        /* drop the comment and the surrounding spaces */
+        char *comment = strchr(text, '#');
+        if (comment != NULL) {*comment = '\0';}
+        char *start = text;
+        while (isspace((unsigned char)*start)) {start++;}
+        char *end = start + strlen(start);
+        while (end > start && isspace((unsigned char)end[-1])) {end--;}
+        *end = '\0';
+        if (*start == '\0') {continue;}
+
+        if (grid != 0) {
+            read_grid_row(start, line, grid_row, grid);
+            if (++grid_row == ROW) {grid = 0;}
+            continue;
+        }
+        if (read_value(start, "rows:", line, &ROW) || read_value(start, "cols:", line, &COL)
+            || read_value(start, "home:", line, &HOME_ROW)) {
+            continue;
+        }
+        if (strcmp(start, "fingers:") == 0 || strcmp(start, "stretch:") == 0) {
+            if (ROW < 1 || ROW > MAX_ROW || COL < 1 || COL > MAX_COL) {
+                keyboard_error(line, "rows and cols come before the grids, at most 8 rows of 16");
+            }
+            grid = start[0];
+            grid_row = 0;
+            has_fingers |= grid == 'f';
+            continue;
+        }
+        keyboard_error(line, "expected rows:, cols:, home:, fingers: or stretch:");
+    }
+    fclose(file);
+    if (grid != 0) {error("Keyboard file ends inside a grid.");}
+    if (!has_fingers) {error("Keyboard file has no fingers: grid.");}
+    if (HOME_ROW < 0 || HOME_ROW >= ROW) {error("Keyboard home row is outside the grid.");}
+
+    /* gaps are pinned so no key is ever moved into one */
+    KEY_COUNT = 0;
+    for (int i = 0; i < ROW; i++) {
+        for (int j = 0; j < COL; j++) {
+            if (key_fingers[i][j] >= 0) {
+                KEY_COUNT++;
+            } else {
+                key_stretch[i][j] = 0;
+                pins[i][j] = 1;
+            }
+        }
+    }
+    if (KEY_COUNT < 2) {error("Keyboard has fewer than two keys.");}
+
+    DIM1 = ROW * COL;
+    DIM2 = DIM1 * DIM1;
+    DIM3 = DIM2 * DIM1;
+    DIM4 = DIM3 * DIM1;
+    MAX_SWAPS = KEY_COUNT / 2;
+}
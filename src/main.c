@@ -11,6 +11,13 @@
 #include "util.h"
 #include "mode.h"
 #include "stats.h"
+#include "pool.h"
+#include "blend.h"
+#include "cache.h"
+#include "keyboard.h"
+#include "scorer.h"
+#include "alphabet.h"
+#include "gather.h"
 
 #define UNICODE_MAX 65535
 
@@ -18,7 +25,7 @@
 void start_up()
 {
     /* Hide cursor. */
-    log_print('n',L"1/3: Hiding cursor... ");
+    log_print('n',L"1/2: Hiding cursor... ");
     wprintf(L"\e[?25l");
 
     /* Seed random number generator. */
@@ -27,74 +34,13 @@ void start_up()
     log_print('n',L"Done\n\n");
 
     /* Allocate language array. */
-    log_print('n',L"2/3: Allocating language array... ");
-    lang_arr = (wchar_t *)calloc(101, sizeof(wchar_t));
+    log_print('n',L"2/2: Allocating language array... ");
+    lang_arr = (wchar_t *)calloc(LANG_FILE_LENGTH + 1, sizeof(wchar_t));
 
     /* Allocate character hash table array. */
     log_print('n',L"Allocating character hashmap... ");
     char_table = (int *)calloc(UNICODE_MAX+1, sizeof(int));
     log_print('n',L"Done\n\n");
-
-    /* Allocate arrays for ngrams directly from corpus. */
-    log_print('n',L"3/3: Allocating corpus arrays...\n");
-    log_print('v',L"     Monograms... Integer... ");
-    corpus_mono = (int *)calloc(LANG_LENGTH, sizeof(int));
-    log_print('v',L"Floating Point... ");
-    linear_mono = (float *)calloc(LANG_LENGTH, sizeof(float));
-    log_print('v',L"Done\n");
-
-    log_print('v',L"     Bigrams... Integer... ");
-    corpus_bi = (int **)malloc(LANG_LENGTH * sizeof(int *));
-    for (int i = 0; i < LANG_LENGTH; i++) {
-        corpus_bi[i] = (int *)calloc(LANG_LENGTH, sizeof(int));
-    }
-    log_print('v',L"Floating Point... ");
-    linear_bi = (float *)calloc(LANG_LENGTH * LANG_LENGTH, sizeof(float));
-    log_print('v',L"Done\n");
-
-    log_print('v',L"     Trigrams... Integer... ");
-    corpus_tri = (int ***)malloc(LANG_LENGTH * sizeof(int **));
-    for (int i = 0; i < LANG_LENGTH; i++) {
-        corpus_tri[i] = (int **)malloc(LANG_LENGTH * sizeof(int *));
-        for (int j = 0; j < LANG_LENGTH; j++) {
-            corpus_tri[i][j] = (int *)calloc(LANG_LENGTH, sizeof(int));
-        }
-    }
-    log_print('v',L"Floating Point... ");
-    linear_tri = (float *)calloc(LANG_LENGTH * LANG_LENGTH * LANG_LENGTH, sizeof(float));
-    log_print('v',L"Done\n");
-
-    log_print('v',L"     Quadgrams... Integer... ");
-    corpus_quad = (int ****)malloc(LANG_LENGTH * sizeof(int ***));
-    for (int i = 0; i < LANG_LENGTH; i++) {
-        corpus_quad[i] = (int ***)malloc(LANG_LENGTH * sizeof(int **));
-        for (int j = 0; j < LANG_LENGTH; j++) {
-            corpus_quad[i][j] = (int **)malloc(LANG_LENGTH * sizeof(int *));
-            for (int k = 0; k < LANG_LENGTH; k++) {
-                corpus_quad[i][j][k] = (int *)calloc(LANG_LENGTH, sizeof(int));
-            }
-        }
-    }
-    log_print('v',L"Floating Point... ");
-    linear_quad = (float *)calloc(LANG_LENGTH * LANG_LENGTH * LANG_LENGTH * LANG_LENGTH, sizeof(float));
-    log_print('v',L"Done\n");
-
-    log_print('v',L"     Skipgrams...\n");
-    corpus_skip = (int ***)malloc(10 * sizeof(int **));
-    for (int i = 1; i <= 9; i++) {
-        log_print('v',L"       Skip-%d... Integer... ", i);
-        corpus_skip[i] = (int **)malloc(LANG_LENGTH * sizeof(int *));
-        for (int j = 0; j < LANG_LENGTH; j++) {
-            corpus_skip[i][j] = (int *)calloc(LANG_LENGTH, sizeof(int));
-        }
-        log_print('v',L"Done\n");
-    }
-    log_print('v',L"       Floating Point... ");
-    linear_skip = (float *)calloc(10 * LANG_LENGTH * LANG_LENGTH, sizeof(float));
-    log_print('v',L"Done\n");
-
-
-    log_print('n',L"     Done\n\n");
 }
 
 /* Performs cleanup: shows the cursor and frees allocated memory. */
@@ -104,6 +50,10 @@ void shut_down()
     log_print('n',L"1/3: Showing cursor... ");
     wprintf(L"\e[?25h");
 
+    /* Stop the worker pool. */
+    log_print('n',L"Stopping worker pool... ");
+    destroy_pool(); /* pool.c */
+
     /* Free language array. */
     log_print('n',L"Freeing lang array... ");
     free(lang_arr);
@@ -113,59 +63,19 @@ void shut_down()
     free(char_table);
     log_print('n',L"Done\n\n");
 
-    /* Free arrays for ngrams directly from corpus. */
+    /* Free arrays for ngrams, the raw counts may already be gone. */
     log_print('n',L"2/3: Freeing corpus arrays... ");
-    log_print('v',L"\n     Monograms... ");
-    free(corpus_mono);
+    free_corpus(); /* util.c */
+    release_linear_cache(); /* cache.c */
     free(linear_mono);
-    log_print('v',L"Done\n");
-
-    log_print('v',L"     Bigrams... ");
-    for (int i = 0; i < LANG_LENGTH; i++) {
-        free(corpus_bi[i]);
-    }
-    free(corpus_bi);
     free(linear_bi);
-    log_print('v',L"Done\n");
-
-    log_print('v',L"     Trigrams... ");
-    for (int i = 0; i < LANG_LENGTH; i++) {
-        for (int j = 0; j < LANG_LENGTH; j++) {
-            free(corpus_tri[i][j]);
-        }
-        free(corpus_tri[i]);
-    }
-    free(corpus_tri);
     free(linear_tri);
-    log_print('v',L"Done\n");
-
-    log_print('v',L"     Quadgrams... ");
-    for (int i = 0; i < LANG_LENGTH; i++) {
-        for (int j = 0; j < LANG_LENGTH; j++) {
-            for (int k = 0; k < LANG_LENGTH; k++) {
-                free(corpus_quad[i][j][k]);
-            }
-            free(corpus_quad[i][j]);
-        }
-        free(corpus_quad[i]);
-    }
-    free(corpus_quad);
     free(linear_quad);
-    log_print('v',L"Done\n");
-
-    log_print('v',L"     Skipgrams...\n");
-    for (int i = 1; i <= 9; i++) {
-        log_print('v',L"       Skip-%d... ", i);
-        for (int j = 0; j < LANG_LENGTH; j++) {
-            free(corpus_skip[i][j]);
-        }
-        free(corpus_skip[i]);
-        log_print('v',L"Done\n");
-    }
-    free(corpus_skip);
     free(linear_skip);
-    log_print('v',L"       Done\n");
-    log_print('n',L"     Done\n\n");
+    free_sparse(sparse_tri); /* sparse.c */
+    free_sparse(sparse_quad); /* sparse.c */
+    free_sparse(sparse_skip); /* sparse.c */
+    log_print('n',L"Done\n\n");
 
     /* frees all stats */
     log_print('n',L"3/3: Freeing stats... ");
@@ -219,20 +129,30 @@ int main(int argc, char **argv) {
 
 //log_print('q',L"----- Setting Up -----\n\n");
     /* holds defaults to be overwritten by args */
-    log_print('q',L"1/3: Reading config... ");
+    log_print('q',L"1/5: Reading config... ");
     read_config(); /* io.c */
     log_print('q',L"Done\n\n");
 
     /* overwrites config */
-    log_print('q',L"2/3: Reading command line arguments... ");
+    log_print('q',L"2/5: Reading command line arguments... ");
     read_args(argc, argv); /* io.c */
     log_print('q',L"Done\n\n");
 
     /* final check that all options are correct */
-    log_print('q',L"3/3: Checking arguments... ");
+    log_print('q',L"3/5: Checking arguments... ");
     check_setup(); /* io.c */
     log_print('q',L"Done\n\n");
 
+    /* grid and fingers every stat is classified from */
+    log_print('q',L"4/5: Reading keyboard... ");
+    read_keyboard(); /* keyboard.c */
+    log_print('q',L"Done\n\n");
+
+    /* persistent workers shared by every mode */
+    log_print('q',L"5/5: Starting worker pool... ");
+    create_pool(threads); /* pool.c */
+    log_print('q',L"Done\n\n");
+
     clock_gettime(CLOCK_MONOTONIC, &end);
     elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
 //log_print('q',L"----- Set Up Complete : %.9lf seconds -----\n\n", elapsed);
@@ -253,6 +173,7 @@ int main(int argc, char **argv) {
     log_print('n',L"Primary Layout   :    %s\n", layout_name);
     log_print('n',L"Secondary Layout :    %s\n", layout2_name);
     log_print('n',L"Weights File     :    %s\n", weight_name);
+    log_print('n',L"Keyboard         :    %s\n", keyboard_name != NULL ? keyboard_name : "standard");
     log_print('n',L"Run Mode         :    %c\n", run_mode);
     log_print('n',L"Repetitions      :    %d\n", repetitions);
     log_print('n',L"Threads          :    %d\n", threads);
@@ -295,37 +216,77 @@ int main(int argc, char **argv) {
 //log_print('q',L"----- Reading Data -----\n\n");
 
     /* read language file and fill array */
-    log_print('n',L"1/4: Reading language... ");
+    log_print('n',L"1/5: Reading language... ");
     read_lang(lang_name); /* io.c */
     log_print('n',L"Done\n\n");
 
     /* read from cache if it exists */
-    log_print('n',L"2/4: Reading corpus... ");
-    log_print('v',L"Finding cache... ");
     int corpus_cache = 0;
-    corpus_cache = read_corpus_cache(); /* io.c */
-    log_print('n',L"Done\n\n");
+    int normalized = 0;
+    if (is_blend()) { /* blend.c */
+        /* a blend is read already normalized */
+        log_print('n',L"2/5: Blending corpora... ");
+        /* the size of the corpus arrays depends on the language */
+        log_print('v',L"Allocating corpus arrays... ");
+        alloc_corpus(); /* util.c */
+        read_blend(); /* blend.c */
+        corpus_cache = 1;
+        normalized = 1;
+        log_print('n',L"Done\n\n");
+    } else {
+        log_print('n',L"2/5: Reading corpus... ");
+        log_print('v',L"Finding normalized cache... ");
+        normalized = read_normalized_cache(); /* cache.c */
+        if (normalized) {
+            /* the counts are never needed */
+            log_print('v',L"Normalized cache found... ");
+            corpus_cache = 1;
+        } else {
+            log_print('v',L"Allocating corpus arrays... ");
+            alloc_corpus(); /* util.c */
+            log_print('v',L"Finding cache... ");
+            corpus_cache = read_corpus_cache(); /* io.c */
+        }
+        log_print('n',L"Done\n\n");
+    }
     if (!corpus_cache) {
         /* The next operation is slow so we want to let the user see
            what step they are stuck on. */
         /* read entire corpus file and fill arrays */
-        log_print('n',L"     2.3/4: Reading raw corpus... ");
+        log_print('n',L"     2.3/5: Reading raw corpus... ");
         read_corpus(); /* io.c */
         log_print('n',L"Done\n\n");
 
         /* create new corpus cache */
-        log_print('n',L"     2.6/4: Creating corpus cache... ");
+        log_print('n',L"     2.6/5: Creating corpus cache... ");
         cache_corpus(); /* io.c */
         log_print('n',L"Done\n\n");
     }
+    if (append_name != NULL) {
+        /* count new text into the cached corpus */
+        log_print('n',L"     2.8/5: Appending to corpus... ");
+        append_corpus(); /* io.c */
+        log_print('n',L"Done\n\n");
+    }
 
     /* take corpus arrays from raw frequencies to percentages */
-    log_print('n',L"3/4: Normalize corpus... ");
-    normalize_corpus(); /* util.c */
+    log_print('n',L"3/5: Normalize corpus... ");
+    if (!normalized) {
+        normalize_corpus(); /* util.c */
+        /* the next run maps the normalized tables instead */
+        write_normalized_cache(); /* cache.c */
+    }
+    /* only the normalized arrays are used from here on */
+    free_corpus(); /* util.c */
+    log_print('n',L"Done\n\n");
+
+    /* number the characters by frequency, dropping unused ones with --compact */
+    log_print('n',L"4/5: Ranking characters... ");
+    remap_alphabet(); /* alphabet.c */
     log_print('n',L"Done\n\n");
 
     /* read weights and fill in stats*/
-    log_print('n',L"4/4: Reading stat weights... ");
+    log_print('n',L"5/5: Reading stat weights... ");
     read_weights(); /* io.c */
     log_print('n',L"Done\n\n");
 
@@ -348,10 +309,23 @@ int main(int argc, char **argv) {
 //log_print('q',L"----- Cleaning Up -----\n\n");
 
     /* remove stats with 0 length or weight */
-    log_print('n',L"1/1: Removing irrelevant stats... ");
+    log_print('n',L"1/%d: Removing irrelevant stats... ", specialize ? 3 : 2);
     clean_stats(); /* stats.c */
     log_print('n',L"     Done\n\n");
 
+    /* decode what is left for the gather kernels */
+    log_print('n',L"2/%d: Decoding ngrams... ", specialize ? 3 : 2);
+    prepare_gather(); /* gather.c */
+    log_print('n',L"Done\n\n");
+
+    /* fold the cleaned stats and the weights into a compiled scorer */
+    if (specialize)
+    {
+        log_print('n',L"3/3: Specializing the scorer... ");
+        build_scorer(); /* scorer.c */
+        log_print('n',L"Done\n\n");
+    }
+
     clock_gettime(CLOCK_MONOTONIC, &end);
     elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
 //log_print('q',L"----- Clean Up Complete : %.9lf seconds -----\n\n", elapsed);
@@ -515,6 +489,11 @@ int main(int argc, char **argv) {
     free(layout_name);
     free(layout2_name);
     free(weight_name);
+    free(telemetry_name);
+    free(custom_stats_name);
+    free(keyboard_name);
+    free_scorer(); /* scorer.c */
+    free_gather(); /* gather.c */
 
     /* reverse start_up */
     shut_down();
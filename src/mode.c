@@ -2,8 +2,9 @@
  * mode.c - Modes for the GULAG.
  *
  * This file implements the various modes of operation for the GULAG: analysis,
- * comparison, ranking, generation, and improvement. It utilizes multithreading
- * to enhance performance, specifically in the layout improvement process.
+ * comparison, ranking, generation, and improvement. Parallel work is submitted
+ * to the persistent worker pool (pool.c), specifically the layout improvement
+ * process and the analysis of multiple layouts.
  */
 
 #include <stdio.h>
@@ -11,22 +12,70 @@
 #include <wchar.h>
 #include <dirent.h>
 #include <string.h>
-#include <pthread.h>
 #include <math.h>
 #include <unistd.h>
 #include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 #include <CL/cl.h>
 
 #include "mode.h"
+#include "pool.h"
+#include "telemetry.h"
 #include "stats_util.h"
 #include "util.h"
 #include "io_util.h"
 #include "io.h"
 #include "analyze.h"
+#include "gather.h"
 #include "global.h"
 #include "structs.h"
 
+/*
+ * Pool task that analyzes and scores one layout.
+ *
+ * Parameters:
+ *   arg: A pointer to the layout to analyze.
+ */
+static void analyze_task(void *arg)
+{
+    layout *lt = (layout *)arg;
+    single_analyze(lt); /* analyze.c */
+    get_score(lt); /* util.c */
+}
+
+/* Layout slot used by rank() to analyze every layout file on the pool. */
+typedef struct rank_task {
+    char name[61];
+    layout *lt;
+} rank_task;
+
+/* Group of rank() layouts analyzed as one batch by a pool task. */
+typedef struct rank_group {
+    rank_task *tasks;
+    int count;
+} rank_group;
+
+/*
+ * Pool task that reads, analyzes, and scores a group of layout files for
+ * rank(), as one batch.
+ *
+ * Parameters:
+ *   arg: A pointer to a rank_group structure.
+ */
+static void rank_group_task(void *arg)
+{
+    rank_group *group = (rank_group *)arg;
+    layout *batch[BATCH_MAX];
+    for (int i = 0; i < group->count; i++) {
+        read_named_layout(group->tasks[i].lt, group->tasks[i].name); /* io.c */
+        batch[i] = group->tasks[i].lt;
+    }
+    batch_analyze(batch, group->count); /* analyze.c */
+    for (int i = 0; i < group->count; i++) {get_score(batch[i]);} /* util.c */
+}
+
 /*
  * Performs analysis on a single layout. This involves allocating memory for the
  * layout, reading layout data from a file, analyzing the layout, calculating
@@ -108,20 +157,17 @@ void compare() {
 
     clock_gettime(CLOCK_MONOTONIC, &compute_start);
 
-    /* perform layout analyses */
+    /* perform layout analyses on the pool */
     log_print('n',L"3/7: Analyzing layout... ");
-    single_analyze(lt1); /* analyze.c */
+    pool_submit(analyze_task, lt1); /* pool.c */
     log_print('n',L"%s... ", layout_name);
-    single_analyze(lt2); /* analyze.c */
+    pool_submit(analyze_task, lt2); /* pool.c */
     log_print('n',L"%s... ", layout2_name);
     log_print('n',L"Done\n\n");
 
-    /* calculate the overall scores */
+    /* wait for the overall scores */
     log_print('n',L"4/7: Calculating Score... ");
-    get_score(lt1); /* util.c */
-    log_print('n',L"%s... ", layout_name);
-    get_score(lt2); /* util.c */
-    log_print('n',L"%s... ", layout2_name);
+    pool_wait(); /* pool.c */
     log_print('n',L"Done\n\n");
 
     clock_gettime(CLOCK_MONOTONIC, &compute_end);
@@ -170,63 +216,70 @@ void rank() {
     DIR *dir = opendir(path);
     if (dir == NULL) {error("Error opening layouts directory");}
 
-    /* Free layout_name since it will be reallocated for each layout */
-    free(layout_name);
+    /* Collect every .glg file so they can be analyzed on the pool */
+    int capacity = 16;
+    int count = 0;
+    rank_task *tasks = (rank_task *)malloc(sizeof(rank_task) * capacity);
 
     /* Iterate over each entry in the directory */
     struct dirent *entry;
     while ((entry = readdir(dir)) != NULL) {
         /* Check if the entry is a .glg file */
         if (strstr(entry->d_name, ".glg") != NULL) {
-            /* Extract the layout name */
-            int len = strlen(entry->d_name);
-            char temp_name[len - 3];
-            strncpy(temp_name, entry->d_name, len - 4);
-            temp_name[len - 4] = '\0';
-            layout_name = temp_name;
-            log_print('n',L"%s: ", layout_name);
+            if (count == capacity) {
+                capacity *= 2;
+                tasks = (rank_task *)realloc(tasks, sizeof(rank_task) * capacity);
+            }
 
-            layout *lt;
+            /* Extract the layout name */
+            int len = strlen(entry->d_name) - 4;
+            if (len > 60) {len = 60;}
+            strncpy(tasks[count].name, entry->d_name, len);
+            tasks[count].name[len] = '\0';
 
             /* allocate memory for a layout */
-            log_print('n',L"Allocating... ");
-            alloc_layout(&lt); /* util.c */
-
-            /* read the keyboard layout */
-            log_print('n',L"Reading... ");
-            read_layout(lt, 1); /* io.c */
-
-            /* perform a single layout analysis */
-            log_print('n',L"Analyzing... ");
-            single_analyze(lt); /* analyze.c */
-
-            /* calculate the overall score */
-            log_print('n',L"Get Score... ");
-            get_score(lt); /* util.c */
-
-            /*
-             * create a new node for the layout ranking list and insert it in
-             * the correct position
-             */
-            log_print('n',L"Ranking...");
-            create_node(lt); /* util.c */
-
-            /* frees the memory occupied by a layout data structure */
-            log_print('n',L"Freeing... ");
-            free_layout(lt); /* util.c */
-            log_print('n',L"Done\n");
-            layouts_analyzed++;
+            alloc_layout(&tasks[count].lt); /* util.c */
+            count++;
         }
     }
+
+    /* read, analyze, and score each batch of layouts on the pool */
+    log_print('n',L"Analyzing %d layouts... ", count);
+    int group_count = (count + batch_lanes - 1) / batch_lanes;
+    rank_group *groups = (rank_group *)malloc(sizeof(rank_group) * (group_count > 0 ? group_count : 1));
+    for (int g = 0; g < group_count; g++) {
+        groups[g].tasks = tasks + g * batch_lanes;
+        groups[g].count = count - g * batch_lanes < batch_lanes ? count - g * batch_lanes : batch_lanes;
+        pool_submit(rank_group_task, &groups[g]); /* pool.c */
+    }
+    pool_wait(); /* pool.c */
+    free(groups);
+    log_print('n',L"Done\n");
+
+    for (int i = 0; i < count; i++) {
+        log_print('n',L"%s: ", tasks[i].name);
+
+        /*
+         * create a new node for the layout ranking list and insert it in
+         * the correct position
+         */
+        log_print('n',L"Ranking... ");
+        create_node(tasks[i].lt); /* util.c */
+
+        /* frees the memory occupied by a layout data structure */
+        log_print('n',L"Freeing... ");
+        free_layout(tasks[i].lt); /* util.c */
+        log_print('n',L"Done\n");
+        layouts_analyzed++;
+    }
     log_print('n',L"\n");
 
     /* print the ranked list of layouts */
     print_ranking(); /* io.c */
     log_print('q',L"Done\n\n");
 
-    /* Reset layout_name to a safe state */
-    layout_name = (char *)malloc(1);
     closedir(dir);
+    free(tasks);
     free(path);
 
     /* free all nodes in the layout ranking list */
@@ -236,28 +289,143 @@ void rank() {
     elapsed_compute_time += (compute_end.tv_sec - compute_start.tv_sec) + (compute_end.tv_nsec - compute_start.tv_nsec) / 1e9;
 }
 
+/* Moves sampled from the starting layout to calibrate each temperature. */
+#define CALIBRATION_SAMPLES 100
+
+/*
+ * Swaps random pairs of unpinned keys.
+ *
+ * Parameters:
+ *   lt:    The layout to modify.
+ *   count: The number of swaps to perform.
+ */
+static void random_swaps(layout *lt, int count)
+{
+    for (int j = 0; j < count; j++) {
+        int row1, col1, row2, col2;
+        do {
+            row1 = rand() % ROW;
+            col1 = rand() % COL;
+            row2 = rand() % ROW;
+            col2 = rand() % COL;
+        } while (pins[row1][col1] || pins[row2][col2] || (row1 == row2 && col1 == col2));
+        int temp = lt->matrix[row1][col1];
+        lt->matrix[row1][col1] = lt->matrix[row2][col2];
+        lt->matrix[row2][col2] = temp;
+    }
+}
+
+/*
+ * Finds the temperature at which the sigmoid acceptance rule accepts, on
+ * average, the given fraction of the sampled worsening moves.
+ *
+ * Parameters:
+ *   deltas: The magnitudes of the sampled worsening score deltas.
+ *   count:  The number of deltas.
+ *   target: The desired acceptance rate, between 0 and 0.5.
+ * Returns: The temperature, found by bisection in log space.
+ */
+static float solve_temperature(float *deltas, int count, float target)
+{
+    double low = log(1e-6), high = log(1e9);
+    for (int step = 0; step < 100; step++) {
+        double mid = (low + high) / 2;
+        double T = exp(mid);
+        double rate = 0;
+        for (int i = 0; i < count; i++) {rate += 1.0 / (1.0 + exp(10 * deltas[i] / T));}
+        rate /= count;
+        /* acceptance grows with temperature */
+        if (rate < target) {low = mid;} else {high = mid;}
+    }
+    return (float)exp((low + high) / 2);
+}
+
+/*
+ * Calibrates the annealing schedule to the score scale of the current weights.
+ * Random moves are sampled from the starting layout, the start temperature is
+ * set so that moves of MAX_SWAPS swaps are accepted at 'accept_start', and the
+ * end temperature so that single swaps are accepted at 'accept_end'.
+ *
+ * Parameters:
+ *   lt:      The analyzed and scored starting layout.
+ *   start_T: Where to store the initial temperature.
+ *   end_T:   Where to store the final temperature.
+ */
+static void calibrate_temperature(layout *lt, float *start_T, float *end_T)
+{
+    /* the samples are drawn in order and scored a batch at a time */
+    layout *samples[BATCH_MAX];
+    for (int b = 0; b < batch_lanes; b++) {alloc_layout(&samples[b]);} /* util.c */
+    float starts[CALIBRATION_SAMPLES], ends[CALIBRATION_SAMPLES];
+    int start_count = 0, end_count = 0;
+
+    for (int first = 0; first < 2 * CALIBRATION_SAMPLES; first += batch_lanes) {
+        int count = 2 * CALIBRATION_SAMPLES - first < batch_lanes ? 2 * CALIBRATION_SAMPLES - first : batch_lanes;
+        for (int b = 0; b < count; b++) {
+            /* first half samples the opening moves, second half the closing ones */
+            copy(samples[b], lt); /* util.c */
+            random_swaps(samples[b], first + b < CALIBRATION_SAMPLES ? MAX_SWAPS : 1);
+        }
+        batch_analyze(samples, count); /* analyze.c */
+        for (int b = 0; b < count; b++) {
+            get_score(samples[b]); /* util.c */
+            /* improving moves are always accepted, neutral ones always at 0.5 */
+            float delta = lt->score - samples[b]->score;
+            if (delta <= 0) {continue;}
+            if (first + b < CALIBRATION_SAMPLES) {starts[start_count++] = delta;} else {ends[end_count++] = delta;}
+        }
+    }
+    layouts_analyzed += 2 * CALIBRATION_SAMPLES;
+    for (int b = 0; b < batch_lanes; b++) {free_layout(samples[b]);} /* util.c */
+
+    /* fall back to the historic schedule if no move made the layout worse */
+    *start_T = start_count > 0 ? solve_temperature(starts, start_count, accept_start) : 1000.0;
+    *end_T = end_count > 0 ? solve_temperature(ends, end_count, accept_end) : 1.0;
+    if (*end_T > *start_T) {*end_T = *start_T;}
+}
+
+/* Number of epochs each thread is expected to claim from the shared counter. */
+#define EPOCHS_PER_THREAD 50
+
+/* Best layout found by any thread, restarts after stagnation begin from it. */
+typedef struct shared_best {
+    pthread_mutex_t lock;
+    layout *lt;
+} shared_best;
+
 /* Structure to hold data for each thread in the layout improvement process. */
 typedef struct thread_data {
     layout *lt;
     layout **best_lt;
+    /* expected iterations per thread, sets the cooling and reheating periods */
     int iterations;
+    /* shared work counter, epochs of 'epoch' iterations are claimed from it */
+    atomic_llong *next_iteration;
+    long long total;
+    int epoch;
+    /* threads still claiming epochs, the last one never stops early */
+    atomic_int *active;
+    /* calibrated temperature schedule */
+    float start_T;
+    float end_T;
+    shared_best *global_best;
     int thread_id;
 } thread_data;
 
 /*
- * Function executed by each thread to improve a layout. It performs simulated
- * annealing to find a layout with a better score.
+ * Pool task executed for each thread to improve a layout. It performs simulated
+ * annealing to find a layout with a better score, and stores the best layout
+ * found in data->best_lt.
  *
  * Parameters:
  *   arg: A pointer to a thread_data structure.
- *
- * Returns: A pointer to the best layout found by the thread.
  */
-void *thread_function(void *arg) {
+static void thread_function(void *arg) {
     thread_data *data = (thread_data *)arg;
     layout *lt = data->lt;
     int iterations = data->iterations;
     int thread_id = data->thread_id;
+    long long total = data->total;
 
     /* Allocate max and working layouts */
     layout *max_lt, *working_lt;
@@ -278,12 +446,22 @@ void *thread_function(void *arg) {
     /* copies the layout */
     copy(max_lt, working_lt); /* util.c */
 
+    /* Progress counters sampled by the reporter thread (telemetry.c) */
+    thread_counters *counters = get_counters(thread_id);
+    long long accepts = 0;
+    long long improvements = 0;
+    float best_score = max_lt->score;
+    atomic_store_explicit(&counters->best_score, best_score, memory_order_relaxed);
+
     /* Simulated annealing with enhancements */
-    struct timespec start, current;
-    clock_gettime(CLOCK_MONOTONIC, &start);
 
-    /* Initial temperature */
-    float T = 1000.0;
+    /* Initial temperature, calibrated to the weights */
+    float T = data->start_T;
+    float end_T = data->end_T;
+    /* Upper bound of max_T, half again the start as 1500 was to 1000 */
+    float ceiling_T = 1.5 * T;
+    /* Bound in effect, raised by every repeated stagnation when reheating */
+    float top_T = ceiling_T;
     int reheating_count = 0;
     /* Starting number of swaps */
     int initial_swap_count = MAX_SWAPS;
@@ -294,139 +472,195 @@ void *thread_function(void *arg) {
     /* For adaptive cooling */
     int improvement_counter = 0;
 
-    if (thread_id == 0) {log_print('n',L"Done\n\n");}
-    if (thread_id == 0) {log_print('n',L"6/9: Waiting for threads to complete... \n");}
-
-    for (int i = 0; i < iterations; i++) {
-        /* Temperature-dependent swap count */
-        swap_count = (int)(initial_swap_count * (T / max_T));
-        swap_count = swap_count < 1 ? 1 : swap_count;
-        swap_count = swap_count > initial_swap_count ? initial_swap_count : swap_count;
-
-        /* Store the swaps for potential reversal */
-        int swap_rows1[swap_count];
-        int swap_cols1[swap_count];
-        int swap_rows2[swap_count];
-        int swap_cols2[swap_count];
-
-        /* Perform the swaps */
-        for (int j = 0; j < swap_count; j++) {
-            int row1, col1, row2, col2;
-            do {
-                row1 = rand() % ROW;
-                col1 = rand() % COL;
-                row2 = rand() % ROW;
-                col2 = rand() % COL;
-            } while (pins[row1][col1] || pins[row2][col2] || (row1 == row2 && col1 == col2));
-
-            /* Store swap locations for BOTH positions */
-            swap_rows1[j] = row1;
-            swap_cols1[j] = col1;
-            swap_rows2[j] = row2;
-            swap_cols2[j] = col2;
-
-            /* Perform the swap */
-            int temp = working_lt->matrix[row1][col1];
-            working_lt->matrix[row1][col1] = working_lt->matrix[row2][col2];
-            working_lt->matrix[row2][col2] = temp;
-        }
-
-        /* analyze the new layout */
-        single_analyze(working_lt); /* analyze.c */
-        /* calculates the new score */
-        get_score(working_lt); /* util.c */
-
-        /* Exponentiate the score difference for acceptance probability (using sigmoid) */
-        float delta_score = working_lt->score - max_lt->score;
-        if (delta_score > 0 || (1.0 / (1.0 + exp(-10 * delta_score / T))) > random_float()) {
-            /* copy the new layout if it passes */
-            copy(max_lt, working_lt); /* util.c */
-            /* Increment improvement counter */
-            improvement_counter++;
-        } else {
-            /* Revert the swaps in reverse order if it fails */
-            for (int j = swap_count - 1; j >= 0; j--) {
-                int row1 = swap_rows1[j];
-                int col1 = swap_cols1[j];
-                int row2 = swap_rows2[j];
-                int col2 = swap_cols2[j];
-
-                /* Perform the reverse swap */
+    /* For stagnation detection */
+    long long last_improvement = 0;
+    int stagnations = 0;
+    int running = 1;
+    /* Global iteration the linear schedule cools from, moved by reheats */
+    long long origin = 0;
+    /* analyses done outside of the iterations, by restarts */
+    long long extra_analyses = 0;
+
+    /* Periods of the schedule, measured in this thread's own iterations */
+    int cooling_period = iterations / 20 > 0 ? iterations / 20 : 1;
+    int reheat_period = iterations / 10 > 0 ? iterations / 10 : 1;
+    int jolt_period = iterations / 50 > 0 ? iterations / 50 : 1;
+
+    /*
+     * Iterations are claimed an epoch at a time from a shared counter, so
+     * faster threads do more of the work and none of it is lost to rounding.
+     * 'i' counts this thread's iterations, 'g' is the global position that
+     * drives the cooling schedule.
+     */
+    long long i = 0;
+    long long epoch_start;
+    while (running && (epoch_start = atomic_fetch_add(data->next_iteration, data->epoch)) < total) {
+        long long epoch_end = epoch_start + data->epoch < total ? epoch_start + data->epoch : total;
+        for (long long g = epoch_start; g < epoch_end; g++, i++) {
+            /* Temperature-dependent swap count */
+            swap_count = (int)(initial_swap_count * (T / max_T));
+            swap_count = swap_count < 1 ? 1 : swap_count;
+            swap_count = swap_count > initial_swap_count ? initial_swap_count : swap_count;
+
+            /* Store the swaps for potential reversal */
+            int swap_rows1[swap_count];
+            int swap_cols1[swap_count];
+            int swap_rows2[swap_count];
+            int swap_cols2[swap_count];
+
+            /* Perform the swaps */
+            for (int j = 0; j < swap_count; j++) {
+                int row1, col1, row2, col2;
+                do {
+                    row1 = rand() % ROW;
+                    col1 = rand() % COL;
+                    row2 = rand() % ROW;
+                    col2 = rand() % COL;
+                } while (pins[row1][col1] || pins[row2][col2] || (row1 == row2 && col1 == col2));
+
+                /* Store swap locations for BOTH positions */
+                swap_rows1[j] = row1;
+                swap_cols1[j] = col1;
+                swap_rows2[j] = row2;
+                swap_cols2[j] = col2;
+
+                /* Perform the swap */
                 int temp = working_lt->matrix[row1][col1];
                 working_lt->matrix[row1][col1] = working_lt->matrix[row2][col2];
                 working_lt->matrix[row2][col2] = temp;
             }
-        }
 
-        /* Adaptive cooling - Modified to adjust reheating temperature */
-        if (i > 0 && i % (iterations / 20) == 0) {
-            double improvement_rate = (double)improvement_counter / (iterations / 20);
-            if (improvement_rate > 0.2) {
-                /* Cool faster if improving rapidly */
-                max_T *= 0.95;
+            /* analyze the new layout */
+            single_analyze(working_lt); /* analyze.c */
+            /* calculates the new score */
+            get_score(working_lt); /* util.c */
+
+            /* Exponentiate the score difference for acceptance probability (using sigmoid) */
+            float delta_score = working_lt->score - max_lt->score;
+            if (delta_score > 0 || (1.0 / (1.0 + exp(-10 * delta_score / T))) > random_float()) {
+                /* copy the new layout if it passes */
+                copy(max_lt, working_lt); /* util.c */
+                /* Increment improvement counter */
+                improvement_counter++;
+                accepts++;
+                if (max_lt->score > best_score) {
+                    best_score = max_lt->score;
+                    improvements++;
+                    atomic_store_explicit(&counters->best_score, best_score, memory_order_relaxed);
+                    last_improvement = i;
+                    stagnations = 0;
+                    top_T = ceiling_T;
+                    /* share the new best, rare enough that the lock is cheap */
+                    pthread_mutex_lock(&data->global_best->lock);
+                    if (max_lt->score > data->global_best->lt->score) {
+                        copy(data->global_best->lt, max_lt); /* util.c */
+                    }
+                    pthread_mutex_unlock(&data->global_best->lock);
+                }
             } else {
-                /* Cool slower if not improving much */
-                max_T *= 1.05;
+                /* Revert the swaps in reverse order if it fails */
+                for (int j = swap_count - 1; j >= 0; j--) {
+                    int row1 = swap_rows1[j];
+                    int col1 = swap_cols1[j];
+                    int row2 = swap_rows2[j];
+                    int col2 = swap_cols2[j];
+
+                    /* Perform the reverse swap */
+                    int temp = working_lt->matrix[row1][col1];
+                    working_lt->matrix[row1][col1] = working_lt->matrix[row2][col2];
+                    working_lt->matrix[row2][col2] = temp;
+                }
             }
-            /* Limit max_T to a reasonable upper bound */
-            max_T = max_T > 1500.0 ? 1500.0 : max_T;
-            /* Don't let max_T be less than the current T */
-            max_T = max_T < T ? T : max_T;
-            /* Reset counter */
-            improvement_counter = 0;
-        }
 
-        /* Reheating with temperature clamp */
-        if (i > 0 && i % (iterations / 10) == 0) {
-            float old_T = T;
-            /* Reheat to the potentially adjusted max_T */
-            T = max_T;
-            reheating_count++;
-            if (thread_id == 0) {log_print('v', L"\nReheating (%d) | Old Temp: %f - New Temp: %f\n", reheating_count, old_T, T);}
-        }
+            /* No new best for too long counts as stagnation */
+            int stagnant = stagnation_limit > 0 && i - last_improvement >= stagnation_limit;
+
+            /* Adaptive cooling - Modified to adjust reheating temperature */
+            if (i > 0 && i % cooling_period == 0) {
+                double improvement_rate = (double)improvement_counter / cooling_period;
+                /* So does accepting too few moves, the search is frozen */
+                if (improvement_rate < stagnation_accept) {stagnant = 1;}
+                if (improvement_rate > 0.2) {
+                    /* Cool faster if improving rapidly */
+                    max_T *= 0.95;
+                } else {
+                    /* Cool slower if not improving much */
+                    max_T *= 1.05;
+                }
+                /* Limit max_T to a reasonable upper bound */
+                max_T = max_T > top_T ? top_T : max_T;
+                /* Don't let max_T be less than the current T */
+                max_T = max_T < T ? T : max_T;
+                /* Reset counter */
+                improvement_counter = 0;
+            }
 
-        /* Non-monotonic "jolt" */
-        if (i > 0 && i % (iterations / 50) == 0) {
-            T *= (1.0 + random_float() * 0.3);
-            if (T > max_T) {
+            /* Reheating with temperature clamp */
+            if (i > 0 && i % reheat_period == 0) {
+                float old_T = T;
+                /* Reheat to the potentially adjusted max_T */
                 T = max_T;
+                reheating_count++;
+                if (thread_id == 0) {log_print('v', L"\nReheating (%d) | Old Temp: %f - New Temp: %f\n", reheating_count, old_T, T);}
             }
-        }
 
-        /* Temperature cooling tied to iteration count */
-        float progress = (float)i / iterations;
-        /* Linear decrease */
-        T = max_T * (1.0 - progress);
-        /* Exponential decrease - You can try this too (seems worse) */
-        /* T = max_T * exp(-5.0 * progress); */
-        /* Prevent T from going below 1.0 */
-        T = T < 1.0 ? 1.0 : T;
-
-        /* Percentage completion and estimated time for the first thread */
-        if (thread_id == 0 && i % 100 == 0) {
-            clock_gettime(CLOCK_MONOTONIC, &current);
-            double elapsed = (current.tv_sec - start.tv_sec) + (current.tv_nsec - start.tv_nsec) / 1e9;
-            double progress_percent = (double)i / iterations;
-            double iterationsPerSecond = i / elapsed;
-            double totalIterationsPerSecond = iterationsPerSecond * threads;
-            int estimatedRemaining = (int)((iterations - i) / iterationsPerSecond);
-
-            /* Calculate hours, minutes, and seconds */
-            int hours = estimatedRemaining / 3600;
-            int minutes = (estimatedRemaining % 3600) / 60;
-            int seconds = estimatedRemaining % 60;
-
-            /* Print the result (with correct pluralization) */
-            log_print('n', L"\r%3d%%  ETA: %02dh %02dm %02ds, %8.0lf layout%s/sec                 ",
-                (int)(progress_percent * 100), hours, minutes, seconds, totalIterationsPerSecond,
-                totalIterationsPerSecond == 1 ? "" : "s");
-            fflush(stdout);
+            /* Non-monotonic "jolt" */
+            if (i > 0 && i % jolt_period == 0) {
+                T *= (1.0 + random_float() * 0.3);
+                if (T > max_T) {
+                    T = max_T;
+                }
+            }
+
+            if (stagnant && running) {
+                stagnations++;
+                last_improvement = i;
+                if (thread_id == 0) {log_print('v', L"\nStagnation (%d) at iteration %lld\n", stagnations, i);}
+                if (stagnation_action == 's') {
+                    /*
+                     * finish the epoch already claimed and claim no more, the
+                     * others take the epochs still left on the counter
+                     */
+                    if (atomic_fetch_sub(data->active, 1) > 1) {running = 0;}
+                    else {atomic_fetch_add(data->active, 1);}
+                } else if (stagnation_action == 'r') {
+                    /* restart from a perturbed copy of the best layout so far */
+                    pthread_mutex_lock(&data->global_best->lock);
+                    copy(working_lt, data->global_best->lt); /* util.c */
+                    pthread_mutex_unlock(&data->global_best->lock);
+                    random_swaps(working_lt, initial_swap_count);
+                    single_analyze(working_lt); /* analyze.c */
+                    get_score(working_lt); /* util.c */
+                    extra_analyses++;
+                    copy(max_lt, working_lt); /* util.c */
+                    /* and at the top of the schedule */
+                    origin = g;
+                } else {
+                    /* raise the schedule and its bound, more each time the search stagnates again */
+                    top_T = ceiling_T * (1.0 + 0.25 * stagnations);
+                    max_T *= 1.0 + 0.25 * stagnations;
+                    max_T = max_T > top_T ? top_T : max_T;
+                    /* cool down again from here */
+                    origin = g;
+                }
+                improvement_counter = 0;
+            }
+
+            /* Temperature cooling tied to the global iteration count */
+            float progress = (float)(g - origin) / (total - origin);
+            /* Linear decrease */
+            T = max_T + (end_T - max_T) * progress;
+            /* Exponential decrease - You can try this too (seems worse) */
+            /* T = max_T * pow(end_T / max_T, progress); */
+            /* Prevent T from going below the calibrated end */
+            T = T < end_T ? end_T : T;
+
+            /* Publish progress, single writer so plain relaxed stores suffice */
+            atomic_store_explicit(&counters->iterations, i + 1 + extra_analyses, memory_order_relaxed);
+            atomic_store_explicit(&counters->accepts, accepts, memory_order_relaxed);
+            atomic_store_explicit(&counters->improvements, improvements, memory_order_relaxed);
         }
     }
-    if (thread_id == 0) {
-        /* Newline after percentage reaches 100% */
-        log_print('q', L"\n");
-    }
 
     layout *best_layout;
     /* allocates memory for best layout */
@@ -439,67 +673,38 @@ void *thread_function(void *arg) {
     /* free layouts */
     free_layout(max_lt);     /* util.c */
     free_layout(working_lt); /* util.c */
-
-    pthread_exit(NULL);
 }
 
 /*
  * Initiates the layout generation process without a specific starting layout.
  * Calls improve with shuffle set to 1, effectively starting from a random
- * layout, with no pins. Will still use set of keys from selected layout.
+ * layout, with only the gaps of the keyboard pinned. Will still use set of
+ * keys from selected layout.
  */
 void generate() {
-    /* No specific layout used, so unpin all positions for a fresh start */
+    /* No specific layout used, so unpin all keys for a fresh start */
     for (int i = 0; i < ROW; i++) {
         for (int j = 0; j < COL; j++) {
-            pins[i][j] = 0;
+            pins[i][j] = key_fingers[i][j] == -1;
         }
     }
     improve(1);
 }
 
 /*
- * Improves an existing layout using multiple threads.
- * Each thread runs a simulated annealing process to find a better layout.
+ * Runs the annealing threads on a prepared starting layout and prints the
+ * best layout found. The starting layout stays with the caller, so a
+ * benchmark can read it once and reuse it for every run.
  *
  * Parameters:
- *   shuffle: A flag indicating whether to shuffle the layout before starting.
+ *   lt: The starting layout, read and shuffled as wanted.
  */
-void improve(int shuffle) {
-    /* Work for timing total/real layouts/second */
-    layouts_analyzed += ((int)repetitions/threads + 1) * threads;
+static void improve_layout(layout *lt) {
+    /* Work for timing total/real layouts/second, the start and best layouts */
     layouts_analyzed += 2;
     struct timespec compute_start, compute_end;
     clock_gettime(CLOCK_MONOTONIC, &compute_start);
 
-    layout *lt;
-
-    /* prints the current pins */
-    log_print('v',L"Pins: \n");
-    print_pins(); /* io.c */
-    log_print('v',L"\n");
-
-    /* allocate memory for layout */
-    log_print('n',L"1/9: Allocating layout... ");
-    alloc_layout(&lt); /* util.c */
-    log_print('n',L"Done\n\n");
-
-    /* read the starting keyboard layout */
-    log_print('n',L"2/9: Reading layout... ");
-    read_layout(lt, 1); /* io.c */
-    log_print('n',L"Done\n\n");
-
-    if (shuffle) {
-        /* shuffles the matrix */
-        log_print('n',L"3/9: Shuffling layout... ");
-        shuffle_layout(lt); /* util.c */
-        strcpy(lt->name, "random shuffle");
-        log_print('n',L"Done\n\n");
-    } else {
-        log_print('n',L"3/8: Skipping shuffle... ");
-        log_print('n',L"Done\n\n");
-    }
-
     /* perform a single layout analysis */
     log_print('n',L"4/9: Analyzing starting point... ");
     single_analyze(lt); /* analyze.c */
@@ -507,32 +712,62 @@ void improve(int shuffle) {
     get_score(lt); /* util.c */
     log_print('n',L"Done\n\n");
 
+    /* fit the temperature schedule to the score scale of the weights */
+    log_print('n',L"     Calibrating temperature... ");
+    float start_T, end_T;
+    calibrate_temperature(lt, &start_T, &end_T);
+    log_print('n',L"Done\n");
+    log_print('n',L"     Schedule: T %f -> %f, accepting %.1f%% -> %.1f%% of worse moves\n\n",
+        start_T, end_T, accept_start * 100, accept_end * 100);
+
     /* prints the starting layout */
     print_layout(lt); /* io.c */
     log_print('n',L"\n");
 
     int iterations = repetitions / threads;
 
-    /* Allocate memory for thread data and thread IDs */
+    /* Shared work counter, each epoch is a slice of a thread's expected share */
+    atomic_llong next_iteration = 0;
+    atomic_int active = threads;
+    int epoch = iterations / EPOCHS_PER_THREAD > 0 ? iterations / EPOCHS_PER_THREAD : 1;
+
+    /* Best layout shared between threads for restarts */
+    shared_best global_best;
+    pthread_mutex_init(&global_best.lock, NULL);
+    alloc_layout(&global_best.lt); /* util.c */
+    copy(global_best.lt, lt); /* util.c */
+
+    /* Allocate memory for thread data */
     thread_data *thread_data_array = (thread_data *)malloc(threads * sizeof(thread_data));
-    pthread_t *thread_ids = (pthread_t *)malloc(threads * sizeof(pthread_t));
     layout **best_layouts = (layout **)malloc(threads * sizeof(layout *));
 
-    /* Create and start the threads */
+    /* Submit one annealing task per thread to the worker pool */
     log_print('n',L"5/9: Initializing threads... ");
+    pool_reserve(threads); /* pool.c */
+    start_telemetry(threads, repetitions); /* telemetry.c */
     for (int i = 0; i < threads; i++) {
         best_layouts[i] = NULL;
         thread_data_array[i].lt = lt;
         thread_data_array[i].best_lt = &best_layouts[i];
         thread_data_array[i].iterations = iterations;
+        thread_data_array[i].next_iteration = &next_iteration;
+        thread_data_array[i].total = repetitions;
+        thread_data_array[i].epoch = epoch;
+        thread_data_array[i].active = &active;
+        thread_data_array[i].start_T = start_T;
+        thread_data_array[i].end_T = end_T;
+        thread_data_array[i].global_best = &global_best;
         thread_data_array[i].thread_id = i;
-        pthread_create(&thread_ids[i], NULL, thread_function, (void *)&thread_data_array[i]);
+        pool_submit(thread_function, (void *)&thread_data_array[i]); /* pool.c */
     }
 
-    /* Wait for all threads to complete */
-    for (int i = 0; i < threads; i++) {
-        pthread_join(thread_ids[i], NULL);
-    }
+    log_print('n',L"Done\n\n");
+
+    /* Wait for all threads to complete while the reporter prints progress */
+    log_print('n',L"6/9: Waiting for threads to complete... \n");
+    pool_wait(); /* pool.c */
+    /* exact count of annealing iterations, restarts and each thread's start */
+    layouts_analyzed += stop_telemetry() + threads; /* telemetry.c */
     log_print('n',L"Done\n\n");
 
     /* Find the best layout among all threads */
@@ -570,20 +805,60 @@ void improve(int shuffle) {
         }
     }
 
-    free_layout(lt);
+    free_layout(global_best.lt); /* util.c */
+    pthread_mutex_destroy(&global_best.lock);
     free(thread_data_array);
-    free(thread_ids);
     free(best_layouts);
     clock_gettime(CLOCK_MONOTONIC, &compute_end);
     elapsed_compute_time += (compute_end.tv_sec - compute_start.tv_sec) + (compute_end.tv_nsec - compute_start.tv_nsec) / 1e9;
 }
 
+/*
+ * Improves an existing layout using multiple threads.
+ * Each thread runs a simulated annealing process to find a better layout.
+ *
+ * Parameters:
+ *   shuffle: A flag indicating whether to shuffle the layout before starting.
+ */
+void improve(int shuffle) {
+    layout *lt;
+
+    /* prints the current pins */
+    log_print('v',L"Pins: \n");
+    print_pins(); /* io.c */
+    log_print('v',L"\n");
+
+    /* allocate memory for layout */
+    log_print('n',L"1/9: Allocating layout... ");
+    alloc_layout(&lt); /* util.c */
+    log_print('n',L"Done\n\n");
+
+    /* read the starting keyboard layout */
+    log_print('n',L"2/9: Reading layout... ");
+    read_layout(lt, 1); /* io.c */
+    log_print('n',L"Done\n\n");
+
+    if (shuffle) {
+        /* shuffles the matrix */
+        log_print('n',L"3/9: Shuffling layout... ");
+        shuffle_layout(lt); /* util.c */
+        strcpy(lt->name, "random shuffle");
+        log_print('n',L"Done\n\n");
+    } else {
+        log_print('n',L"3/8: Skipping shuffle... ");
+        log_print('n',L"Done\n\n");
+    }
+
+    improve_layout(lt);
+    free_layout(lt); /* util.c */
+}
+
 /* Generates a new layout using OpenCL. */
 void cl_generate() {
-    /* No specific layout used, so unpin all positions for a fresh start */
+    /* No specific layout used, so unpin all keys for a fresh start */
     for (int i = 0; i < ROW; i++) {
         for (int j = 0; j < COL; j++) {
-            pins[i][j] = 0;
+            pins[i][j] = key_fingers[i][j] == -1;
         }
     }
     cl_improve(1);
@@ -634,6 +909,11 @@ char* read_source_file(const char* filename, size_t* length) {
  *   shuffle: A flag indicating whether to shuffle the layout before starting (1) or not (0).
  */
 void cl_improve(int shuffle) {
+    /* the kernel indexes dense frequency arrays */
+    if (sparse_quad != NULL) {
+        error("The opencl backend does not support languages over 50 character pairs, use the cpu backend.");
+    }
+
     /* Work for timing total/real layouts/second */
     layouts_analyzed += ((int) repetitions / threads) * threads;
     layouts_analyzed += 2;
@@ -667,6 +947,13 @@ void cl_improve(int shuffle) {
     get_score(lt);
     log_print('n', L"Done\n\n");
 
+    log_print('n', L"     Calibrating temperature... ");
+    float start_T, end_T;
+    calibrate_temperature(lt, &start_T, &end_T);
+    log_print('n', L"Done\n");
+    log_print('n', L"     Schedule: T %f -> %f, accepting %.1f%% -> %.1f%% of worse moves\n\n",
+        start_T, end_T, accept_start * 100, accept_end * 100);
+
     print_layout(lt);
     log_print('n', L"\n");
 
@@ -789,9 +1076,9 @@ void cl_improve(int shuffle) {
 
     /* Compiler options to pass constants to the kernel using compiler flags */
     /* Ensure this is large enough for all defines */
-    char options[512];
-    sprintf(options, "-Iinclude -cl-fast-relaxed-math -D MONO_LENGTH=%d -D BI_LENGTH=%d -D TRI_LENGTH=%d -D QUAD_LENGTH=%d -D SKIP_LENGTH=%d -D META_LENGTH=%d -D THREADS=%d -D REPETITIONS=%d -D MAX_SWAPS=%d -D WORKERS=%d",
-            MONO_LENGTH, BI_LENGTH, TRI_LENGTH, QUAD_LENGTH, SKIP_LENGTH, META_LENGTH, threads, repetitions, MAX_SWAPS, WORKERS);
+    char options[1024];
+    sprintf(options, "-Iinclude -cl-fast-relaxed-math -D ROW=%d -D COL=%d -D MONO_LENGTH=%d -D BI_LENGTH=%d -D TRI_LENGTH=%d -D QUAD_LENGTH=%d -D SKIP_LENGTH=%d -D META_LENGTH=%d -D THREADS=%d -D REPETITIONS=%d -D MAX_SWAPS=%d -D WORKERS=%d -D START_T=%ef -D END_T=%ef -D LANG_LENGTH=%d",
+            ROW, COL, MONO_LENGTH, BI_LENGTH, TRI_LENGTH, QUAD_LENGTH, SKIP_LENGTH, META_LENGTH, threads, repetitions, MAX_SWAPS, WORKERS, start_T, end_T, LANG_LENGTH);
 
     err = clBuildProgram(program, 1, &device, options, NULL, NULL);
     if (err != CL_SUCCESS) {
@@ -825,6 +1112,35 @@ void cl_improve(int shuffle) {
     int *reps_data = (int *)malloc(sizeof(int) * threads);
     for (int i = 0; i < threads; i++) {reps_data[i] = 0;}
 
+    /*
+     * The ngram arrays of the stats are separate allocations, so they are
+     * packed into one buffer, monogram to skipgram stats in order, with the
+     * start of each stat in a second one.
+     */
+    int stat_total = MONO_LENGTH + BI_LENGTH + TRI_LENGTH + QUAD_LENGTH + SKIP_LENGTH;
+    int *ngram_offsets = (int *)malloc(sizeof(int) * stat_total);
+    if (ngram_offsets == NULL) {error("Failed to allocate memory for ngram offsets.");}
+    size_t ngram_total = 0;
+    int o = 0;
+    for (int i = 0; i < MONO_LENGTH; i++) {ngram_offsets[o++] = ngram_total; ngram_total += stats_mono[i].length;}
+    for (int i = 0; i < BI_LENGTH; i++) {ngram_offsets[o++] = ngram_total; ngram_total += stats_bi[i].length;}
+    for (int i = 0; i < TRI_LENGTH; i++) {ngram_offsets[o++] = ngram_total; ngram_total += stats_tri[i].length;}
+    for (int i = 0; i < QUAD_LENGTH; i++) {ngram_offsets[o++] = ngram_total; ngram_total += stats_quad[i].length;}
+    for (int i = 0; i < SKIP_LENGTH; i++) {ngram_offsets[o++] = ngram_total; ngram_total += stats_skip[i].length;}
+    int *packed_ngrams = (int *)malloc(sizeof(int) * (ngram_total > 0 ? ngram_total : 1));
+    if (packed_ngrams == NULL) {error("Failed to allocate memory for packed ngrams.");}
+    o = 0;
+    for (int i = 0; i < MONO_LENGTH; i++, o++) {memcpy(packed_ngrams + ngram_offsets[o], stats_mono[i].ngrams, sizeof(int) * stats_mono[i].length);}
+    for (int i = 0; i < BI_LENGTH; i++, o++) {memcpy(packed_ngrams + ngram_offsets[o], stats_bi[i].ngrams, sizeof(int) * stats_bi[i].length);}
+    for (int i = 0; i < TRI_LENGTH; i++, o++) {memcpy(packed_ngrams + ngram_offsets[o], stats_tri[i].ngrams, sizeof(int) * stats_tri[i].length);}
+    for (int i = 0; i < QUAD_LENGTH; i++, o++) {memcpy(packed_ngrams + ngram_offsets[o], stats_quad[i].ngrams, sizeof(int) * stats_quad[i].length);}
+    for (int i = 0; i < SKIP_LENGTH; i++, o++) {memcpy(packed_ngrams + ngram_offsets[o], stats_skip[i].ngrams, sizeof(int) * stats_skip[i].length);}
+
+    /* the pins of the grid in use, without the padding to MAX_COL */
+    int *grid_pins = (int *)malloc(sizeof(int) * DIM1);
+    if (grid_pins == NULL) {error("Failed to allocate memory for pins.");}
+    for (int i = 0; i < DIM1; i++) {grid_pins[i] = pins[i / COL][i % COL];}
+
     /* Allocate and copy data to device buffers */
     log_print('v', L"     Allocating and copying data to device buffers...");
 
@@ -854,8 +1170,12 @@ void cl_improve(int shuffle) {
     if (err != CL_SUCCESS) {error("OpenCL Error: Failed to create buffer for layouts.");}
     err = clEnqueueWriteBuffer(queue, buffer_layouts, CL_TRUE, 0, sizeof(layout) * threads, layouts, 0, NULL, NULL);
     if (err != CL_SUCCESS) {error("OpenCL Error: Failed to write layouts to buffer.");}
-    cl_mem buffer_pins = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(int) * ROW * COL, pins, &err);
+    cl_mem buffer_pins = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(int) * DIM1, grid_pins, &err);
     if (err != CL_SUCCESS) {error("OpenCL Error: Failed to create buffer for pins.");}
+    cl_mem buffer_ngrams = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(int) * (ngram_total > 0 ? ngram_total : 1), packed_ngrams, &err);
+    if (err != CL_SUCCESS) {error("OpenCL Error: Failed to create buffer for ngrams.");}
+    cl_mem buffer_ngram_offsets = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(int) * stat_total, ngram_offsets, &err);
+    if (err != CL_SUCCESS) {error("OpenCL Error: Failed to create buffer for ngram offsets.");}
     cl_mem buffer_reps = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(int) * threads, NULL, &err);
     if (err != CL_SUCCESS) { error("OpenCL Error: Failed to create buffer for reps."); }
     log_print('v', L"     Done\n");
@@ -896,6 +1216,10 @@ void cl_improve(int shuffle) {
     if (err != CL_SUCCESS) {error("OpenCL Error: Failed to set kernel argument 13.");}
     err = clSetKernelArg(kernel, 14, sizeof(cl_mem), &buffer_reps);
     if (err != CL_SUCCESS) { error("OpenCL Error: Failed to set kernel argument 14."); }
+    err = clSetKernelArg(kernel, 15, sizeof(cl_mem), &buffer_ngrams);
+    if (err != CL_SUCCESS) {error("OpenCL Error: Failed to set kernel argument 15.");}
+    err = clSetKernelArg(kernel, 16, sizeof(cl_mem), &buffer_ngram_offsets);
+    if (err != CL_SUCCESS) {error("OpenCL Error: Failed to set kernel argument 16.");}
     log_print('v', L"Done\n");
 
     log_print('v', L"     Done\n\n");
@@ -981,6 +1305,8 @@ void cl_improve(int shuffle) {
     clReleaseMemObject(buffer_stats_meta);
     clReleaseMemObject(buffer_layouts);
     clReleaseMemObject(buffer_pins);
+    clReleaseMemObject(buffer_ngrams);
+    clReleaseMemObject(buffer_ngram_offsets);
     clReleaseMemObject(buffer_reps);
     clReleaseKernel(kernel);
     clReleaseProgram(program);
@@ -1006,6 +1332,9 @@ void cl_improve(int shuffle) {
     free(layouts);
     free_layout(lt);
     free(reps_data);
+    free(packed_ngrams);
+    free(ngram_offsets);
+    free(grid_pins);
     clock_gettime(CLOCK_MONOTONIC, &compute_end);
     elapsed_compute_time += (compute_end.tv_sec - compute_start.tv_sec) + (compute_end.tv_nsec - compute_start.tv_nsec) / 1e9;
 }
@@ -1042,6 +1371,10 @@ void gen_benchmark()
     thread_array[count] = num_cpus / 2;
     thread_array[count + 1] = num_cpus;
     thread_array[count + 2] = num_cpus * 2;
+    /* a single cpu would otherwise plan a run with 0 threads */
+    for (int i = 0; i < total; i++) {
+        if (thread_array[i] < 1) {thread_array[i] = 1;}
+    }
 
     /* print the tests to be done */
     for (int i = 0; i < total; i++) {log_print('v',L"%d ", thread_array[i]);}
@@ -1053,6 +1386,19 @@ void gen_benchmark()
     char temp = output_mode;
     output_mode = 'q';
 
+    /* No specific layout used, so unpin all keys for a fresh start */
+    for (int i = 0; i < ROW; i++) {
+        for (int j = 0; j < COL; j++) {
+            pins[i][j] = key_fingers[i][j] == -1;
+        }
+    }
+
+    /* read the starting layout once, every run shuffles a copy of it */
+    layout *start_lt, *lt;
+    alloc_layout(&start_lt); /* util.c */
+    alloc_layout(&lt); /* util.c */
+    read_layout(start_lt, 1); /* io.c */
+
     /* run benchmark for each thread count */
     for (int i = 0; i < total; i++)
     {
@@ -1063,7 +1409,10 @@ void gen_benchmark()
         struct timespec start, end;
         clock_gettime(CLOCK_MONOTONIC, &start);
 
-        generate();
+        copy(lt, start_lt); /* util.c */
+        shuffle_layout(lt); /* util.c */
+        strcpy(lt->name, "random shuffle");
+        improve_layout(lt);
 
         clock_gettime(CLOCK_MONOTONIC, &end);
         double elapsed = (end.tv_sec - start.tv_sec) +
@@ -1075,6 +1424,8 @@ void gen_benchmark()
 
     /* reset output mode */
     output_mode = temp;
+    free_layout(lt); /* util.c */
+    free_layout(start_lt); /* util.c */
 
     /* print benchmark results */
     log_print('q',L"\nBENCHMARK RESULTS:\n\n");
@@ -1271,6 +1622,8 @@ void print_help() {
     log_print('q',L"  -l <language> : Chooses the language, the basis of all data in this program.\n");
     log_print('q',L"                  The language chooses which corpora and layouts you can access.\n");
     log_print('q',L"  -c <corpus>   : Chooses the corpus file within the language directory.\n");
+    log_print('q',L"                  Blends corpora given as name:weight,name:weight,...\n");
+    log_print('q',L"                  Reads standard input, uncached, given as -\n");
     log_print('q',L"  -1 <layout>   : Chooses the primary layout within the language directory.\n");
     log_print('q',L"  -2 <layout>   : Chooses the secondary layout within the language directory.\n");
     log_print('q',L"  -w <weights>  : Chooses the weights file within the weights directory.\n");
@@ -1280,6 +1633,37 @@ void print_help() {
     log_print('q',L"  -t <val>      : Chooses the number of layouts to analyze concurrently in the\n");
     log_print('q',L"                  generation modes. It is recommended to set this number based\n");
     log_print('q',L"                  on the benchmark output.\n");
+    log_print('q',L"  --telemetry <file>   : Writes the score and throughput of the generation\n");
+    log_print('q',L"                         modes over time to a file, JSONL if it ends in\n");
+    log_print('q',L"                         .jsonl, else CSV.\n");
+    log_print('q',L"  --stagnation <val>   : A thread stagnates after this many layouts without a\n");
+    log_print('q',L"                         new best, 0 (default) disables the check.\n");
+    log_print('q',L"  --min-accept <rate>  : A thread also stagnates when it accepts fewer than\n");
+    log_print('q',L"                         this fraction of moves, 0 (default) disables it.\n");
+    log_print('q',L"  --on-stagnation <act>: What a stagnated thread does.\n");
+    log_print('q',L"    r;restart : Restarts from a perturbed copy of the best layout (default).\n");
+    log_print('q',L"    h;reheat  : Raises the temperature, more on every repeated stagnation, and\n");
+    log_print('q',L"                cools down again from there.\n");
+    log_print('q',L"    s;stop    : Stops, the other threads use the layouts it has not started.\n");
+    log_print('q',L"  --accept-start <rate>: Fraction of worse moves accepted at the start, used to\n");
+    log_print('q',L"                         calibrate the temperature, below 0.5 (default 0.4).\n");
+    log_print('q',L"  --accept-end <rate>  : Fraction of worse single swaps accepted at the end\n");
+    log_print('q',L"                         (default 0.005).\n");
+    log_print('q',L"  --append <corpora>   : Counts more text files of the corpora directory,\n");
+    log_print('q',L"                         comma separated, into the cached corpus.\n");
+    log_print('q',L"  --separator <char>   : Character counted after every word of a .freq word\n");
+    log_print('q',L"                         list, space (default), none, or any character.\n");
+    log_print('q',L"  --stats <name>       : Adds the custom stats of data/stats/<name>.stat to the\n");
+    log_print('q',L"                         built-in ones.\n");
+    log_print('q',L"  --keyboard <name>    : Reads the keyboard geometry from data/keyboards/\n");
+    log_print('q',L"                         <name>.kbd, standard (default).\n");
+    log_print('q',L"  --specialize         : Compiles a scorer for the current stats, weights and\n");
+    log_print('q',L"                         keyboard with $CC or cc, cached in data/scorers. Falls\n");
+    log_print('q',L"                         back to the generic scorer without a compiler.\n");
+    log_print('q',L"  --compact            : Drops the characters no layout of the run holds from\n");
+    log_print('q',L"                         the frequency tables.\n");
+    log_print('q',L"  --simd <isa>         : Caps the vector instructions of the scoring kernels:\n");
+    log_print('q',L"                         auto (default), avx512, avx2 or scalar.\n");
 
 
     log_print('q',L"Modes:\n");
@@ -0,0 +1,276 @@
+/*
+ * pool.c - Persistent worker thread pool for the GULAG.
+ *
+ * This file implements a long lived pool of worker threads that all modes
+ * submit their work to. Each worker owns a double ended queue of tasks; the
+ * owner pops from the back of its own queue while idle workers steal from the
+ * front of the others, which keeps heterogeneous tasks load balanced.
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "pool.h"
+#include "util.h"
+
+/* Upper bound on workers, the pointer array is never reallocated. */
+#define MAX_POOL_WORKERS 1024
+
+/* Starting capacity of each worker's task queue. */
+#define QUEUE_CAPACITY 64
+
+/* A unit of work submitted to the pool. */
+typedef struct task {
+    void (*function)(void *);
+    void *arg;
+} task;
+
+/* A worker thread and its task queue (a ring buffer used as a deque). */
+typedef struct worker {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    task *tasks;
+    int capacity;
+    int head;
+    int count;
+    int id;
+} worker;
+
+static worker *workers[MAX_POOL_WORKERS];
+static atomic_int worker_count = 0;
+
+/* Protects the counters below and backs both condition variables. */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t work_done = PTHREAD_COND_INITIALIZER;
+
+/* Tasks waiting in a queue. */
+static int queued = 0;
+/* Tasks waiting or running. */
+static int pending = 0;
+static int shutting_down = 0;
+static int next_queue = 0;
+
+/* Index of the worker running on this thread, -1 outside the pool. */
+static __thread int current_worker = -1;
+
+/*
+ * Pushes a task onto the back of a worker's queue, growing it if full.
+ * Parameters:
+ *   w: The worker that owns the queue.
+ *   t: The task to push.
+ */
+static void push_task(worker *w, task t)
+{
+    pthread_mutex_lock(&w->lock);
+    if (w->count == w->capacity) {
+        task *grown = (task *)malloc(sizeof(task) * w->capacity * 2);
+        if (grown == NULL) {error("failed to grow pool task queue");}
+        for (int i = 0; i < w->count; i++) {
+            grown[i] = w->tasks[(w->head + i) % w->capacity];
+        }
+        free(w->tasks);
+        w->tasks = grown;
+        w->head = 0;
+        w->capacity *= 2;
+    }
+    w->tasks[(w->head + w->count) % w->capacity] = t;
+    w->count++;
+    pthread_mutex_unlock(&w->lock);
+}
+
+/*
+ * Pops a task from the back (owner) or the front (thief) of a queue.
+ * Parameters:
+ *   w:     The worker that owns the queue.
+ *   t:     Where to store the task.
+ *   steal: 1 to take from the front, 0 to take from the back.
+ * Returns: 1 if a task was taken, 0 if the queue was empty.
+ */
+static int pop_task(worker *w, task *t, int steal)
+{
+    int found = 0;
+    pthread_mutex_lock(&w->lock);
+    if (w->count > 0) {
+        if (steal) {
+            *t = w->tasks[w->head];
+            w->head = (w->head + 1) % w->capacity;
+        } else {
+            *t = w->tasks[(w->head + w->count - 1) % w->capacity];
+        }
+        w->count--;
+        found = 1;
+    }
+    pthread_mutex_unlock(&w->lock);
+    return found;
+}
+
+/*
+ * Finds work for a worker, first from its own queue then from the others.
+ * Parameters:
+ *   self: The index of the worker looking for work.
+ *   t:    Where to store the task.
+ * Returns: 1 if a task was taken, 0 if every queue was empty.
+ */
+static int take_task(int self, task *t)
+{
+    if (pop_task(workers[self], t, 0)) {return 1;}
+    int total = atomic_load(&worker_count);
+    for (int i = 1; i < total; i++) {
+        if (pop_task(workers[(self + i) % total], t, 1)) {return 1;}
+    }
+    return 0;
+}
+
+/*
+ * Main loop of every worker: run tasks until the pool shuts down.
+ * Parameters:
+ *   arg: A pointer to the worker structure.
+ */
+static void *worker_function(void *arg)
+{
+    worker *self = (worker *)arg;
+    current_worker = self->id;
+    task t;
+
+    while (1) {
+        if (take_task(self->id, &t)) {
+            pthread_mutex_lock(&pool_lock);
+            queued--;
+            pthread_mutex_unlock(&pool_lock);
+
+            t.function(t.arg);
+
+            pthread_mutex_lock(&pool_lock);
+            pending--;
+            if (pending == 0) {pthread_cond_broadcast(&work_done);}
+            pthread_mutex_unlock(&pool_lock);
+            continue;
+        }
+
+        /* sleep until something is queued */
+        pthread_mutex_lock(&pool_lock);
+        while (queued == 0 && !shutting_down) {
+            pthread_cond_wait(&work_ready, &pool_lock);
+        }
+        int done = shutting_down && queued == 0;
+        pthread_mutex_unlock(&pool_lock);
+        if (done) {break;}
+    }
+    return NULL;
+}
+
+/* Starts one more worker thread. Caller must hold pool_lock. */
+static void add_worker()
+{
+    int id = atomic_load(&worker_count);
+    if (id >= MAX_POOL_WORKERS) {error("too many pool workers requested");}
+
+    worker *w = (worker *)malloc(sizeof(worker));
+    if (w == NULL) {error("failed to malloc pool worker");}
+    pthread_mutex_init(&w->lock, NULL);
+    w->tasks = (task *)malloc(sizeof(task) * QUEUE_CAPACITY);
+    if (w->tasks == NULL) {error("failed to malloc pool task queue");}
+    w->capacity = QUEUE_CAPACITY;
+    w->head = 0;
+    w->count = 0;
+    w->id = id;
+
+    workers[id] = w;
+    atomic_store(&worker_count, id + 1);
+    if (pthread_create(&w->thread, NULL, worker_function, w) != 0) {
+        error("failed to create pool worker");
+    }
+}
+
+/*
+ * Creates the persistent worker pool used by every mode. Workers are started
+ * once and sleep until tasks are submitted, so short jobs do not pay thread
+ * creation costs.
+ */
+void create_pool(int count)
+{
+    pool_reserve(count);
+}
+
+/*
+ * Makes sure the pool has at least the given number of workers, starting new
+ * ones if needed. Must only be called while the pool is idle.
+ */
+void pool_reserve(int count)
+{
+    pthread_mutex_lock(&pool_lock);
+    while (atomic_load(&worker_count) < count) {add_worker();}
+    pthread_mutex_unlock(&pool_lock);
+}
+
+/* Returns the current number of worker threads in the pool. */
+int pool_size()
+{
+    return atomic_load(&worker_count);
+}
+
+/*
+ * Queues a task on the pool. Tasks submitted from outside the pool are
+ * distributed round robin across the worker queues, tasks submitted from a
+ * worker go onto that worker's own queue. Idle workers steal from the others.
+ */
+void pool_submit(void (*function)(void *), void *arg)
+{
+    task t = {function, arg};
+    int target = current_worker;
+
+    pthread_mutex_lock(&pool_lock);
+    if (atomic_load(&worker_count) == 0) {add_worker();}
+    if (target < 0) {
+        target = next_queue % atomic_load(&worker_count);
+        next_queue = target + 1;
+    }
+    pending++;
+    pthread_mutex_unlock(&pool_lock);
+
+    push_task(workers[target], t);
+
+    pthread_mutex_lock(&pool_lock);
+    queued++;
+    pthread_cond_signal(&work_ready);
+    pthread_mutex_unlock(&pool_lock);
+}
+
+/*
+ * Blocks until every submitted task has finished. Must not be called from
+ * inside a task.
+ */
+void pool_wait()
+{
+    if (current_worker >= 0) {error("pool_wait called from inside the pool");}
+    pthread_mutex_lock(&pool_lock);
+    while (pending > 0) {
+        pthread_cond_wait(&work_done, &pool_lock);
+    }
+    pthread_mutex_unlock(&pool_lock);
+}
+
+/* Stops and joins all workers, then frees the pool. */
+void destroy_pool()
+{
+    pthread_mutex_lock(&pool_lock);
+    shutting_down = 1;
+    pthread_cond_broadcast(&work_ready);
+    pthread_mutex_unlock(&pool_lock);
+
+    /* join every worker before freeing any, a worker may still be stealing */
+    int total = atomic_load(&worker_count);
+    for (int i = 0; i < total; i++) {
+        pthread_join(workers[i]->thread, NULL);
+    }
+    for (int i = 0; i < total; i++) {
+        pthread_mutex_destroy(&workers[i]->lock);
+        free(workers[i]->tasks);
+        free(workers[i]);
+        workers[i] = NULL;
+    }
+    atomic_store(&worker_count, 0);
+    shutting_down = 0;
+}
@@ -0,0 +1,510 @@
+/*
+ * scorer.c - Specialized scorers for the GULAG.
+ *
+ * single_analyze interprets the stat tables: for every stat on every call it
+ * unflattens each ngram into grid coordinates and builds the frequency index
+ * with runtime multiplies by LANG_LENGTH. Within one run all of that is fixed,
+ * so with --specialize the scorer is written out as C with the key offsets,
+ * the alphabet size, the gathered stats, the partition sums and the meta
+ * weights as constants, compiled once with the system compiler and loaded
+ * with dlopen. Compiled scorers are kept in './data/scorers' under a hash of
+ * their source, the compiler and the cpu they were tuned for, so the same
+ * configuration is only compiled once per machine, and only the most
+ * recently used ones are kept.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "scorer.h"
+#include "io.h"
+#include "util.h"
+#include "global.h"
+#include "structs.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCORER_X86 1
+#include <cpuid.h>
+#else
+#define SCORER_X86 0
+#endif
+
+/* Directory of the compiled scorers. */
+#define SCORER_DIR "./data/scorers"
+
+/* The most compiled scorers kept, the least recently used are removed. */
+#define SCORER_LIMIT 16
+
+/*
+ * Flags the scorers are compiled with, part of their key. Sums are not
+ * reassociated, so they match the scalar gather kernel exactly. Only on x86
+ * is the cpu identified for the key, so only there are scorers tuned to it.
+ */
+#if SCORER_X86
+#define SCORER_FLAGS "-O2 -march=native -fPIC -shared"
+#else
+#define SCORER_FLAGS "-O2 -fPIC -shared"
+#endif
+
+/* Stats with at most this many ngrams are unrolled, larger ones loop over a table. */
+#define UNROLL_LIMIT 64
+
+/* Binds the frequency arrays the loaded scorer reads. */
+typedef void (*bind_function)(const float *mono, const float *bi, const float *tri,
+    const float *quad, const float *skip);
+
+scorer_function specialized_scorer = NULL;
+static void *scorer_handle = NULL;
+
+/*
+ * Writes a float as an exact C constant.
+ * Parameters:
+ *   out:   The source being written.
+ *   value: The value.
+ */
+static void emit_float(FILE *out, float value)
+{
+    if (isnan(value)) {fprintf(out, "__builtin_nanf(\"\")");}
+    else if (isinf(value)) {fprintf(out, value < 0 ? "(-__builtin_inff())" : "__builtin_inff()");}
+    else {fprintf(out, "%af", value);}
+}
+
+/*
+ * Finds the key of an ngram in the layout matrix.
+ * Parameters:
+ *   ngram: The flat index of the ngram.
+ *   key:   Which key of the ngram, from 0.
+ *   keys:  The number of keys in the ngram.
+ * Returns: The offset of the key in the matrix viewed as MAX_ROW * MAX_COL ints.
+ */
+static int key_offset(int ngram, int key, int keys)
+{
+    for (int i = keys - 1; i > key; i--) {ngram /= DIM1;}
+    int position = ngram % DIM1;
+    return position / COL * MAX_COL + position % COL;
+}
+
+/*
+ * Writes the accumulation of one ngram: if all of its keys hold a character,
+ * its frequency is added to every target.
+ * Parameters:
+ *   out:    The source being written.
+ *   indent: Leading spaces of the line.
+ *   offset: The matrix offset of each key, as C expressions.
+ *   keys:   The number of keys in the ngram.
+ *   array:  The frequency array.
+ *   bases:  The constant start of each target in the array.
+ *   count:  The number of targets.
+ */
+static void emit_ngram(FILE *out, const char *indent, char offset[][32], int keys,
+    const char *array, const int *bases, int count)
+{
+    fprintf(out, "%sif (", indent);
+    for (int k = 0; k < keys; k++) {
+        fprintf(out, "%s(%c = m[%s]) != -1", k ? " && " : "", 'a' + k, offset[k]);
+    }
+    fprintf(out, ") {int x = ");
+    long stride = 1;
+    for (int k = 1; k < keys; k++) {stride *= LANG_LENGTH;}
+    for (int k = 0; k < keys; k++, stride /= LANG_LENGTH) {
+        fprintf(out, "%s%c", k ? " + " : "", 'a' + k);
+        if (stride > 1) {fprintf(out, " * %ld", stride);}
+    }
+    fprintf(out, ";");
+    for (int t = 0; t < count; t++) {
+        if (bases[t] != 0) {fprintf(out, " s%d += %s[%d + x];", t, array, bases[t]);}
+        else {fprintf(out, " s%d += %s[x];", t, array);}
+    }
+    fprintf(out, "}\n");
+}
+
+/*
+ * Writes the gathering of one stat into one or more targets, each the sum of
+ * the frequencies of the stat's ngrams in its own block of the array, in list
+ * order, the order the scalar gather kernel adds them. The skipgram distances of a stat share one
+ * pass over its ngrams this way.
+ * Parameters:
+ *   out:     The source being written.
+ *   ngrams:  The flat indices of the ngrams of the stat.
+ *   length:  The number of ngrams.
+ *   keys:    The number of keys in an ngram.
+ *   array:   The frequency array.
+ *   bases:   The constant start of each target in the array.
+ *   targets: The score each target is stored to, as C expressions.
+ *   count:   The number of targets.
+ */
+static void emit_gather(FILE *out, const int *ngrams, int length, int keys,
+    const char *array, const int *bases, char targets[][32], int count)
+{
+    char offset[4][32];
+    fprintf(out, "    {\n");
+    for (int t = 0; t < count; t++) {fprintf(out, "        float s%d = 0;\n", t);}
+    if (length > UNROLL_LIMIT) {
+        /* a table of key offsets with a constant trip count */
+        fprintf(out, "        static const unsigned char table[%d][%d] = {", length, keys);
+        for (int j = 0; j < length; j++) {
+            fprintf(out, "%s{", j % 8 == 0 ? "\n            " : "");
+            for (int k = 0; k < keys; k++) {fprintf(out, "%s%d", k ? "," : "", key_offset(ngrams[j], k, keys));}
+            fprintf(out, "},");
+        }
+        fprintf(out, "\n        };\n");
+        fprintf(out, "        for (int j = 0; j < %d; j++) {\n", length);
+        for (int k = 0; k < keys; k++) {sprintf(offset[k], "table[j][%d]", k);}
+        emit_ngram(out, "            ", offset, keys, array, bases, count);
+        fprintf(out, "        }\n");
+    } else {
+        for (int j = 0; j < length; j++) {
+            for (int k = 0; k < keys; k++) {sprintf(offset[k], "%d", key_offset(ngrams[j], k, keys));}
+            emit_ngram(out, "        ", offset, keys, array, bases, count);
+        }
+    }
+    for (int t = 0; t < count; t++) {fprintf(out, "        %s = s%d;\n", targets[t], t);}
+    fprintf(out, "    }\n");
+}
+
+/*
+ * Writes the sums of the stats planned as unions of disjoint stats.
+ * Parameters:
+ *   out:    The source being written.
+ *   plan:   The plan of one ngram type.
+ *   scores: The score array of that type.
+ */
+static void emit_partitions(FILE *out, const stat_plan *plan, const char *scores)
+{
+    for (int d = 0; d < plan->derived_count; d++)
+    {
+        fprintf(out, "    %s[%d] = 0", scores, plan->derived[d]);
+        for (int c = plan->child_start[d]; c < plan->child_start[d + 1]; c++) {
+            fprintf(out, " + %s[%d]", scores, plan->children[c]);
+        }
+        fprintf(out, ";\n");
+    }
+}
+
+/*
+ * Writes the C source of the scorer for the current configuration: a bind
+ * function taking the frequency arrays, and a score function computing the
+ * same stats single_analyze does.
+ * Parameters:
+ *   out: The source being written.
+ */
+static void emit_scorer(FILE *out)
+{
+    char targets[10][32];
+    int bases[10] = {0};
+
+    fprintf(out, "/* Scorer generated by the GULAG, version %d, for a %d character language. */\n\n",
+        SCORER_VERSION, LANG_LENGTH);
+    fprintf(out, "static const float *mono, *bi, *tri, *quad, *skip;\n\n");
+    fprintf(out, "void gulag_bind(const float *m, const float *b, const float *t, const float *q, const float *s)\n");
+    fprintf(out, "{\n    mono = m;\n    bi = b;\n    tri = t;\n    quad = q;\n    skip = s;\n}\n\n");
+    fprintf(out, "void gulag_score(const int *m, float *ms, float *bs, float *ts, float *qs, float **ss, float *meta)\n");
+    fprintf(out, "{\n    int a, b, c, d;\n");
+
+    for (int i = 0; i < MONO_LENGTH; i++)
+    {
+        if (!plan_mono.gathered[i]) {continue;}
+        sprintf(targets[0], "ms[%d]", i);
+        emit_gather(out, stats_mono[i].ngrams, stats_mono[i].length, 1, "mono", bases, targets, 1);
+    }
+    emit_partitions(out, &plan_mono, "ms");
+
+    for (int i = 0; i < BI_LENGTH; i++)
+    {
+        if (!plan_bi.gathered[i]) {continue;}
+        sprintf(targets[0], "bs[%d]", i);
+        emit_gather(out, stats_bi[i].ngrams, stats_bi[i].length, 2, "bi", bases, targets, 1);
+    }
+    emit_partitions(out, &plan_bi, "bs");
+
+    for (int i = 0; i < TRI_LENGTH; i++)
+    {
+        if (!plan_tri.gathered[i]) {continue;}
+        sprintf(targets[0], "ts[%d]", i);
+        emit_gather(out, stats_tri[i].ngrams, stats_tri[i].length, 3, "tri", bases, targets, 1);
+    }
+    emit_partitions(out, &plan_tri, "ts");
+
+    for (int i = 0; i < QUAD_LENGTH; i++)
+    {
+        if (!plan_quad.gathered[i]) {continue;}
+        sprintf(targets[0], "qs[%d]", i);
+        emit_gather(out, stats_quad[i].ngrams, stats_quad[i].length, 4, "quad", bases, targets, 1);
+    }
+    emit_partitions(out, &plan_quad, "qs");
+
+    for (int i = 0; i < SKIP_LENGTH; i++)
+    {
+        if (stats_skip[i].skip || stats_skip[i].distance_count == 0) {continue;}
+        int count = stats_skip[i].distance_count;
+        for (int d = 0; d < count; d++)
+        {
+            int k = stats_skip[i].distances[d];
+            bases[d] = k * LANG_LENGTH * LANG_LENGTH;
+            sprintf(targets[d], "ss[%d][%d]", k, i);
+        }
+        emit_gather(out, stats_skip[i].ngrams, stats_skip[i].length, 2, "skip", bases, targets, count);
+        memset(bases, 0, sizeof(bases));
+    }
+
+    for (int i = 0; i < META_LENGTH; i++)
+    {
+        if (stats_meta[i].skip) {continue;}
+        fprintf(out, "    {\n        float s = 0;\n");
+        for (int j = 0; stats_meta[i].stat_types[j] != 'x'; j++)
+        {
+            char type = stats_meta[i].stat_types[j];
+            int index = stats_meta[i].stat_indices[j];
+            switch(type) {
+            case 'b': fprintf(out, "        s += bs[%d] * ", index); break;
+            case 't': fprintf(out, "        s += ts[%d] * ", index); break;
+            case 'q': fprintf(out, "        s += qs[%d] * ", index); break;
+            default:
+                if (type >= '1' && type <= '9') {fprintf(out, "        s += ss[%d][%d] * ", type - '0', index);}
+                else {fprintf(out, "        s += ms[%d] * ", index);}
+                break;
+            }
+            emit_float(out, stats_meta[i].stat_weights[j]);
+            fprintf(out, ";\n");
+        }
+        if (stats_meta[i].absv) {fprintf(out, "        if (s < 0) {s = -s;}\n");}
+        fprintf(out, "        meta[%d] = s;\n    }\n", i);
+    }
+    fprintf(out, "}\n");
+}
+
+/*
+ * Adds bytes to an FNV-1a hash.
+ * Parameters:
+ *   hash:  The hash so far.
+ *   bytes: The bytes.
+ *   size:  Their number.
+ * Returns: The new hash.
+ */
+static uint64_t hash_bytes(uint64_t hash, const void *bytes, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {hash = (hash ^ ((const unsigned char *)bytes)[i]) * 1099511628211ULL;}
+    return hash;
+}
+
+/*
+ * Adds the identity of the cpu -march=native tunes for to a hash: the vendor,
+ * the family, model and stepping, and every feature word, so a scorer is
+ * never loaded on a cpu lacking an instruction it was compiled with.
+ * Parameters:
+ *   hash: The hash so far.
+ * Returns: The new hash.
+ */
+static uint64_t hash_cpu(uint64_t hash)
+{
+#if SCORER_X86
+    unsigned int regs[4] = {0};
+    unsigned int max_leaf = __get_cpuid_max(0, regs + 1);
+    hash = hash_bytes(hash, regs, sizeof(regs));
+    if (max_leaf >= 1 && __get_cpuid(1, regs, regs + 1, regs + 2, regs + 3)) {
+        /* the initial apic id differs between cores */
+        regs[1] &= 0x00FFFFFF;
+        hash = hash_bytes(hash, regs, sizeof(regs));
+    }
+    for (unsigned int sub = 0; max_leaf >= 7 && sub <= 1; sub++) {
+        if (__get_cpuid_count(7, sub, regs, regs + 1, regs + 2, regs + 3)) {hash = hash_bytes(hash, regs, sizeof(regs));}
+    }
+    if (__get_cpuid(0x80000001, regs, regs + 1, regs + 2, regs + 3)) {hash = hash_bytes(hash, regs, sizeof(regs));}
+#endif
+    return hash;
+}
+
+/*
+ * Hashes the scorer source with the compiler, its flags and the cpu.
+ * Parameters:
+ *   source:   The source.
+ *   size:     Its length.
+ *   compiler: The compiler command.
+ * Returns: The 64-bit FNV-1a hash.
+ */
+static uint64_t scorer_key(const char *source, size_t size, const char *compiler)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    hash = hash_bytes(hash, source, size);
+    hash = hash_bytes(hash, compiler, strlen(compiler));
+    hash = hash_bytes(hash, SCORER_FLAGS, strlen(SCORER_FLAGS));
+    return hash_cpu(hash);
+}
+
+/* One compiled scorer while the directory is pruned. */
+typedef struct scorer_file {
+    char name[64];
+    struct timespec used;
+} scorer_file;
+
+/*
+ * Orders compiled scorers by last use, the most recent first, for qsort.
+ */
+static int compare_used(const void *a, const void *b)
+{
+    const scorer_file *x = (const scorer_file *)a, *y = (const scorer_file *)b;
+    if (x->used.tv_sec != y->used.tv_sec) {return x->used.tv_sec < y->used.tv_sec ? 1 : -1;}
+    if (x->used.tv_nsec != y->used.tv_nsec) {return x->used.tv_nsec < y->used.tv_nsec ? 1 : -1;}
+    return strcmp(x->name, y->name);
+}
+
+/*
+ * Removes the least recently used compiled scorers beyond SCORER_LIMIT. A
+ * scorer's modification time is its last use, it is touched on every load.
+ * Files that are not <hash>.so, such as another run's temporaries, are left
+ * alone.
+ * Parameters:
+ *   keep: The path of the scorer in use, never removed.
+ */
+static void prune_scorers(const char *keep)
+{
+    DIR *dir = opendir(SCORER_DIR);
+    if (dir == NULL) {return;}
+    int count = 0, capacity = SCORER_LIMIT + 1;
+    scorer_file *files = (scorer_file *)malloc(sizeof(scorer_file) * capacity);
+    if (files == NULL) {error("failed to malloc scorer list");}
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strlen(entry->d_name) != 19 || strcmp(entry->d_name + 16, ".so") != 0
+            || strspn(entry->d_name, "0123456789abcdef") != 16) {continue;}
+        char path[128];
+        struct stat info;
+        snprintf(path, sizeof(path), "%s/%s", SCORER_DIR, entry->d_name);
+        if (strcmp(path, keep) == 0 || stat(path, &info) != 0) {continue;}
+        if (count == capacity) {
+            capacity *= 2;
+            files = (scorer_file *)realloc(files, sizeof(scorer_file) * capacity);
+            if (files == NULL) {error("failed to realloc scorer list");}
+        }
+        strcpy(files[count].name, entry->d_name);
+        files[count].used = info.st_mtim;
+        count++;
+    }
+    closedir(dir);
+
+    qsort(files, count, sizeof(scorer_file), compare_used);
+    /* the scorer in use takes one of the places */
+    for (int i = SCORER_LIMIT - 1; i < count; i++) {
+        char path[128];
+        snprintf(path, sizeof(path), "%s/%s", SCORER_DIR, files[i].name);
+        remove(path);
+    }
+    free(files);
+}
+
+/*
+ * Compiles the scorer source into a shared object. The object is built under
+ * a temporary name and renamed into place, so a concurrent run never loads a
+ * half written one.
+ * Parameters:
+ *   source:   The source.
+ *   size:     Its length.
+ *   compiler: The compiler command.
+ *   key:      The key of the scorer.
+ *   path:     Where the shared object goes.
+ * Returns: 1 if it was compiled, 0 if there is no working compiler.
+ */
+static int compile_scorer(const char *source, size_t size, const char *compiler, uint64_t key, const char *path)
+{
+    char source_path[128], object_path[128], command[512];
+    mkdir(SCORER_DIR, 0755);
+    snprintf(source_path, sizeof(source_path), "%s/%016llx.%d.c", SCORER_DIR, (unsigned long long)key, (int)getpid());
+    snprintf(object_path, sizeof(object_path), "%s/%016llx.%d.so", SCORER_DIR, (unsigned long long)key, (int)getpid());
+
+    FILE *file = fopen(source_path, "w");
+    if (file == NULL) {return 0;}
+    int written = fwrite(source, 1, size, file) == size;
+    written &= fclose(file) == 0;
+    if (!written) {remove(source_path); return 0;}
+
+    snprintf(command, sizeof(command), "%s " SCORER_FLAGS " -o %s %s > /dev/null 2>&1",
+        compiler, object_path, source_path);
+    int status = system(command);
+    remove(source_path);
+    if (status == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        remove(object_path);
+        return 0;
+    }
+    if (rename(object_path, path) != 0) {remove(object_path); return 0;}
+    return 1;
+}
+
+/*
+ * Emits C source computing every stat single_analyze would for the current
+ * stat set, weights, keyboard and language, with all of them folded in as
+ * constants. The source is compiled with the system compiler ($CC, or cc)
+ * into './data/scorers/<hash>.so', loaded, and used by single_analyze in
+ * place of the generic loops. A scorer already compiled for the same source
+ * on the same cpu is loaded without compiling, and only the SCORER_LIMIT most
+ * recently used scorers are kept. Without a compiler, or for languages too large
+ * for dense arrays, the generic scorer stays in use. Must run after the stats
+ * are cleaned and the frequencies normalized.
+ */
+void build_scorer()
+{
+    /* the generated code indexes dense arrays only */
+    if (sparse_tri != NULL || sparse_quad != NULL || sparse_skip != NULL) {
+        log_print('n',L"language too large, keeping the generic scorer... ");
+        return;
+    }
+
+    char *source = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&source, &size);
+    if (out == NULL) {error("failed to open scorer source");}
+    emit_scorer(out);
+    fclose(out);
+
+    const char *compiler = getenv("CC");
+    if (compiler == NULL || *compiler == '\0') {compiler = "cc";}
+    uint64_t key = scorer_key(source, size, compiler);
+    char path[128];
+    snprintf(path, sizeof(path), "%s/%016llx.so", SCORER_DIR, (unsigned long long)key);
+
+    if (access(path, R_OK) == 0) {
+        log_print('n',L"cached... ");
+        /* mark it used, so pruning keeps it */
+        utime(path, NULL);
+    } else {
+        log_print('n',L"compiling... ");
+        if (!compile_scorer(source, size, compiler, key, path)) {
+            free(source);
+            log_print('n',L"no working compiler, keeping the generic scorer... ");
+            return;
+        }
+        prune_scorers(path);
+    }
+    free(source);
+
+    scorer_handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (scorer_handle == NULL) {
+        log_print('n',L"failed to load %s, keeping the generic scorer... ", path);
+        return;
+    }
+    bind_function bind = (bind_function)dlsym(scorer_handle, "gulag_bind");
+    scorer_function score = (scorer_function)dlsym(scorer_handle, "gulag_score");
+    if (bind == NULL || score == NULL) {
+        log_print('n',L"%s is not a scorer, keeping the generic scorer... ", path);
+        free_scorer();
+        return;
+    }
+    bind(linear_mono, linear_bi, linear_tri, linear_quad, linear_skip);
+    specialized_scorer = score;
+}
+
+/* Unloads the specialized scorer, if any. */
+void free_scorer()
+{
+    specialized_scorer = NULL;
+    if (scorer_handle != NULL) {dlclose(scorer_handle);}
+    scorer_handle = NULL;
+}
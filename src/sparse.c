@@ -0,0 +1,175 @@
+/*
+ * sparse.c - Sparse ngram frequency tables for the GULAG.
+ *
+ * Open addressing hash tables with linear probing, keyed by the flat ngram
+ * index. Keys, counts and values are kept in separate arrays so a lookup only
+ * touches the keys until it finds its slot. The load factor is kept at or
+ * below one half so probe sequences stay short.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sparse.h"
+#include "util.h"
+
+/*
+ * Allocates the slot arrays of a table, counts and values only if the table
+ * is meant to hold them.
+ * Parameters:
+ *   t:        The table.
+ *   capacity: The number of slots, a power of 2.
+ *   counts:   Whether to allocate raw counts.
+ *   values:   Whether to allocate normalized values.
+ */
+static void alloc_slots(sparse_table *t, size_t capacity, int counts, int values)
+{
+    t->keys = (uint64_t *)calloc(capacity, sizeof(uint64_t));
+    t->counts = counts ? (long long *)calloc(capacity, sizeof(long long)) : NULL;
+    t->values = values ? (float *)calloc(capacity, sizeof(float)) : NULL;
+    if (t->keys == NULL || (counts && t->counts == NULL) || (values && t->values == NULL)) {
+        error("failed to calloc sparse table");
+    }
+    t->mask = capacity - 1;
+    t->used = 0;
+}
+
+/*
+ * Allocates an empty sparse table.
+ */
+sparse_table *create_sparse(size_t capacity)
+{
+    sparse_table *t = (sparse_table *)malloc(sizeof(sparse_table));
+    if (t == NULL) {error("failed to malloc sparse table");}
+    size_t slots = 16;
+    while (slots < capacity * 2) {slots *= 2;}
+    alloc_slots(t, slots, 1, 0);
+    return t;
+}
+
+/*
+ * Frees a sparse table, NULL is ignored.
+ */
+void free_sparse(sparse_table *t)
+{
+    if (t == NULL) {return;}
+    free(t->keys);
+    free(t->counts);
+    free(t->values);
+    free(t);
+}
+
+/*
+ * Finds the slot of an ngram, claiming an empty one if it is new. The caller
+ * grows the table once it is filled in.
+ * Parameters:
+ *   t:     The table.
+ *   index: The flat index of the ngram.
+ * Returns: The slot of the ngram.
+ */
+static size_t claim_slot(sparse_table *t, uint64_t index)
+{
+    uint64_t key = index + 1;
+    size_t slot = sparse_slot(t, index);
+    while (t->keys[slot] != 0) {
+        if (t->keys[slot] == key) {return slot;}
+        slot = (slot + 1) & t->mask;
+    }
+    t->keys[slot] = key;
+    t->used++;
+    return slot;
+}
+
+/*
+ * Doubles the capacity of a table once it is half full and reinserts every
+ * entry with its count and value.
+ * Parameters:
+ *   t: The table.
+ */
+static void grow_sparse(sparse_table *t)
+{
+    if (t->used * 2 <= t->mask + 1) {return;}
+    uint64_t *keys = t->keys;
+    long long *counts = t->counts;
+    float *values = t->values;
+    size_t capacity = t->mask + 1;
+    alloc_slots(t, capacity * 2, counts != NULL, values != NULL);
+    for (size_t i = 0; i < capacity; i++) {
+        if (keys[i] == 0) {continue;}
+        size_t slot = claim_slot(t, keys[i] - 1);
+        if (counts != NULL) {t->counts[slot] = counts[i];}
+        if (values != NULL) {t->values[slot] = values[i];}
+    }
+    free(keys);
+    free(counts);
+    free(values);
+}
+
+/*
+ * Adds to the raw count of an ngram, inserting it if it is new.
+ */
+void sparse_add(sparse_table *t, uint64_t index, long long count)
+{
+    t->counts[claim_slot(t, index)] += count;
+    grow_sparse(t);
+}
+
+/*
+ * Adds to the normalized frequency of an ngram, inserting it if it is new.
+ */
+void sparse_add_value(sparse_table *t, uint64_t index, float value)
+{
+    if (t->values == NULL) {
+        t->values = (float *)calloc(t->mask + 1, sizeof(float));
+        if (t->values == NULL) {error("failed to calloc sparse values");}
+    }
+    t->values[claim_slot(t, index)] += value;
+    grow_sparse(t);
+}
+
+/*
+ * Adds every raw count of one table to another.
+ */
+void merge_sparse(sparse_table *dest, const sparse_table *src)
+{
+    for (size_t i = 0; i <= src->mask; i++) {
+        if (src->keys[i] != 0) {sparse_add(dest, src->keys[i] - 1, src->counts[i]);}
+    }
+}
+
+/*
+ * Converts the raw counts to percentages of the total of their group, the way
+ * normalize_corpus treats the dense arrays. The raw counts are kept.
+ */
+void normalize_sparse(sparse_table *t, uint64_t group)
+{
+    size_t capacity = t->mask + 1;
+    uint64_t groups = 1;
+    for (size_t i = 0; i < capacity; i++) {
+        if (t->keys[i] != 0 && (t->keys[i] - 1) / group >= groups) {groups = (t->keys[i] - 1) / group + 1;}
+    }
+    long long *totals = (long long *)calloc(groups, sizeof(long long));
+    free(t->values);
+    t->values = (float *)calloc(capacity, sizeof(float));
+    if (totals == NULL || t->values == NULL) {error("failed to calloc sparse normalization");}
+
+    for (size_t i = 0; i < capacity; i++) {
+        if (t->keys[i] != 0) {totals[(t->keys[i] - 1) / group] += t->counts[i];}
+    }
+    for (size_t i = 0; i < capacity; i++) {
+        if (t->keys[i] == 0) {continue;}
+        long long total = totals[(t->keys[i] - 1) / group];
+        if (total > 0) {t->values[i] = (float)t->counts[i] * 100 / total;}
+    }
+    free(totals);
+}
+
+/*
+ * Frees the raw counts of a normalized table, NULL is ignored.
+ */
+void free_sparse_counts(sparse_table *t)
+{
+    if (t == NULL) {return;}
+    free(t->counts);
+    t->counts = NULL;
+}
@@ -14,21 +14,22 @@
 #include "quad.h"
 #include "skip.h"
 #include "meta.h"
+#include "plan.h"
+#include "custom.h"
+#include "stats_cache.h"
 
 #include "global.h"
 #include "structs.h"
 #include "io.h"
 
 /*
- * Initializes all statistic data structures for the GULAG. This involves
- * initializing arrays for each type of n-gram statistic as well as
- * meta-statistics. The function delegates the initialization of each statistic
- * type to its respective module.
+ * Builds the monogram to skipgram stats by classifying every ngram of the
+ * grid. The hand written stats are trimmed to their ngrams afterwards, the
+ * classified ones are built that way.
  */
-void initialize_stats()
+static void build_stats()
 {
     /* initializes array for monogram stats */
-    log_print('v',L"\n");
     log_print('v',L"     Initializing monogram stats... ");
     initialize_mono_stats(); /* stats/mono.c */
     log_print('v',L"trimming monogram stats... ");
@@ -45,15 +46,11 @@ void initialize_stats()
     /* initializes array for trigram stats */
     log_print('v',L"     Initializing trigram stats...  ");
     initialize_tri_stats(); /* stats/tri.c */
-    log_print('v',L"trimming trigram stats...  ");
-    trim_tri_stats(); /* stats/tri.c */
     log_print('v',L"Done\n");
 
     /* initializes array for quadgram stats */
     log_print('v',L"     Initializing quadgram stats... ");
     initialize_quad_stats(); /* stats/quad.c */
-    log_print('v',L"trimming quadgram stats... ");
-    trim_quad_stats(); /* stats/quad.c */
     log_print('v',L"Done\n");
 
     /* initializes array for skipgram stats */
@@ -63,6 +60,41 @@ void initialize_stats()
     trim_skip_stats(); /* stats/skip.c */
     log_print('v',L"Done\n");
 
+    /* appends the custom stats to the stats of their type */
+    if (custom_stat_count() > 0) { /* stats/custom.c */
+        log_print('v',L"     Initializing custom stats...   ");
+        initialize_custom_stats(); /* stats/custom.c */
+        log_print('v',L"Done\n");
+    }
+}
+
+/*
+ * Initializes all statistic data structures for the GULAG. This involves
+ * initializing arrays for each type of n-gram statistic as well as
+ * meta-statistics. The function delegates the initialization of each statistic
+ * type to its respective module.
+ */
+void initialize_stats()
+{
+    log_print('v',L"\n");
+    if (custom_stats_name != NULL) {
+        log_print('v',L"     Reading custom stats... ");
+        read_custom_stats(); /* stats/custom.c */
+        log_print('v',L"%d defined\n", custom_stat_count()); /* stats/custom.c */
+    }
+
+    /* the cache key covers the custom stats, so it holds them as well */
+    if (read_stats_cache()) { /* stats_cache.c */
+        log_print('v',L"     Stats cache found... ");
+    } else {
+        build_stats();
+        log_print('v',L"     Caching stats... ");
+        write_stats_cache(); /* stats_cache.c */
+    }
+    default_heatmap_weights(); /* stats/mono.c */
+    default_custom_weights(); /* stats/custom.c */
+    log_print('v',L"Done\n");
+
     /* initializes array for meta stats */
     log_print('v',L"     Initializing meta stats...     ");
     initialize_meta_stats(); /* stats/meta.c */
@@ -71,6 +103,27 @@ void initialize_stats()
     log_print('v',L"Done\n");
 }
 
+/*
+ * Logs how many stats, and skip distances of skipgram stats, are evaluated
+ * for every layout once the weights are known.
+ */
+static void log_plan()
+{
+    int stats = 0, total = MONO_LENGTH + BI_LENGTH + TRI_LENGTH + QUAD_LENGTH + SKIP_LENGTH + META_LENGTH;
+    int distances = 0;
+    for (int i = 0; i < MONO_LENGTH; i++) {stats += !stats_mono[i].skip;}
+    for (int i = 0; i < BI_LENGTH; i++) {stats += !stats_bi[i].skip;}
+    for (int i = 0; i < TRI_LENGTH; i++) {stats += !stats_tri[i].skip;}
+    for (int i = 0; i < QUAD_LENGTH; i++) {stats += !stats_quad[i].skip;}
+    for (int i = 0; i < SKIP_LENGTH; i++) {
+        stats += !stats_skip[i].skip;
+        distances += stats_skip[i].distance_count;
+    }
+    for (int i = 0; i < META_LENGTH; i++) {stats += !stats_meta[i].skip;}
+    log_print('v',L"     Evaluating %d of %d stats, %d summed from partitions, %d of %d skipgram distances\n",
+        stats, total, derived_count(), distances, SKIP_LENGTH * 9); /* stats/plan.c */
+}
+
 /*
  * Cleans the statistics data by skipping entries with zero length or weight.
  * This function iterates through each category of statistics (monograms,
@@ -106,6 +159,14 @@ void clean_stats()
     log_print('v',L"defining meta stats... ");
     define_meta_stats(); /* stats/meta.c */
     log_print('v',L"Done\n");
+
+    /* meta stats may have brought back skipped stats, plan what remains */
+    log_print('v',L"     Planning skipgram distances... ");
+    plan_skip_stats(); /* stats/skip.c */
+    log_print('v',L"partitions... ");
+    plan_partitions(); /* stats/plan.c */
+    log_print('v',L"Done\n");
+    log_plan();
 }
 
 /*
@@ -140,4 +201,12 @@ void free_stats()
     log_print('v',L"     Freeing meta stats... ");
     free_meta_stats(); /* stats/meta.c */
     log_print('v',L"Done\n");
+
+    log_print('v',L"     Freeing stat plans... ");
+    free_plans(); /* stats/plan.c */
+    log_print('v',L"Done\n");
+
+    log_print('v',L"     Freeing custom stats... ");
+    free_custom_stats(); /* stats/custom.c */
+    log_print('v',L"Done\n");
 }
@@ -9,13 +9,14 @@
  *     1. Incease BI_LENGTH by as many stats as you are adding.
  *     2. Define its name, keep it a reasonable length.
  *     3. Set its weight to -INFINITY, and skip to 0 (to be changed later).
- *     4. Set its length to 0, then loop through the DIM2 (36^2) sequences.
+ *     4. Set its length to 0, then loop through the DIM2 sequences of the grid.
  *       4a. Use unflat_bi() to convert the 1D index to a set of 2D coordinates.
  *       4b. Check if the ngram falls under the stat.
  *       4c. If it does, add it to the ngrams array and increment length.
  *       4d. Otherwise set the ngram array element to -1.
  *     5. Iterate the index.
  *     6. Add the statistic to the weights files in data/weights/.
+ *     7. Increase STATS_VERSION in stats_cache.h so cached stats are rebuilt.
  */
 
 #include <string.h>
@@ -37,6 +38,7 @@ void initialize_bi_stats()
 {
     BI_LENGTH = 27;
     stats_bi = (bi_stat *)malloc(sizeof(bi_stat) * BI_LENGTH);
+    for (int i = 0; i < BI_LENGTH; i++) {stats_bi[i].ngrams = full_ngrams(DIM2);} /* stats_util.c */
     int row0, col0, row1, col1;
     int index = 0;
 
@@ -565,40 +567,14 @@ void initialize_bi_stats()
 }
 
 /*
- * Trims the ngrams in the array to move unused entries to the end.
- * This process ensures memory efficiency by eliminating gaps in the array.
+ * Trims the ngram array of every stat down to the ngrams in it, dropping the
+ * -1 entries and any ngram touching a gap of the keyboard.
  */
 void trim_bi_stats()
 {
     for (int i = 0; i < BI_LENGTH; i++)
     {
-        if (stats_bi[i].length != 0)
-        {
-            int left = 0;
-            int right = DIM2 - 1;
-
-            /* Use two pointers to partition the array */
-            while (left < right) {
-                /* Find the next -1 from the left */
-                while (left < right && stats_bi[i].ngrams[left] != -1) {
-                    left++;
-                }
-
-                /* Find the next non -1 from the right */
-                while (left < right && stats_bi[i].ngrams[right] == -1) {
-                    right--;
-                }
-
-                /* Swap the elements to move -1 to the back and non -1 to the front */
-                if (left < right) {
-                    int temp = stats_bi[i].ngrams[left];
-                    stats_bi[i].ngrams[left] = stats_bi[i].ngrams[right];
-                    stats_bi[i].ngrams[right] = temp;
-                    left++;
-                    right--;
-                }
-            }
-        }
+        pack_ngrams(&stats_bi[i].ngrams, &stats_bi[i].length, DIM2, 2); /* stats_util.c */
     }
 }
 
@@ -619,5 +595,6 @@ void clean_bi_stats()
 /* Frees the memory allocated for the bigram statistics array. */
 void free_bi_stats()
 {
+    for (int i = 0; i < BI_LENGTH; i++) {free(stats_bi[i].ngrams);}
     free(stats_bi);
 }
@@ -0,0 +1,679 @@
+/*
+ * stats/custom.c - User defined statistic definitions.
+ *
+ * Custom stats are declared in a text file instead of in C, one per line:
+ *
+ *     bigram Top Row Same Hand: hand0 = hand1 & row0 = 0 & row1 = 0
+ *
+ * The condition compares attributes of the keys of the ngram with each other
+ * or with values, joined with '&' and alternated with '|', '&' binding
+ * tighter. The stats are appended to the built-in stats of their type and
+ * classified into the same ngram arrays, which are cached with the others, so
+ * they cost exactly as much to score and need no rebuild of the program.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#include "custom.h"
+#include "util.h"
+#include "stats_util.h"
+#include "global.h"
+#include "structs.h"
+
+/* Most comparisons in the condition of one custom stat. */
+#define CUSTOM_TERMS 32
+
+/* Longest line of a custom stats file. */
+#define CUSTOM_LINE 512
+
+/* Values of the hand and dir attributes. */
+enum custom_values {
+    HAND_LEFT = 0,
+    HAND_RIGHT = 1,
+    /* dir of a key typed with the other hand than the key before */
+    DIR_SWITCH = 0,
+    /* dir of a key typed with the same finger as the key before */
+    DIR_SAME = 1,
+    /* dir of a key typed with a finger closer to the index than the one before */
+    DIR_IN = 2,
+    DIR_OUT = 3,
+};
+
+/* One side of a comparison, an attribute of a key or a value. */
+typedef struct custom_operand {
+    /* 'f'inger, 'h'and, 'r'ow, 'c'ol, 's'tretch, 'd'ir, or 0 for a value */
+    char attribute;
+    /* the key of the ngram, from 0 */
+    int position;
+    int value;
+} custom_operand;
+
+typedef struct custom_term {
+    custom_operand left;
+    custom_operand right;
+    /* '=', '!' (!=), '<', '>', 'l' (<=) or 'g' (>=) */
+    char op;
+    /* 1 if the term starts a new alternative after a '|' */
+    int alternative;
+} custom_term;
+
+typedef struct custom_stat {
+    /* 'm', 'b', 't', 'q' or 's' */
+    char kind;
+    char name[61];
+    int term_count;
+    custom_term terms[CUSTOM_TERMS];
+} custom_stat;
+
+/* Every attribute of one key of an ngram. */
+typedef struct key_info {
+    int finger;
+    int hand;
+    int key_row;
+    int key_col;
+    int stretch;
+    int dir;
+} key_info;
+
+/* The types of stats, with the number of keys in their ngrams. */
+static const struct {
+    const char *word;
+    char kind;
+    int size;
+} custom_kinds[] = {
+    {"monogram", 'm', 1},
+    {"bigram", 'b', 2},
+    {"trigram", 't', 3},
+    {"quadgram", 'q', 4},
+    {"skipgram", 's', 2},
+};
+
+static const struct {
+    const char *word;
+    char attribute;
+} custom_attributes[] = {
+    {"finger", 'f'},
+    {"hand", 'h'},
+    {"row", 'r'},
+    {"col", 'c'},
+    {"stretch", 's'},
+    {"dir", 'd'},
+};
+
+static const struct {
+    const char *word;
+    int value;
+} custom_constants[] = {
+    {"left", HAND_LEFT},
+    {"right", HAND_RIGHT},
+    {"switch", DIR_SWITCH},
+    {"same", DIR_SAME},
+    {"in", DIR_IN},
+    {"out", DIR_OUT},
+};
+
+#define COUNT_OF(array) (int)(sizeof(array) / sizeof(array[0]))
+
+/* The definitions read from the custom stats file. */
+static custom_stat *custom_stats = NULL;
+static int custom_count = 0;
+
+/* The stats of one type being classified by initialize_custom_stats. */
+static char classify_kind;
+static int classify_base;
+static int classify_count;
+static custom_stat **classify_stats;
+
+/*
+ * Stops with an error pointing at a line of the custom stats file.
+ * Parameters:
+ *   line: The line number, from 1.
+ *   what: What is wrong with it.
+ */
+static void syntax_error(int line, const char *what)
+{
+    char message[160];
+    snprintf(message, sizeof(message), "Custom stats line %d: %s.", line, what);
+    error(message);
+}
+
+/*
+ * Returns the number of keys in the ngrams of a type of stat.
+ * Parameters:
+ *   kind: The type of stat.
+ */
+static int kind_size(char kind)
+{
+    for (int k = 0; k < COUNT_OF(custom_kinds); k++) {
+        if (custom_kinds[k].kind == kind) {return custom_kinds[k].size;}
+    }
+    return 0;
+}
+
+/* Skips the spaces at a cursor into a line. */
+static char *skip_spaces(char *cursor)
+{
+    while (isspace((unsigned char)*cursor)) {cursor++;}
+    return cursor;
+}
+
+/*
+ * Parses an operand of a comparison, such as 'finger0', 'left' or '2'.
+ * Parameters:
+ *   cursor: The position in the line, moved past the operand.
+ *   size:   The number of keys in the ngrams of the stat.
+ *   line:   The line number for errors.
+ * Returns: The operand.
+ */
+static custom_operand parse_operand(char **cursor, int size, int line)
+{
+    custom_operand operand = {0, 0, 0};
+    char *start = skip_spaces(*cursor);
+    char *end = start;
+    if (*end == '-') {end++;}
+    while (isalnum((unsigned char)*end)) {end++;}
+    if (end == start) {syntax_error(line, "expected a key attribute or a value");}
+    *cursor = end;
+
+    char token[32];
+    if (end - start >= (long)sizeof(token)) {syntax_error(line, "unknown key attribute or value");}
+    memcpy(token, start, end - start);
+    token[end - start] = '\0';
+
+    /* a number */
+    if (isdigit((unsigned char)token[0]) || token[0] == '-') {
+        char *rest;
+        operand.value = (int)strtol(token, &rest, 10);
+        if (*rest != '\0') {syntax_error(line, "malformed number");}
+        return operand;
+    }
+
+    /* an attribute followed by the position of its key */
+    char *digits = token;
+    while (*digits && !isdigit((unsigned char)*digits)) {digits++;}
+    if (*digits != '\0') {
+        char *rest;
+        operand.position = (int)strtol(digits, &rest, 10);
+        if (*rest != '\0') {syntax_error(line, "malformed key attribute");}
+        *digits = '\0';
+        for (int a = 0; a < COUNT_OF(custom_attributes); a++) {
+            if (strcmp(token, custom_attributes[a].word) == 0) {operand.attribute = custom_attributes[a].attribute;}
+        }
+        if (operand.attribute == 0) {syntax_error(line, "unknown key attribute");}
+        if (operand.position >= size) {syntax_error(line, "key position beyond the length of the ngram");}
+        if (operand.attribute == 'd' && operand.position == 0) {syntax_error(line, "dir0 is not defined, the first key has no key before it");}
+        return operand;
+    }
+
+    /* a named value */
+    for (int c = 0; c < COUNT_OF(custom_constants); c++) {
+        if (strcmp(token, custom_constants[c].word) == 0) {
+            operand.value = custom_constants[c].value;
+            return operand;
+        }
+    }
+    syntax_error(line, "unknown key attribute or value");
+    return operand;
+}
+
+/*
+ * Parses the operator of a comparison.
+ * Parameters:
+ *   cursor: The position in the line, moved past the operator.
+ *   line:   The line number for errors.
+ * Returns: The operator as stored in custom_term.
+ */
+static char parse_op(char **cursor, int line)
+{
+    char *c = skip_spaces(*cursor);
+    char op = 0;
+    int length = 2;
+    if (c[0] == '!' && c[1] == '=') {op = '!';}
+    else if (c[0] == '<' && c[1] == '=') {op = 'l';}
+    else if (c[0] == '>' && c[1] == '=') {op = 'g';}
+    else if (c[0] == '=' && c[1] == '=') {op = '=';}
+    else if (c[0] == '=' || c[0] == '<' || c[0] == '>') {
+        op = c[0];
+        length = 1;
+    }
+    if (op == 0) {syntax_error(line, "expected one of = != < > <= >=");}
+    *cursor = c + length;
+    return op;
+}
+
+/*
+ * Parses one definition, '<type> <name>: <condition>'.
+ * Parameters:
+ *   text: The line without its comment and surrounding spaces.
+ *   line: The line number for errors.
+ *   stat: Where to store the definition, zeroed.
+ */
+static void parse_definition(char *text, int line, custom_stat *stat)
+{
+    char *cursor = text;
+    while (*cursor && !isspace((unsigned char)*cursor)) {cursor++;}
+    for (int k = 0; k < COUNT_OF(custom_kinds); k++) {
+        size_t length = strlen(custom_kinds[k].word);
+        if ((size_t)(cursor - text) == length && strncmp(text, custom_kinds[k].word, length) == 0) {
+            stat->kind = custom_kinds[k].kind;
+        }
+    }
+    if (stat->kind == 0) {syntax_error(line, "expected monogram, bigram, trigram, quadgram or skipgram");}
+
+    char *colon = strchr(cursor, ':');
+    if (colon == NULL) {syntax_error(line, "expected ':' after the name");}
+    char *name = skip_spaces(cursor);
+    char *name_end = colon;
+    while (name_end > name && isspace((unsigned char)name_end[-1])) {name_end--;}
+    if (name_end == name) {syntax_error(line, "missing name");}
+    if (name_end - name >= (long)sizeof(stat->name)) {syntax_error(line, "name longer than 60 characters");}
+    memcpy(stat->name, name, name_end - name);
+    stat->name[name_end - name] = '\0';
+
+    int size = kind_size(stat->kind);
+    int alternative = 1;
+    cursor = colon + 1;
+    while (1) {
+        if (stat->term_count == CUSTOM_TERMS) {syntax_error(line, "too many comparisons");}
+        custom_term *term = &stat->terms[stat->term_count++];
+        term->left = parse_operand(&cursor, size, line);
+        term->op = parse_op(&cursor, line);
+        term->right = parse_operand(&cursor, size, line);
+        term->alternative = alternative;
+        alternative = 0;
+
+        cursor = skip_spaces(cursor);
+        if (*cursor == '\0') {break;}
+        else if (*cursor == '|') {alternative = 1;}
+        else if (*cursor != '&') {syntax_error(line, "expected '&', '|' or the end of the line");}
+        cursor++;
+    }
+}
+
+/*
+ * Reads the custom stat definitions of './data/stats/<custom_stats_name>.stat'
+ * selected with --stats. Nothing is read when no file is selected. Every line
+ * defines one stat as '<type> <name>: <condition>', see data/README.md.
+ */
+void read_custom_stats()
+{
+    if (custom_stats_name == NULL) {return;}
+    char *path = (char *)malloc(strlen("./data/stats/.stat") + strlen(custom_stats_name) + 1);
+    if (path == NULL) {error("failed to malloc custom stats path");}
+    sprintf(path, "./data/stats/%s.stat", custom_stats_name);
+    FILE *file = fopen(path, "r");
+    free(path);
+    if (file == NULL) {error("Custom stats file not found.");}
+
+    char text[CUSTOM_LINE];
+    int capacity = 0;
+    for (int line = 1; fgets(text, sizeof(text), file) != NULL; line++) {
+        if (strchr(text, '\n') == NULL && !feof(file)) {syntax_error(line, "line too long");}
+        /* drop the comment and the surrounding spaces */
+        char *comment = strchr(text, '#');
+        if (comment != NULL) {*comment = '\0';}
+        char *start = skip_spaces(text);
+        char *end = start + strlen(start);
+        while (end > start && isspace((unsigned char)end[-1])) {end--;}
+        *end = '\0';
+        if (*start == '\0') {continue;}
+
+        if (custom_count == capacity) {
+            capacity = capacity == 0 ? 16 : capacity * 2;
+            custom_stats = (custom_stat *)realloc(custom_stats, sizeof(custom_stat) * capacity);
+            if (custom_stats == NULL) {error("failed to realloc custom stats");}
+        }
+        custom_stat *stat = &custom_stats[custom_count];
+        memset(stat, 0, sizeof(custom_stat));
+        parse_definition(start, line, stat);
+        for (int s = 0; s < custom_count; s++) {
+            if (strcmp(custom_stats[s].name, stat->name) == 0) {syntax_error(line, "a stat of this name is already defined");}
+        }
+        custom_count++;
+    }
+    fclose(file);
+}
+
+/*
+ * Mixes an integer into an FNV-1a hash.
+ * Parameters:
+ *   hash:  The hash so far.
+ *   value: The value to mix in.
+ * Returns: The new hash.
+ */
+static uint64_t hash_value(uint64_t hash, int value)
+{
+    for (int i = 0; i < 4; i++) {
+        hash = (hash ^ (((unsigned)value >> (8 * i)) & 0xFF)) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/*
+ * Hashes the custom stat definitions for the key of the stats cache, so the
+ * cached tables are rebuilt whenever the definitions change.
+ */
+uint64_t custom_stats_hash()
+{
+    uint64_t hash = 14695981039346656037ULL;
+    hash = hash_value(hash, custom_count);
+    for (int s = 0; s < custom_count; s++) {
+        custom_stat *stat = &custom_stats[s];
+        hash = hash_value(hash, stat->kind);
+        for (const char *c = stat->name; *c; c++) {hash = hash_value(hash, *c);}
+        hash = hash_value(hash, stat->term_count);
+        for (int t = 0; t < stat->term_count; t++) {
+            custom_term *term = &stat->terms[t];
+            custom_operand *operands[2] = {&term->left, &term->right};
+            for (int o = 0; o < 2; o++) {
+                hash = hash_value(hash, operands[o]->attribute);
+                hash = hash_value(hash, operands[o]->position);
+                hash = hash_value(hash, operands[o]->value);
+            }
+            hash = hash_value(hash, term->op);
+            hash = hash_value(hash, term->alternative);
+        }
+    }
+    return hash;
+}
+
+/*
+ * Finds whether a stat of any type already has a name, as the weights file
+ * matches stats by name alone.
+ * Parameters:
+ *   name: The name to look for.
+ */
+static int is_defined(const char *name)
+{
+    for (int i = 0; i < MONO_LENGTH; i++) {if (strcmp(stats_mono[i].name, name) == 0) {return 1;}}
+    for (int i = 0; i < BI_LENGTH; i++) {if (strcmp(stats_bi[i].name, name) == 0) {return 1;}}
+    for (int i = 0; i < TRI_LENGTH; i++) {if (strcmp(stats_tri[i].name, name) == 0) {return 1;}}
+    for (int i = 0; i < QUAD_LENGTH; i++) {if (strcmp(stats_quad[i].name, name) == 0) {return 1;}}
+    for (int i = 0; i < SKIP_LENGTH; i++) {if (strcmp(stats_skip[i].name, name) == 0) {return 1;}}
+    return 0;
+}
+
+/*
+ * Grows the stat array of a type by a number of stats and sets their names
+ * and default values as the initialize functions do.
+ * Parameters:
+ *   kind:  The type of stat.
+ *   count: The number of stats to append.
+ *   stats: Their definitions.
+ * Returns: The index of the first appended stat.
+ */
+static int append_stats(char kind, int count, custom_stat **stats)
+{
+    int base;
+    switch (kind) {
+        case 'm':
+            base = MONO_LENGTH;
+            MONO_LENGTH += count;
+            stats_mono = (mono_stat *)realloc(stats_mono, sizeof(mono_stat) * MONO_LENGTH);
+            if (stats_mono == NULL) {error("failed to realloc monogram stats");}
+            for (int s = 0; s < count; s++) {
+                strcpy(stats_mono[base + s].name, stats[s]->name);
+                stats_mono[base + s].weight = -INFINITY;
+                stats_mono[base + s].skip = 0;
+            }
+            break;
+        case 'b':
+            base = BI_LENGTH;
+            BI_LENGTH += count;
+            stats_bi = (bi_stat *)realloc(stats_bi, sizeof(bi_stat) * BI_LENGTH);
+            if (stats_bi == NULL) {error("failed to realloc bigram stats");}
+            for (int s = 0; s < count; s++) {
+                strcpy(stats_bi[base + s].name, stats[s]->name);
+                stats_bi[base + s].weight = -INFINITY;
+                stats_bi[base + s].skip = 0;
+            }
+            break;
+        case 't':
+            base = TRI_LENGTH;
+            TRI_LENGTH += count;
+            stats_tri = (tri_stat *)realloc(stats_tri, sizeof(tri_stat) * TRI_LENGTH);
+            if (stats_tri == NULL) {error("failed to realloc trigram stats");}
+            for (int s = 0; s < count; s++) {
+                strcpy(stats_tri[base + s].name, stats[s]->name);
+                stats_tri[base + s].weight = -INFINITY;
+                stats_tri[base + s].skip = 0;
+            }
+            break;
+        case 'q':
+            base = QUAD_LENGTH;
+            QUAD_LENGTH += count;
+            stats_quad = (quad_stat *)realloc(stats_quad, sizeof(quad_stat) * QUAD_LENGTH);
+            if (stats_quad == NULL) {error("failed to realloc quadgram stats");}
+            for (int s = 0; s < count; s++) {
+                strcpy(stats_quad[base + s].name, stats[s]->name);
+                stats_quad[base + s].weight = -INFINITY;
+                stats_quad[base + s].skip = 0;
+            }
+            break;
+        default:
+            base = SKIP_LENGTH;
+            SKIP_LENGTH += count;
+            stats_skip = (skip_stat *)realloc(stats_skip, sizeof(skip_stat) * SKIP_LENGTH);
+            if (stats_skip == NULL) {error("failed to realloc skipgram stats");}
+            for (int s = 0; s < count; s++) {
+                strcpy(stats_skip[base + s].name, stats[s]->name);
+                for (int i = 0; i < 10; i++) {stats_skip[base + s].weight[i] = -INFINITY;}
+                stats_skip[base + s].skip = 0;
+            }
+            break;
+    }
+    return base;
+}
+
+/*
+ * Returns where the ngram array of one of the custom stats being classified
+ * is stored.
+ * Parameters:
+ *   stat: The index of the stat among them.
+ */
+static int **custom_ngrams(int stat)
+{
+    int i = classify_base + stat;
+    switch (classify_kind) {
+        case 'm': return &stats_mono[i].ngrams;
+        case 'b': return &stats_bi[i].ngrams;
+        case 't': return &stats_tri[i].ngrams;
+        case 'q': return &stats_quad[i].ngrams;
+        default: return &stats_skip[i].ngrams;
+    }
+}
+
+/*
+ * Stores the length of one of the custom stats being classified.
+ * Parameters:
+ *   stat:   The index of the stat among them.
+ *   length: The number of ngrams in it.
+ */
+static void set_custom_length(int stat, int length)
+{
+    int i = classify_base + stat;
+    switch (classify_kind) {
+        case 'm': stats_mono[i].length = length; break;
+        case 'b': stats_bi[i].length = length; break;
+        case 't': stats_tri[i].length = length; break;
+        case 'q': stats_quad[i].length = length; break;
+        default: stats_skip[i].length = length; break;
+    }
+}
+
+/*
+ * Returns the value of an operand for one ngram.
+ * Parameters:
+ *   operand: The operand.
+ *   keys:    The attributes of every key of the ngram.
+ */
+static int operand_value(const custom_operand *operand, const key_info *keys)
+{
+    const key_info *key = &keys[operand->position];
+    switch (operand->attribute) {
+        case 'f': return key->finger;
+        case 'h': return key->hand;
+        case 'r': return key->key_row;
+        case 'c': return key->key_col;
+        case 's': return key->stretch;
+        case 'd': return key->dir;
+        default: return operand->value;
+    }
+}
+
+/*
+ * Checks whether an ngram satisfies the condition of a custom stat.
+ * Parameters:
+ *   stat: The custom stat.
+ *   keys: The attributes of every key of the ngram.
+ */
+static int is_custom_member(const custom_stat *stat, const key_info *keys)
+{
+    int matches = 1;
+    for (int t = 0; t < stat->term_count; t++) {
+        const custom_term *term = &stat->terms[t];
+        /* the alternatives before succeed as soon as one matched */
+        if (term->alternative && t > 0) {
+            if (matches) {return 1;}
+            matches = 1;
+        }
+        if (!matches) {continue;}
+        int left = operand_value(&term->left, keys);
+        int right = operand_value(&term->right, keys);
+        switch (term->op) {
+            case '=': matches = left == right; break;
+            case '!': matches = left != right; break;
+            case '<': matches = left < right; break;
+            case '>': matches = left > right; break;
+            case 'l': matches = left <= right; break;
+            default: matches = left >= right; break;
+        }
+    }
+    return matches;
+}
+
+/*
+ * Runs one ngram through every custom stat being classified, decoding it once.
+ * Parameters:
+ *   index:   The flat index of the ngram.
+ *   members: Where to store whether it falls under each stat.
+ */
+static void classify_custom(int index, char *members)
+{
+    int rows[4], cols[4];
+    int size = kind_size(classify_kind);
+    /* convert a 1D index into the row and column of each key */
+    switch (classify_kind) {
+        case 'm': unflat_mono(index, &rows[0], &cols[0]); break; /* util.c */
+        case 't': unflat_tri(index, &rows[0], &cols[0], &rows[1], &cols[1], &rows[2], &cols[2]); break; /* util.c */
+        case 'q':
+            unflat_quad(index, &rows[0], &cols[0], &rows[1], &cols[1],
+                &rows[2], &cols[2], &rows[3], &cols[3]); /* util.c */
+            break;
+        default: unflat_bi(index, &rows[0], &cols[0], &rows[1], &cols[1]); break; /* util.c */
+    }
+
+    key_info keys[4];
+    for (int k = 0; k < size; k++) {
+        keys[k].finger = finger(rows[k], cols[k]); /* stats_util.c */
+        keys[k].hand = hand(rows[k], cols[k]) == 'l' ? HAND_LEFT : HAND_RIGHT; /* stats_util.c */
+        keys[k].key_row = rows[k];
+        keys[k].key_col = cols[k];
+        keys[k].stretch = is_stretch(rows[k], cols[k]) != 0; /* stats_util.c */
+        keys[k].dir = DIR_SWITCH;
+        if (k > 0 && keys[k].hand == keys[k - 1].hand) {
+            /* fingers count up towards the right, so inward is up on the left hand */
+            int step = keys[k].finger - keys[k - 1].finger;
+            if (step == 0) {keys[k].dir = DIR_SAME;}
+            else if ((step > 0) == (keys[k].hand == HAND_LEFT)) {keys[k].dir = DIR_IN;}
+            else {keys[k].dir = DIR_OUT;}
+        }
+    }
+
+    for (int s = 0; s < classify_count; s++) {
+        members[s] = is_custom_member(classify_stats[s], keys);
+    }
+}
+
+/*
+ * Appends the custom stats to the built-in stat arrays of their type and
+ * classifies every ngram for them in the same pass the built-in stats use.
+ */
+void initialize_custom_stats()
+{
+    if (custom_count == 0) {return;}
+    classify_stats = (custom_stat **)malloc(sizeof(custom_stat *) * custom_count);
+    int *lengths = (int *)malloc(sizeof(int) * custom_count);
+    if (classify_stats == NULL || lengths == NULL) {error("failed to malloc custom stats");}
+    for (int s = 0; s < custom_count; s++) {
+        if (is_defined(custom_stats[s].name)) {error("Custom stat has the name of a built-in stat.");}
+    }
+
+    for (int k = 0; k < COUNT_OF(custom_kinds); k++) {
+        classify_kind = custom_kinds[k].kind;
+        classify_count = 0;
+        for (int s = 0; s < custom_count; s++) {
+            if (custom_stats[s].kind == classify_kind) {classify_stats[classify_count++] = &custom_stats[s];}
+        }
+        if (classify_count == 0) {continue;}
+
+        classify_base = append_stats(classify_kind, classify_count, classify_stats);
+        classify_ngrams(kind_size(classify_kind), classify_count, classify_custom,
+            custom_ngrams, lengths); /* stats_util.c */
+        for (int s = 0; s < classify_count; s++) {set_custom_length(s, lengths[s]);}
+    }
+    free(lengths);
+    free(classify_stats);
+    classify_stats = NULL;
+}
+
+/*
+ * Sets the weight of every custom stat to 0, so a weights file that does not
+ * mention a custom stat leaves it out of the analysis. Called before the
+ * weights are read.
+ */
+void default_custom_weights()
+{
+    for (int s = 0; s < custom_count; s++) {
+        const char *name = custom_stats[s].name;
+        switch (custom_stats[s].kind) {
+            case 'm':
+                for (int i = 0; i < MONO_LENGTH; i++) {if (strcmp(stats_mono[i].name, name) == 0) {stats_mono[i].weight = 0;}}
+                break;
+            case 'b':
+                for (int i = 0; i < BI_LENGTH; i++) {if (strcmp(stats_bi[i].name, name) == 0) {stats_bi[i].weight = 0;}}
+                break;
+            case 't':
+                for (int i = 0; i < TRI_LENGTH; i++) {if (strcmp(stats_tri[i].name, name) == 0) {stats_tri[i].weight = 0;}}
+                break;
+            case 'q':
+                for (int i = 0; i < QUAD_LENGTH; i++) {if (strcmp(stats_quad[i].name, name) == 0) {stats_quad[i].weight = 0;}}
+                break;
+            default:
+                for (int i = 0; i < SKIP_LENGTH; i++) {
+                    if (strcmp(stats_skip[i].name, name) == 0) {
+                        for (int k = 0; k < 10; k++) {stats_skip[i].weight[k] = 0;}
+                    }
+                }
+                break;
+        }
+    }
+}
+
+/* Returns the number of custom stats defined. */
+int custom_stat_count()
+{
+    return custom_count;
+}
+
+/* Frees the custom stat definitions. */
+void free_custom_stats()
+{
+    free(custom_stats);
+    custom_stats = NULL;
+    custom_count = 0;
+}
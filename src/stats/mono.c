@@ -9,15 +9,17 @@
  *     1. Incease MONO_LENGTH by as many stats as you are adding.
  *     2. Define its name, keep it a reasonable length.
  *     3. Set its weight to -INFINITY, and skip to 0 (to be changed later).
- *     4. Set its length to 0, then loop through the DIM1 (36^1) sequences.
+ *     4. Set its length to 0, then loop through the DIM1 sequences of the grid.
  *       4a. Use unflat_mono() to convert the 1D index to a 2D coordinate.
  *       4b. Check if the ngram falls under the stat.
  *       4c. If it does, add it to the ngrams array and increment length.
  *       4d. Otherwise set the ngram array element to -1.
  *     5. Iterate the index.
  *     6. Add the statistic to the weights files in data/weights/.
+ *     7. Increase STATS_VERSION in stats_cache.h so cached stats are rebuilt.
  */
 
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
@@ -35,695 +37,36 @@
  */
 void initialize_mono_stats()
 {
-    MONO_LENGTH = 53;
+    /* one heatmap per key, then the usage stats */
+    MONO_LENGTH = KEY_COUNT + 17;
     stats_mono = (mono_stat *)malloc(sizeof(mono_stat) * MONO_LENGTH);
+    for (int i = 0; i < MONO_LENGTH; i++) {stats_mono[i].ngrams = full_ngrams(DIM1);} /* stats_util.c */
     int row0, col0;
     int index = 0;
 
-    strcpy(stats_mono[index].name, "Heatmap 0 00");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        /* convert a 1D index into a 2D matrix coordinate */
-        unflat_mono(i, &row0, &col0); /* util.c */
-        if (row0 == 0 && col0 == 0)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 0 01");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 0 && col0 == 1)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 0 02");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 0 && col0 == 2)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 0 03");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 0 && col0 == 3)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 0 04");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 0 && col0 == 4)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 0 05");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 0 && col0 == 5)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 0 06");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 0 && col0 == 6)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 0 07");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 0 && col0 == 7)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 0 08");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 0 && col0 == 8)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 0 09");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 0 && col0 == 9)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 0 10");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 0 && col0 == 10)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 0 11");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 0 && col0 == 11)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 1 00");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 1 && col0 == 0)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 1 01");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 1 && col0 == 1)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 1 02");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 1 && col0 == 2)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 1 03");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 1 && col0 == 3)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 1 04");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 1 && col0 == 4)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 1 05");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 1 && col0 == 5)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 1 06");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 1 && col0 == 6)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 1 07");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 1 && col0 == 7)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 1 08");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 1 && col0 == 8)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 1 09");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 1 && col0 == 9)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 1 10");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 1 && col0 == 10)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 1 11");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 1 && col0 == 11)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 2 00");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 2 && col0 == 0)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 2 01");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 2 && col0 == 1)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 2 02");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 2 && col0 == 2)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 2 03");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 2 && col0 == 3)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 2 04");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 2 && col0 == 4)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 2 05");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 2 && col0 == 5)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 2 06");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 2 && col0 == 6)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 2 07");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 2 && col0 == 7)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 2 08");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 2 && col0 == 8)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 2 09");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 2 && col0 == 9)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 2 10");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
-    for (int i = 0; i < DIM1; i++)
-    {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 2 && col0 == 10)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_mono[index].name, "Heatmap 2 11");
-    stats_mono[index].weight = -INFINITY;
-    stats_mono[index].length = 0;
-    stats_mono[index].skip = 0;
+    /* Initialize a heatmap stat for every key of the keyboard. */
     for (int i = 0; i < DIM1; i++)
     {
-        unflat_mono(i, &row0, &col0);
-        if (row0 == 2 && col0 == 11)
-        {
-            stats_mono[index].ngrams[i] = i;
-            stats_mono[index].length++;
-        }
-        else
-        {
-            stats_mono[index].ngrams[i] = -1;
+        unflat_mono(i, &row0, &col0); /* util.c */
+        if (finger(row0, col0) == -1) {continue;}
+        sprintf(stats_mono[index].name, "Heatmap %d %02d", row0, col0);
+        stats_mono[index].weight = -INFINITY;
+        stats_mono[index].length = 0;
+        stats_mono[index].skip = 0;
+        for (int j = 0; j < DIM1; j++)
+        {
+            if (j == i)
+            {
+                stats_mono[index].ngrams[j] = j;
+                stats_mono[index].length++;
+            }
+            else
+            {
+                stats_mono[index].ngrams[j] = -1;
+            }
         }
+        index++;
     }
-    index++;
 
     /* Initialize a new stats for column/finger usage. */
     strcpy(stats_mono[index].name, "Left Outer Usage");
@@ -733,7 +76,7 @@ void initialize_mono_stats()
     for (int i = 0; i < DIM1; i++)
     {
         unflat_mono(i, &row0, &col0);
-        if (col0 == 0)
+        if (finger(row0, col0) == 0 && is_stretch(row0, col0))
         {
             stats_mono[index].ngrams[i] = i;
             stats_mono[index].length++;
@@ -828,7 +171,7 @@ void initialize_mono_stats()
     for (int i = 0; i < DIM1; i++)
     {
         unflat_mono(i, &row0, &col0);
-        if (col0 == 5)
+        if (finger(row0, col0) == 3 && is_stretch(row0, col0))
         {
             stats_mono[index].ngrams[i] = i;
             stats_mono[index].length++;
@@ -847,7 +190,7 @@ void initialize_mono_stats()
     for (int i = 0; i < DIM1; i++)
     {
         unflat_mono(i, &row0, &col0);
-        if (col0 == 6)
+        if (finger(row0, col0) == 4 && is_stretch(row0, col0))
         {
             stats_mono[index].ngrams[i] = i;
             stats_mono[index].length++;
@@ -942,7 +285,7 @@ void initialize_mono_stats()
     for (int i = 0; i < DIM1; i++)
     {
         unflat_mono(i, &row0, &col0);
-        if (col0 == 11)
+        if (finger(row0, col0) == 7 && is_stretch(row0, col0))
         {
             stats_mono[index].ngrams[i] = i;
             stats_mono[index].length++;
@@ -1001,7 +344,7 @@ void initialize_mono_stats()
     for (int i = 0; i < DIM1; i++)
     {
         unflat_mono(i, &row0, &col0);
-        if (row0 == 0)
+        if (row0 == HOME_ROW - 1)
         {
             stats_mono[index].ngrams[i] = i;
             stats_mono[index].length++;
@@ -1020,7 +363,7 @@ void initialize_mono_stats()
     for (int i = 0; i < DIM1; i++)
     {
         unflat_mono(i, &row0, &col0);
-        if (row0 == 1)
+        if (row0 == HOME_ROW)
         {
             stats_mono[index].ngrams[i] = i;
             stats_mono[index].length++;
@@ -1039,7 +382,7 @@ void initialize_mono_stats()
     for (int i = 0; i < DIM1; i++)
     {
         unflat_mono(i, &row0, &col0);
-        if (row0 == 2)
+        if (row0 == HOME_ROW + 1)
         {
             stats_mono[index].ngrams[i] = i;
             stats_mono[index].length++;
@@ -1055,40 +398,27 @@ void initialize_mono_stats()
 }
 
 /*
- * Trims the ngrams in the array to move unused entries to the end.
- * This process ensures memory efficiency by eliminating gaps in the array.
+ * Trims the ngram array of every stat down to the ngrams in it, dropping the
+ * -1 entries and any ngram touching a gap of the keyboard.
  */
 void trim_mono_stats()
 {
     for (int i = 0; i < MONO_LENGTH; i++)
     {
-        if (stats_mono[i].length != 0)
-        {
-            int left = 0;
-            int right = DIM1 - 1;
-
-            /* Use two pointers to partition the array */
-            while (left < right) {
-                /* Find the next -1 from the left */
-                while (left < right && stats_mono[i].ngrams[left] != -1) {
-                    left++;
-                }
-
-                /* Find the next non -1 from the right */
-                while (left < right && stats_mono[i].ngrams[right] == -1) {
-                    right--;
-                }
+        pack_ngrams(&stats_mono[i].ngrams, &stats_mono[i].length, DIM1, 1); /* stats_util.c */
+    }
+}
 
-                /* Swap the elements to move -1 to the back and non -1 to the front */
-                if (left < right) {
-                    int temp = stats_mono[i].ngrams[left];
-                    stats_mono[i].ngrams[left] = stats_mono[i].ngrams[right];
-                    stats_mono[i].ngrams[right] = temp;
-                    left++;
-                    right--;
-                }
-            }
-        }
+/*
+ * Sets the weight of every heatmap stat to 0. The heatmaps follow the keys of
+ * the keyboard, so a weights file written for another keyboard need not name
+ * them all. Called before the weights are read.
+ */
+void default_heatmap_weights()
+{
+    for (int i = 0; i < MONO_LENGTH; i++)
+    {
+        if (strncmp(stats_mono[i].name, "Heatmap ", 8) == 0) {stats_mono[i].weight = 0;}
     }
 }
 
@@ -1109,5 +439,6 @@ void clean_mono_stats()
 /* Frees the memory allocated for the monogram statistics array. */
 void free_mono_stats()
 {
+    for (int i = 0; i < MONO_LENGTH; i++) {free(stats_mono[i].ngrams);}
     free(stats_mono);
 }
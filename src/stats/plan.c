@@ -0,0 +1,339 @@
+/*
+ * stats/plan.c - Partition planning for the monogram to quadgram stats.
+ *
+ * Many stats are unions of others: Same Finger Bigram is the eight per finger
+ * bigram stats, Roll is Roll In and Roll Out. Scoring such a parent from the
+ * ngrams gathers every one of them a second time once its children are
+ * computed as well. The partitions are found from the ngram arrays themselves,
+ * so they hold for any stat definition, and the analysis then sums the
+ * parent from the scores of its children.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "plan.h"
+#include "util.h"
+#include "global.h"
+#include "structs.h"
+
+/* One stat while a plan is made. */
+typedef struct plan_stat {
+    int index;
+    int length;
+    int *ngrams;
+} plan_stat;
+
+/*
+ * Returns the plan of one ngram type.
+ * Parameters:
+ *   kind: 'm', 'b', 't' or 'q'.
+ */
+static stat_plan *plan_of(char kind)
+{
+    switch (kind) {
+        case 'm': return &plan_mono;
+        case 'b': return &plan_bi;
+        case 't': return &plan_tri;
+        default: return &plan_quad;
+    }
+}
+
+/*
+ * Collects the ngram arrays and skip flags of one ngram type.
+ * Parameters:
+ *   kind:  'm', 'b', 't' or 'q'.
+ *   count: Where to store the number of stats.
+ *   skip:  Where to store the allocated skip flags.
+ * Returns: The allocated stats, in their array order.
+ */
+static plan_stat *collect_stats(char kind, int *count, char **skip)
+{
+    switch (kind) {
+        case 'm': *count = MONO_LENGTH; break;
+        case 'b': *count = BI_LENGTH; break;
+        case 't': *count = TRI_LENGTH; break;
+        default: *count = QUAD_LENGTH; break;
+    }
+    plan_stat *stats = (plan_stat *)malloc(sizeof(plan_stat) * (*count + 1));
+    *skip = (char *)malloc(*count + 1);
+    if (stats == NULL || *skip == NULL) {error("failed to malloc stat plan");}
+    for (int i = 0; i < *count; i++) {
+        stats[i].index = i;
+        switch (kind) {
+            case 'm': stats[i].length = stats_mono[i].length; stats[i].ngrams = stats_mono[i].ngrams; (*skip)[i] = stats_mono[i].skip; break;
+            case 'b': stats[i].length = stats_bi[i].length; stats[i].ngrams = stats_bi[i].ngrams; (*skip)[i] = stats_bi[i].skip; break;
+            case 't': stats[i].length = stats_tri[i].length; stats[i].ngrams = stats_tri[i].ngrams; (*skip)[i] = stats_tri[i].skip; break;
+            default: stats[i].length = stats_quad[i].length; stats[i].ngrams = stats_quad[i].ngrams; (*skip)[i] = stats_quad[i].skip; break;
+        }
+    }
+    return stats;
+}
+
+/*
+ * Orders stats by descending length, for qsort.
+ */
+static int compare_longest(const void *a, const void *b)
+{
+    const plan_stat *x = (const plan_stat *)a, *y = (const plan_stat *)b;
+    if (x->length != y->length) {return x->length < y->length ? 1 : -1;}
+    return x->index - y->index;
+}
+
+/*
+ * Returns the position of an ngram within a stat, found by bisecting its
+ * ngrams, which are listed ascending. Returns -1 if the stat lacks it.
+ */
+static int find_position(const plan_stat *s, int ngram)
+{
+    int low = 0;
+    int high = s->length - 1;
+    while (low <= high) {
+        int mid = low + (high - low) / 2;
+        if (s->ngrams[mid] < ngram) {low = mid + 1;}
+        else if (s->ngrams[mid] > ngram) {high = mid - 1;}
+        else {return mid;}
+    }
+    return -1;
+}
+
+/* Upper bound on the steps of one partition search. */
+#define SEARCH_BUDGET 4096
+
+/* The state of the search for a partition of one parent. */
+typedef struct partition_search {
+    /* the stats contained in the parent, in the order they are tried */
+    const plan_stat *candidates;
+    /* the positions in the parent of the ngrams of candidate c are
+       slots[slot_start[c]] up to slots[slot_start[c + 1]] */
+    int *slot_start;
+    int *slots;
+    int length;
+    /* 1 for every position of the parent covered by a chosen child */
+    char *covered;
+    /* the candidates containing position p are owners[owner_start[p]]
+       up to owners[owner_start[p + 1]] */
+    int *owner_start;
+    int *owners;
+    int *children;
+    int chosen;
+    int budget;
+} partition_search;
+
+/*
+ * Covers the first uncovered position of the parent with each candidate
+ * containing it in turn, then the rest of the parent, backtracking when no
+ * disjoint candidate is left.
+ * Parameters:
+ *   search: The state of the search.
+ *   from:   The positions before it are covered.
+ * Returns: 1 if the parent is covered exactly, 0 otherwise.
+ */
+static int cover(partition_search *search, int from)
+{
+    while (from < search->length && search->covered[from]) {from++;}
+    if (from == search->length) {return 1;}
+    if (--search->budget < 0) {return 0;}
+
+    for (int o = search->owner_start[from]; o < search->owner_start[from + 1]; o++) {
+        int c = search->owners[o];
+        const int *first = search->slots + search->slot_start[c];
+        const int *last = search->slots + search->slot_start[c + 1];
+        int disjoint = 1;
+        for (const int *slot = first; slot < last && disjoint; slot++) {disjoint = !search->covered[*slot];}
+        if (!disjoint) {continue;}
+
+        for (const int *slot = first; slot < last; slot++) {search->covered[*slot] = 1;}
+        search->children[search->chosen++] = search->candidates[c].index;
+        if (cover(search, from + 1)) {return 1;}
+        search->chosen--;
+        for (const int *slot = first; slot < last; slot++) {search->covered[*slot] = 0;}
+    }
+    return 0;
+}
+
+/*
+ * Looks for disjoint stats covering a parent exactly.
+ * Parameters:
+ *   parent:     The stat to partition.
+ *   candidates: The stats contained in the parent, in the order to try them.
+ *   count:      The number of candidates.
+ *   children:   Where to store the indices of the chosen stats.
+ * Returns: The number of children, 0 if no partition was found.
+ */
+static int find_partition(const plan_stat *parent, const plan_stat *candidates, int count,
+    int *children)
+{
+    partition_search search;
+    search.candidates = candidates;
+    search.length = parent->length;
+    search.children = children;
+    search.chosen = 0;
+    search.budget = SEARCH_BUDGET;
+    search.covered = (char *)calloc(parent->length, 1);
+    search.owner_start = (int *)calloc(parent->length + 1, sizeof(int));
+    search.slot_start = (int *)malloc(sizeof(int) * (count + 1));
+    size_t owned = 0;
+    for (int c = 0; c < count; c++) {owned += candidates[c].length;}
+    search.owners = (int *)malloc(sizeof(int) * (owned + 1));
+    search.slots = (int *)malloc(sizeof(int) * (owned + 1));
+    if (search.covered == NULL || search.owner_start == NULL || search.slot_start == NULL
+        || search.owners == NULL || search.slots == NULL) {error("failed to malloc stat plan");}
+
+    /* both lists ascend, so one merge finds the positions of a candidate */
+    search.slot_start[0] = 0;
+    for (int c = 0; c < count; c++) {
+        int *slot = search.slots + search.slot_start[c];
+        int j = 0;
+        for (int k = 0; k < candidates[c].length; k++) {
+            while (parent->ngrams[j] != candidates[c].ngrams[k]) {j++;}
+            slot[k] = j;
+        }
+        search.slot_start[c + 1] = search.slot_start[c] + candidates[c].length;
+    }
+
+    /* index the candidates by the positions they contain, keeping their order */
+    for (size_t o = 0; o < owned; o++) {search.owner_start[search.slots[o] + 1]++;}
+    for (int j = 0; j < parent->length; j++) {search.owner_start[j + 1] += search.owner_start[j];}
+    int *next = (int *)malloc(sizeof(int) * (parent->length + 1));
+    if (next == NULL) {error("failed to malloc stat plan");}
+    memcpy(next, search.owner_start, sizeof(int) * parent->length);
+    for (int c = 0; c < count; c++) {
+        for (int o = search.slot_start[c]; o < search.slot_start[c + 1]; o++) {search.owners[next[search.slots[o]]++] = c;}
+    }
+    free(next);
+
+    int found = cover(&search, 0);
+    free(search.slots);
+    free(search.slot_start);
+    free(search.owners);
+    free(search.owner_start);
+    free(search.covered);
+    return found ? search.chosen : 0;
+}
+
+/*
+ * Plans one ngram type. Parents are visited from the longest, so a child that
+ * is only computed for its parent can still be summed from its own children.
+ * Parameters:
+ *   kind: 'm', 'b', 't' or 'q'.
+ */
+static void plan_kind(char kind)
+{
+    int count;
+    char *skip;
+    plan_stat *stats = collect_stats(kind, &count, &skip);
+    plan_stat *order = (plan_stat *)malloc(sizeof(plan_stat) * (count + 1));
+    plan_stat *candidates = (plan_stat *)malloc(sizeof(plan_stat) * (count + 1));
+    int *children = (int *)malloc(sizeof(int) * (count + 1));
+    /* the children of every stat, 0 if it is gathered */
+    int *child_count = (int *)calloc(count + 1, sizeof(int));
+    int **child_lists = (int **)calloc(count + 1, sizeof(int *));
+    stat_plan *plan = plan_of(kind);
+    plan->gathered = (char *)malloc(count + 1);
+    if (order == NULL || candidates == NULL || children == NULL
+        || child_count == NULL || child_lists == NULL || plan->gathered == NULL) {error("failed to malloc stat plan");}
+
+    /* computed marks every stat the analysis needs, whichever way */
+    char *computed = plan->gathered;
+    for (int i = 0; i < count; i++) {computed[i] = !skip[i] && stats[i].length > 0;}
+    memcpy(order, stats, sizeof(plan_stat) * count);
+    qsort(order, count, sizeof(plan_stat), compare_longest);
+
+    int derived = 0;
+    for (int p = 0; p < count; p++) {
+        plan_stat *parent = &order[p];
+        if (!computed[parent->index] || parent->length < 2) {continue;}
+
+        /* every shorter stat within the parent can be part of a partition,
+           the ones computed anyway are tried first, longest first */
+        int candidate_count = 0;
+        for (int pass = 0; pass < 2; pass++) {
+            for (int c = p + 1; c < count; c++) {
+                plan_stat *s = &order[c];
+                if (s->length == 0 || s->length >= parent->length || computed[s->index] != (pass == 0)) {continue;}
+                int inside = 1;
+                for (int j = 0; j < s->length && inside; j++) {inside = find_position(parent, s->ngrams[j]) != -1;}
+                if (inside) {candidates[candidate_count++] = *s;}
+            }
+        }
+
+        int chosen = find_partition(parent, candidates, candidate_count, children);
+        int shared = 0;
+        for (int c = 0; c < chosen; c++) {shared |= computed[children[c]];}
+        /* summing only pays when some of the children are computed anyway */
+        if (chosen < 2 || !shared) {continue;}
+
+        child_lists[parent->index] = (int *)malloc(sizeof(int) * chosen);
+        if (child_lists[parent->index] == NULL) {error("failed to malloc stat plan");}
+        memcpy(child_lists[parent->index], children, sizeof(int) * chosen);
+        child_count[parent->index] = chosen;
+        for (int c = 0; c < chosen; c++) {computed[children[c]] = 1;}
+        derived++;
+    }
+
+    /* derived stats are summed shortest first, so children come first */
+    plan->derived = (int *)malloc(sizeof(int) * (derived + 1));
+    plan->child_start = (int *)malloc(sizeof(int) * (derived + 1));
+    int total_children = 0;
+    for (int i = 0; i < count; i++) {total_children += child_count[i];}
+    plan->children = (int *)malloc(sizeof(int) * (total_children + 1));
+    if (plan->derived == NULL || plan->child_start == NULL || plan->children == NULL) {error("failed to malloc stat plan");}
+    plan->derived_count = 0;
+    plan->child_start[0] = 0;
+    for (int p = count - 1; p >= 0; p--) {
+        int i = order[p].index;
+        if (child_count[i] == 0) {continue;}
+        int d = plan->derived_count++;
+        memcpy(plan->children + plan->child_start[d], child_lists[i], sizeof(int) * child_count[i]);
+        plan->child_start[d + 1] = plan->child_start[d] + child_count[i];
+        plan->derived[d] = i;
+        /* a derived stat is no longer gathered */
+        plan->gathered[i] = 0;
+        free(child_lists[i]);
+    }
+
+    free(child_lists);
+    free(child_count);
+    free(children);
+    free(candidates);
+    free(order);
+    free(skip);
+    free(stats);
+}
+
+/*
+ * Plans how the analysis computes the monogram to quadgram stats once the
+ * weights are read and the skip flags final.
+ */
+void plan_partitions()
+{
+    free_plans();
+    plan_kind('m');
+    plan_kind('b');
+    plan_kind('t');
+    plan_kind('q');
+}
+
+/*
+ * Returns the number of stats of every type summed from their partitions
+ * rather than gathered.
+ */
+int derived_count()
+{
+    return plan_mono.derived_count + plan_bi.derived_count + plan_tri.derived_count + plan_quad.derived_count;
+}
+
+/* Frees the plans made by plan_partitions. */
+void free_plans()
+{
+    const char kinds[4] = {'m', 'b', 't', 'q'};
+    for (int k = 0; k < 4; k++) {
+        stat_plan *plan = plan_of(kinds[k]);
+        free(plan->gathered);
+        free(plan->derived);
+        free(plan->child_start);
+        free(plan->children);
+        memset(plan, 0, sizeof(stat_plan));
+    }
+}
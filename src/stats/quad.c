@@ -6,16 +6,11 @@
  * the frequency and positioning of four character sequences.
  *
  * Adding new stats:
- *     1. Incease QUAD_LENGTH by as many stats as you are adding.
- *     2. Define its name, keep it a reasonable length.
- *     3. Set its weight to -INFINITY, and skip to 0 (to be changed later).
- *     4. Set its length to 0, then loop through the DIM4 (36^4) sequences.
- *       4a. Use unflat_quad() to convert the 1D index to a set of 2D coordinates.
- *       4b. Check if the ngram falls under the stat.
- *       4c. If it does, add it to the ngrams array and increment length.
- *       4d. Otherwise set the ngram array element to -1.
- *     5. Iterate the index.
- *     6. Add the statistic to the weights files in data/weights/.
+ *     1. Add its name and classifier to quad_definitions, keep the name a
+ *        reasonable length. The classifier takes the row and column of each
+ *        key and returns whether the quadgram falls under the stat.
+ *     2. Add the statistic to the weights files in data/weights/.
+ *     3. Increase STATS_VERSION in stats_cache.h so cached stats are rebuilt.
  */
 
 #include <string.h>
@@ -28,1411 +23,139 @@
 #include "global.h"
 #include "structs.h"
 
+/* Classifier of a quadgram, given the row and column of each key. */
+typedef int (*quad_classifier)(int, int, int, int, int, int, int, int);
+
+/* The name and classifier of every quadgram stat, in the order they are built. */
+static const struct {
+    const char *name;
+    quad_classifier is_member;
+} quad_definitions[] = {
+    /* SFQs. */
+    {"Same Finger Quadgram", is_same_finger_quad},
+    {"Chained Redirect", is_chained_redirect},
+    {"Bad Chained Redirect", is_bad_chained_redirect},
+    {"Chained Alternation", is_chained_alt},
+    {"Chained Alternation In", is_chained_alt_in},
+    {"Chained Alternation Out", is_chained_alt_out},
+    {"Chained Alternation Mix", is_chained_alt_mix},
+    {"Same Row Chained Alternation", is_chained_same_row_alt},
+    {"Same Row Chained Alternation In", is_chained_same_row_alt_in},
+    {"Same Row Chained Alternation Out", is_chained_same_row_alt_out},
+    {"Same Row Chained Alternation Mix", is_chained_same_row_alt_mix},
+    {"Adjacent Finger Chained Alternation", is_chained_adjacent_finger_alt},
+    {"Adjacent Finger Chained Alternation In", is_chained_adjacent_finger_alt_in},
+    {"Adjacent Finger Chained Alternation Out", is_chained_adjacent_finger_alt_out},
+    {"Adjacent Finger Chained Alternation Mix", is_chained_adjacent_finger_alt_mix},
+    {"Same Row Adjacent Finger Chained Alternation", is_chained_same_row_adjacent_finger_alt},
+    {"Same Row Adjacent Finger Chained Alternation In", is_chained_same_row_adjacent_finger_alt_in},
+    {"Same Row Adjacent Finger Chained Alternation Out", is_chained_same_row_adjacent_finger_alt_out},
+    {"Same Row Adjacent Finger Chained Alternation Mix", is_chained_same_row_adjacent_finger_alt_mix},
+    {"Quad One Hand", is_onehand_quad},
+    {"Quad One Hand In", is_onehand_quad_in},
+    {"Quad One Hand Out", is_onehand_quad_out},
+    {"Quad Same Row One Hand", is_same_row_onehand_quad},
+    {"Quad Same Row One Hand In", is_same_row_onehand_quad_in},
+    {"Quad Same Row One Hand Out", is_same_row_onehand_quad_out},
+    {"Quad Adjacent Finger One Hand", is_adjacent_finger_onehand_quad},
+    {"Quad Adjacent Finger One Hand In", is_adjacent_finger_onehand_quad_in},
+    {"Quad Adjacent Finger One Hand Out", is_adjacent_finger_onehand_quad_out},
+    {"Quad Same Row Adjacent Finger One Hand", is_same_row_adjacent_finger_onehand_quad},
+    {"Quad Same Row Adjacent Finger One Hand In", is_same_row_adjacent_finger_onehand_quad_in},
+    {"Quad Same Row Adjacent Finger One Hand Out", is_same_row_adjacent_finger_onehand_quad_out},
+    {"Quad Roll", is_roll_quad},
+    {"Quad Roll In", is_roll_quad_in},
+    {"Quad Roll Out", is_roll_quad_out},
+    {"Quad Same Row Roll", is_same_row_roll_quad},
+    {"Quad Same Row Roll In", is_same_row_roll_quad_in},
+    {"Quad Same Row Roll Out", is_same_row_roll_quad_out},
+    {"Quad Adjacent Finger Roll", is_adjacent_finger_roll_quad},
+    {"Quad Adjacent Finger Roll In", is_adjacent_finger_roll_quad_in},
+    {"Quad Adjacent Finger Roll Out", is_adjacent_finger_roll_quad_out},
+    {"Quad Same Row Adjacent Finger Roll", is_same_row_adjacent_finger_roll_quad},
+    {"Quad Same Row Adjacent Finger Roll In", is_same_row_adjacent_finger_roll_quad_in},
+    {"Quad Same Row Adjacent Finger Roll Out", is_same_row_adjacent_finger_roll_quad_out},
+    {"True Roll", is_true_roll},
+    {"True Roll In", is_true_roll_in},
+    {"True Roll Out", is_true_roll_out},
+    {"Same Row True Roll", is_same_row_true_roll},
+    {"Same Row True Roll In", is_same_row_true_roll_in},
+    {"Same Row True Roll Out", is_same_row_true_roll_out},
+    {"Adjacent Finger True Roll", is_adjacent_finger_true_roll},
+    {"Adjacent Finger True Roll In", is_adjacent_finger_true_roll_in},
+    {"Adjacent Finger True Roll Out", is_adjacent_finger_true_roll_out},
+    {"Same Row Adjacent Finger True Roll", is_same_row_adjacent_finger_true_roll},
+    {"Same Row Adjacent Finger True Roll In", is_same_row_adjacent_finger_true_roll_in},
+    {"Same Row Adjacent Finger True Roll Out", is_same_row_adjacent_finger_true_roll_out},
+    {"Chained Roll", is_chained_roll},
+    {"Chained Roll In", is_chained_roll_in},
+    {"Chained Roll Out", is_chained_roll_out},
+    {"Chained Roll Mix", is_chained_roll_mix},
+    {"Same Row Chained Roll", is_same_row_chained_roll},
+    {"Same Row Chained Roll In", is_same_row_chained_roll_in},
+    {"Same Row Chained Roll Out", is_same_row_chained_roll_out},
+    {"Same Row Chained Roll Mix", is_same_row_chained_roll_mix},
+    {"Adjacent Finger Chained Roll", is_adjacent_finger_chained_roll},
+    {"Adjacent Finger Chained Roll In", is_adjacent_finger_chained_roll_in},
+    {"Adjacent Finger Chained Roll Out", is_adjacent_finger_chained_roll_out},
+    {"Adjacent Finger Chained Roll Mix", is_adjacent_finger_chained_roll_mix},
+    {"Same Row Adjacent Finger Chained Roll", is_same_row_adjacent_finger_chained_roll},
+    {"Same Row Adjacent Finger Chained Roll In", is_same_row_adjacent_finger_chained_roll_in},
+    {"Same Row Adjacent Finger Chained Roll Out", is_same_row_adjacent_finger_chained_roll_out},
+    {"Same Row Adjacent Finger Chained Roll Mix", is_same_row_adjacent_finger_chained_roll_mix},
+};
+
 /*
- * Initializes the array of quadgram statistics. The function allocates memory
- * for the stat array and sets default values, including a negative infinity
- * weight which will be later overwritten.
+ * Runs one quadgram through every classifier, decoding it once.
+ * Parameters:
+ *   index:   The flat index of the quadgram.
+ *   members: Where to store whether it falls under each stat.
  */
-void initialize_quad_stats()
+static void classify_quad(int index, char *members)
 {
-    QUAD_LENGTH = 71;
-    stats_quad = (quad_stat *)malloc(sizeof(quad_stat) * QUAD_LENGTH);
     int row0, col0, row1, col1, row2, col2, row3, col3;
-    int index = 0;
-
-    /* Allocate and initialize SFQs. */
-    strcpy(stats_quad[index].name, "Same Finger Quadgram");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        /* convert a 1D index into a 8D matrix coordinate */
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3); /* util.c */
-        if (is_same_finger_quad(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Chained Redirect");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_chained_redirect(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Bad Chained Redirect");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_bad_chained_redirect(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Chained Alternation");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_chained_alt(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Chained Alternation In");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_chained_alt_in(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Chained Alternation Out");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_chained_alt_out(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Chained Alternation Mix");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_chained_alt_mix(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Same Row Chained Alternation");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_chained_same_row_alt(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Same Row Chained Alternation In");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_chained_same_row_alt_in(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Same Row Chained Alternation Out");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_chained_same_row_alt_out(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Same Row Chained Alternation Mix");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_chained_same_row_alt_mix(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Adjacent Finger Chained Alternation");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_chained_adjacent_finger_alt(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Adjacent Finger Chained Alternation In");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_chained_adjacent_finger_alt_in(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Adjacent Finger Chained Alternation Out");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_chained_adjacent_finger_alt_out(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Adjacent Finger Chained Alternation Mix");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_chained_adjacent_finger_alt_mix(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Same Row Adjacent Finger Chained Alternation");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_chained_same_row_adjacent_finger_alt(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Same Row Adjacent Finger Chained Alternation In");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_chained_same_row_adjacent_finger_alt_in(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Same Row Adjacent Finger Chained Alternation Out");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_chained_same_row_adjacent_finger_alt_out(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Same Row Adjacent Finger Chained Alternation Mix");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_chained_same_row_adjacent_finger_alt_mix(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad One Hand");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_onehand_quad(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad One Hand In");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_onehand_quad_in(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad One Hand Out");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_onehand_quad_out(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad Same Row One Hand");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_onehand_quad(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad Same Row One Hand In");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_onehand_quad_in(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad Same Row One Hand Out");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_onehand_quad_out(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad Adjacent Finger One Hand");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_adjacent_finger_onehand_quad(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad Adjacent Finger One Hand In");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_adjacent_finger_onehand_quad_in(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad Adjacent Finger One Hand Out");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_adjacent_finger_onehand_quad_out(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad Same Row Adjacent Finger One Hand");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_adjacent_finger_onehand_quad(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad Same Row Adjacent Finger One Hand In");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_adjacent_finger_onehand_quad_in(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad Same Row Adjacent Finger One Hand Out");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_adjacent_finger_onehand_quad_out(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad Roll");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_roll_quad(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad Roll In");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_roll_quad_in(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad Roll Out");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_roll_quad_out(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad Same Row Roll");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_roll_quad(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad Same Row Roll In");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_roll_quad_in(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad Same Row Roll Out");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_roll_quad_out(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad Adjacent Finger Roll");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_adjacent_finger_roll_quad(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad Adjacent Finger Roll In");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_adjacent_finger_roll_quad_in(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad Adjacent Finger Roll Out");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_adjacent_finger_roll_quad_out(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad Same Row Adjacent Finger Roll");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_adjacent_finger_roll_quad(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad Same Row Adjacent Finger Roll In");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_adjacent_finger_roll_quad_in(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Quad Same Row Adjacent Finger Roll Out");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_adjacent_finger_roll_quad_out(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "True Roll");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_true_roll(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "True Roll In");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_true_roll_in(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "True Roll Out");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_true_roll_out(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Same Row True Roll");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_true_roll(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Same Row True Roll In");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_true_roll_in(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Same Row True Roll Out");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_true_roll_out(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Adjacent Finger True Roll");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_adjacent_finger_true_roll(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Adjacent Finger True Roll In");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_adjacent_finger_true_roll_in(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Adjacent Finger True Roll Out");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_adjacent_finger_true_roll_out(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Same Row Adjacent Finger True Roll");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_adjacent_finger_true_roll(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Same Row Adjacent Finger True Roll In");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_adjacent_finger_true_roll_in(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Same Row Adjacent Finger True Roll Out");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_adjacent_finger_true_roll_out(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Chained Roll");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_chained_roll(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Chained Roll In");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_chained_roll_in(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Chained Roll Out");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_chained_roll_out(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Chained Roll Mix");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_chained_roll_mix(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Same Row Chained Roll");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_chained_roll(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Same Row Chained Roll In");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_chained_roll_in(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Same Row Chained Roll Out");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_chained_roll_out(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Same Row Chained Roll Mix");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_chained_roll_mix(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Adjacent Finger Chained Roll");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_adjacent_finger_chained_roll(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Adjacent Finger Chained Roll In");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_adjacent_finger_chained_roll_in(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Adjacent Finger Chained Roll Out");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_adjacent_finger_chained_roll_out(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Adjacent Finger Chained Roll Mix");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_adjacent_finger_chained_roll_mix(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Same Row Adjacent Finger Chained Roll");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_adjacent_finger_chained_roll(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Same Row Adjacent Finger Chained Roll In");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_adjacent_finger_chained_roll_in(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
+    /* convert a 1D index into a 8D matrix coordinate */
+    unflat_quad(index, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3); /* util.c */
+    for (int s = 0; s < QUAD_LENGTH; s++) {
+        members[s] = quad_definitions[s].is_member(row0, col0, row1, col1, row2, col2, row3, col3) != 0;
     }
-    index++;
-
-    strcpy(stats_quad[index].name, "Same Row Adjacent Finger Chained Roll Out");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_adjacent_finger_chained_roll_out(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_quad[index].name, "Same Row Adjacent Finger Chained Roll Mix");
-    stats_quad[index].weight = -INFINITY;
-    stats_quad[index].length = 0;
-    stats_quad[index].skip = 0;
-    for (int i = 0; i < DIM4; i++)
-    {
-        unflat_quad(i, &row0, &col0, &row1, &col1, &row2, &col2, &row3, &col3);
-        if (is_same_row_adjacent_finger_chained_roll_mix(row0, col0, row1, col1, row2, col2, row3, col3))
-        {
-            stats_quad[index].ngrams[i] = i;
-            stats_quad[index].length++;
-        }
-        else
-        {
-            stats_quad[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    if (index != QUAD_LENGTH) { error("QUAD_LENGTH incorrect for number of quad stats"); }
 }
 
-
 /*
- * Trims the ngrams in the array to move unused entries to the end.
- * This process ensures memory efficiency by eliminating gaps in the array.
+ * Returns where the ngram array of one quadgram stat is stored.
+ * Parameters:
+ *   stat: The index of the stat.
  */
-void trim_quad_stats()
+static int **quad_ngrams(int stat)
 {
-    for (int i = 0; i < QUAD_LENGTH; i++)
-    {
-        if (stats_quad[i].length != 0)
-        {
-            int left = 0;
-            int right = DIM4 - 1;
-
-            /* Use two pointers to partition the array */
-            while (left < right) {
-                /* Find the next -1 from the left */
-                while (left < right && stats_quad[i].ngrams[left] != -1) {
-                    left++;
-                }
+    return &stats_quad[stat].ngrams;
+}
 
-                /* Find the next non -1 from the right */
-                while (left < right && stats_quad[i].ngrams[right] == -1) {
-                    right--;
-                }
+/*
+ * Initializes the array of quadgram statistics. The function allocates memory
+ * for the stat array and sets default values, including a negative infinity
+ * weight which will be later overwritten. Every quadgram is classified for
+ * all stats in one pass over the worker pool.
+ */
+void initialize_quad_stats()
+{
+    QUAD_LENGTH = sizeof(quad_definitions) / sizeof(quad_definitions[0]);
+    stats_quad = (quad_stat *)malloc(sizeof(quad_stat) * QUAD_LENGTH);
+    int *lengths = (int *)malloc(sizeof(int) * QUAD_LENGTH);
+    if (stats_quad == NULL || lengths == NULL) {error("failed to malloc quadgram stats");}
 
-                 /* Swap the elements to move -1 to the back and non -1 to the front */
-                if (left < right) {
-                    int temp = stats_quad[i].ngrams[left];
-                    stats_quad[i].ngrams[left] = stats_quad[i].ngrams[right];
-                    stats_quad[i].ngrams[right] = temp;
-                    left++;
-                    right--;
-                }
-            }
-        }
+    for (int i = 0; i < QUAD_LENGTH; i++) {
+        strcpy(stats_quad[i].name, quad_definitions[i].name);
+        stats_quad[i].weight = -INFINITY;
+        stats_quad[i].skip = 0;
     }
+
+    classify_ngrams(4, QUAD_LENGTH, classify_quad, quad_ngrams, lengths); /* stats_util.c */
+    for (int i = 0; i < QUAD_LENGTH; i++) {stats_quad[i].length = lengths[i];}
+    free(lengths);
 }
 
+
 /*
  * Cleans the quadgram statistics array by removing statistics with zero length
  * or weight. This ensures that only relevant statistics are considered in the
@@ -1450,5 +173,6 @@ void clean_quad_stats()
 /* Frees the memory allocated for the quadgram statistics array. */
 void free_quad_stats()
 {
+    for (int i = 0; i < QUAD_LENGTH; i++) {free(stats_quad[i].ngrams);}
     free(stats_quad);
 }
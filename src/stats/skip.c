@@ -10,13 +10,14 @@
  *     1. Incease SKIP_LENGTH by as many stats as you are adding.
  *     2. Define its name, keep it a reasonable length.
  *     3. Set its weight to -INFINITY, and skip to 0 (to be changed later).
- *     4. Set its length to 0, then loop through the DIM2 (36^2) sequences.
+ *     4. Set its length to 0, then loop through the DIM2 sequences of the grid.
  *       4a. Use unflat_bi() to convert the 1D index to a set of 2D coordinates.
  *       4b. Check if the ngram falls under the stat.
  *       4c. If it does, add it to the ngrams array and increment length.
  *       4d. Otherwise set the ngram array element to -1.
  *     5. Iterate the index.
  *     6. Add the statistic to the weights files in data/weights/.
+ *     7. Increase STATS_VERSION in stats_cache.h so cached stats are rebuilt.
  */
 
 #include <string.h>
@@ -38,6 +39,7 @@ void initialize_skip_stats()
 {
     SKIP_LENGTH = 23;
     stats_skip = (skip_stat *)malloc(sizeof(skip_stat) * SKIP_LENGTH);
+    for (int i = 0; i < SKIP_LENGTH; i++) {stats_skip[i].ngrams = full_ngrams(DIM2);} /* stats_util.c */
     int row0, col0, row1, col1;
     int index = 0;
 
@@ -492,40 +494,14 @@ void initialize_skip_stats()
 }
 
 /*
- * Trims the ngrams in the array to move unused entries to the end.
- * This process ensures memory efficiency by eliminating gaps in the array.
+ * Trims the ngram array of every stat down to the ngrams in it, dropping the
+ * -1 entries and any ngram touching a gap of the keyboard.
  */
 void trim_skip_stats()
 {
     for (int i = 0; i < SKIP_LENGTH; i++)
     {
-        if (stats_skip[i].length != 0)
-        {
-            int left = 0;
-            int right = DIM2 - 1;
-
-            /* Use two pointers to partition the array */
-            while (left < right) {
-                /* Find the next -1 from the left */
-                while (left < right && stats_skip[i].ngrams[left] != -1) {
-                    left++;
-                }
-
-                /* Find the next non -1 from the right */
-                while (left < right && stats_skip[i].ngrams[right] == -1) {
-                    right--;
-                }
-
-                 /* Swap the elements to move -1 to the back and non -1 to the front */
-                if (left < right) {
-                    int temp = stats_skip[i].ngrams[left];
-                    stats_skip[i].ngrams[left] = stats_skip[i].ngrams[right];
-                    stats_skip[i].ngrams[right] = temp;
-                    left++;
-                    right--;
-                }
-            }
-        }
+        pack_ngrams(&stats_skip[i].ngrams, &stats_skip[i].length, DIM2, 2); /* stats_util.c */
     }
 }
 
@@ -560,8 +536,67 @@ void clean_skip_stats()
     }
 }
 
+/*
+ * Checks whether a meta stat that is not skipped uses one skip distance of a
+ * skipgram stat.
+ *
+ * Parameters:
+ *   stat:     The index of the skipgram stat.
+ *   distance: The skip distance (1-9).
+ * Returns: 1 if a meta stat uses it, 0 otherwise.
+ */
+static int meta_uses(int stat, int distance)
+{
+    for (int i = 0; i < META_LENGTH; i++)
+    {
+        if (stats_meta[i].skip) {continue;}
+        for (int j = 0; stats_meta[i].stat_types[j] != 'x'; j++)
+        {
+            if (stats_meta[i].stat_types[j] == '0' + distance && stats_meta[i].stat_indices[j] == stat) {return 1;}
+        }
+    }
+    return 0;
+}
+
+/*
+ * Plans which skip distances of each skipgram stat are evaluated: those with
+ * a nonzero weight, and those used by a meta stat that is not skipped. Runs
+ * after define_meta_stats, so the analysis never computes a distance that
+ * cannot change the score.
+ */
+void plan_skip_stats()
+{
+    for (int i = 0; i < SKIP_LENGTH; i++)
+    {
+        stats_skip[i].distance_count = 0;
+        if (stats_skip[i].skip) {continue;}
+        for (int k = 1; k <= 9; k++)
+        {
+            if (stats_skip[i].weight[k] != 0 || meta_uses(i, k))
+            {
+                stats_skip[i].distances[stats_skip[i].distance_count++] = k;
+            }
+        }
+        /* nothing left to evaluate */
+        if (stats_skip[i].distance_count == 0) {stats_skip[i].skip = 1;}
+    }
+}
+
+/*
+ * Checks whether a skip distance of a skipgram stat is evaluated.
+ */
+int evaluates_distance(const skip_stat *stat, int distance)
+{
+    for (int d = 0; d < stat->distance_count; d++)
+    {
+        if (stat->distances[d] == distance) {return 1;}
+    }
+    return 0;
+}
+
 /* Frees the memory allocated for the skipgram statistics array. */
 void free_skip_stats()
 {
+    for (int i = 0; i < SKIP_LENGTH; i++) {free(stats_skip[i].ngrams);}
     free(stats_skip);
 }
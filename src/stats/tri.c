@@ -6,16 +6,11 @@
  * the frequency and positioning of three character sequences.
  *
  * Adding new stats:
- *     1. Incease TRI_LENGTH by as many stats as you are adding.
- *     2. Define its name, keep it a reasonable length.
- *     3. Set its weight to -INFINITY, and skip to 0 (to be changed later).
- *     4. Set its length to 0, then loop through the DIM3 (36^3) sequences.
- *       4a. Use unflat_tri() to convert the 1D index to a set of 2D coordinates.
- *       4b. Check if the ngram falls under the stat.
- *       4c. If it does, add it to the ngrams array and increment length.
- *       4d. Otherwise set the ngram array element to -1.
- *     5. Iterate the index.
- *     6. Add the statistic to the weights files in data/weights/.
+ *     1. Add its name and classifier to tri_definitions, keep the name a
+ *        reasonable length. The classifier takes the row and column of each
+ *        key and returns whether the trigram falls under the stat.
+ *     2. Add the statistic to the weights files in data/weights/.
+ *     3. Increase STATS_VERSION in stats_cache.h so cached stats are rebuilt.
  */
 
 #include <string.h>
@@ -29,801 +24,105 @@
 #include "structs.h"
 
 
+/* Classifier of a trigram, given the row and column of each key. */
+typedef int (*tri_classifier)(int, int, int, int, int, int);
+
+/* The name and classifier of every trigram stat, in the order they are built. */
+static const struct {
+    const char *name;
+    tri_classifier is_member;
+} tri_definitions[] = {
+    /* SFTs. */
+    {"Same Finger Trigram", is_same_finger_tri},
+    /* standard trigram stats after this */
+    {"Redirect", is_redirect},
+    {"Bad Redirect", is_bad_redirect},
+    {"Alternation", is_alt},
+    {"Alternation In", is_alt_in},
+    {"Alternation Out", is_alt_out},
+    {"Same Row Alternation", is_same_row_alt},
+    {"Same Row Alternation In", is_same_row_alt_in},
+    {"Same Row Alternation Out", is_same_row_alt_out},
+    {"Adjacent Finger Alternation", is_adjacent_finger_alt},
+    {"Adjacent Finger Alternation In", is_adjacent_finger_alt_in},
+    {"Adjacent Finger Alternation Out", is_adjacent_finger_alt_out},
+    {"Same Row Adjacent Finger Alternation", is_same_row_adjacent_finger_alt},
+    {"Same Row Adjacent Finger Alternation In", is_same_row_adjacent_finger_alt_in},
+    {"Same Row Adjacent Finger Alternation Out", is_same_row_adjacent_finger_alt_out},
+    {"One Hand", is_onehand},
+    {"One Hand In", is_onehand_in},
+    {"One Hand Out", is_onehand_out},
+    {"Same Row One Hand", is_same_row_onehand},
+    {"Same Row One Hand In", is_same_row_onehand_in},
+    {"Same Row One Hand Out", is_same_row_onehand_out},
+    {"Adjacent Finger One Hand", is_adjacent_finger_onehand},
+    {"Adjacent Finger One Hand In", is_adjacent_finger_onehand_in},
+    {"Adjacent Finger One Hand Out", is_adjacent_finger_onehand_out},
+    {"Same Row Adjacent Finger One Hand", is_same_row_adjacent_finger_onehand},
+    {"Same Row Adjacent Finger One Hand In", is_same_row_adjacent_finger_onehand_in},
+    {"Same Row Adjacent Finger One Hand Out", is_same_row_adjacent_finger_onehand_out},
+    {"Roll", is_roll},
+    {"Roll In", is_roll_in},
+    {"Roll Out", is_roll_out},
+    {"Same Row Roll", is_same_row_roll},
+    {"Same Row Roll In", is_same_row_roll_in},
+    {"Same Row Roll Out", is_same_row_roll_out},
+    {"Adjacent Finger Roll", is_adjacent_finger_roll},
+    {"Adjacent Finger Roll In", is_adjacent_finger_roll_in},
+    {"Adjacent Finger Roll Out", is_adjacent_finger_roll_out},
+    {"Same Row Adjacent Finger Roll", is_same_row_adjacent_finger_roll},
+    {"Same Row Adjacent Finger Roll In", is_same_row_adjacent_finger_roll_in},
+    {"Same Row Adjacent Finger Roll Out", is_same_row_adjacent_finger_roll_out},
+};
+
 /*
- * Initializes the array of tripgram statistics. The function allocates memory
- * for the stat array and sets default values, including a negative infinity
- * weight which will be later overwritten.
+ * Runs one trigram through every classifier, decoding it once.
+ * Parameters:
+ *   index:   The flat index of the trigram.
+ *   members: Where to store whether it falls under each stat.
  */
-void initialize_tri_stats()
+static void classify_tri(int index, char *members)
 {
-    TRI_LENGTH = 39;
-    stats_tri = (tri_stat *)malloc(sizeof(tri_stat) * TRI_LENGTH);
     int row0, col0, row1, col1, row2, col2;
-    int index = 0;
-
-    /* Allocate and initialize SFTs. */
-    strcpy(stats_tri[index].name, "Same Finger Trigram");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        /* convert a 1D index into a 6D matrix coordinate */
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2); /* util.c */
-        if (is_same_finger_tri(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    /* standard trigram stats after this */
-    strcpy(stats_tri[index].name, "Redirect");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_redirect(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Bad Redirect");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_bad_redirect(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Alternation");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_alt(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Alternation In");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_alt_in(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Alternation Out");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_alt_out(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Same Row Alternation");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_same_row_alt(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Same Row Alternation In");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_same_row_alt_in(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Same Row Alternation Out");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_same_row_alt_out(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Adjacent Finger Alternation");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_adjacent_finger_alt(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Adjacent Finger Alternation In");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_adjacent_finger_alt_in(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Adjacent Finger Alternation Out");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_adjacent_finger_alt_out(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Same Row Adjacent Finger Alternation");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_same_row_adjacent_finger_alt(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Same Row Adjacent Finger Alternation In");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_same_row_adjacent_finger_alt_in(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Same Row Adjacent Finger Alternation Out");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_same_row_adjacent_finger_alt_out(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
+    /* convert a 1D index into a 6D matrix coordinate */
+    unflat_tri(index, &row0, &col0, &row1, &col1, &row2, &col2); /* util.c */
+    for (int s = 0; s < TRI_LENGTH; s++) {
+        members[s] = tri_definitions[s].is_member(row0, col0, row1, col1, row2, col2) != 0;
     }
-    index++;
-
-    strcpy(stats_tri[index].name, "One Hand");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_onehand(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "One Hand In");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_onehand_in(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "One Hand Out");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_onehand_out(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Same Row One Hand");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_same_row_onehand(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Same Row One Hand In");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_same_row_onehand_in(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Same Row One Hand Out");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_same_row_onehand_out(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Adjacent Finger One Hand");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_adjacent_finger_onehand(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Adjacent Finger One Hand In");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_adjacent_finger_onehand_in(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Adjacent Finger One Hand Out");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_adjacent_finger_onehand_out(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Same Row Adjacent Finger One Hand");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_same_row_adjacent_finger_onehand(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Same Row Adjacent Finger One Hand In");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_same_row_adjacent_finger_onehand_in(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Same Row Adjacent Finger One Hand Out");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_same_row_adjacent_finger_onehand_out(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Roll");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_roll(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Roll In");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_roll_in(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Roll Out");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_roll_out(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Same Row Roll");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_same_row_roll(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Same Row Roll In");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_same_row_roll_in(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Same Row Roll Out");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_same_row_roll_out(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Adjacent Finger Roll");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_adjacent_finger_roll(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Adjacent Finger Roll In");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_adjacent_finger_roll_in(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Adjacent Finger Roll Out");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_adjacent_finger_roll_out(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Same Row Adjacent Finger Roll");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_same_row_adjacent_finger_roll(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Same Row Adjacent Finger Roll In");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_same_row_adjacent_finger_roll_in(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    strcpy(stats_tri[index].name, "Same Row Adjacent Finger Roll Out");
-    stats_tri[index].weight = -INFINITY;
-    stats_tri[index].length = 0;
-    stats_tri[index].skip = 0;
-    for (int i = 0; i < DIM3; i++)
-    {
-        unflat_tri(i, &row0, &col0, &row1, &col1, &row2, &col2);
-        if (is_same_row_adjacent_finger_roll_out(row0, col0, row1, col1, row2, col2))
-        {
-            stats_tri[index].ngrams[i] = i;
-            stats_tri[index].length++;
-        }
-        else
-        {
-            stats_tri[index].ngrams[i] = -1;
-        }
-    }
-    index++;
-
-    if (index != TRI_LENGTH) {error("TRI_LENGTH incorrect for number of tri stats");}
 }
 
 /*
- * Trims the ngrams in the array to move unused entries to the end.
- * This process ensures memory efficiency by eliminating gaps in the array.
+ * Returns where the ngram array of one trigram stat is stored.
+ * Parameters:
+ *   stat: The index of the stat.
  */
-void trim_tri_stats()
+static int **tri_ngrams(int stat)
 {
-    for (int i = 0; i < TRI_LENGTH; i++)
-    {
-        if (stats_tri[i].length != 0)
-        {
-            int left = 0;
-            int right = DIM3 - 1;
-
-            /* Use two pointers to partition the array */
-            while (left < right) {
-                /* Find the next -1 from the left */
-                while (left < right && stats_tri[i].ngrams[left] != -1) {
-                    left++;
-                }
+    return &stats_tri[stat].ngrams;
+}
 
-                /* Find the next non -1 from the right */
-                while (left < right && stats_tri[i].ngrams[right] == -1) {
-                    right--;
-                }
+/*
+ * Initializes the array of trigram statistics. The function allocates memory
+ * for the stat array and sets default values, including a negative infinity
+ * weight which will be later overwritten. Every trigram is classified for
+ * all stats in one pass over the worker pool.
+ */
+void initialize_tri_stats()
+{
+    TRI_LENGTH = sizeof(tri_definitions) / sizeof(tri_definitions[0]);
+    stats_tri = (tri_stat *)malloc(sizeof(tri_stat) * TRI_LENGTH);
+    int *lengths = (int *)malloc(sizeof(int) * TRI_LENGTH);
+    if (stats_tri == NULL || lengths == NULL) {error("failed to malloc trigram stats");}
 
-                 /* Swap the elements to move -1 to the back and non -1 to the front */
-                if (left < right) {
-                    int temp = stats_tri[i].ngrams[left];
-                    stats_tri[i].ngrams[left] = stats_tri[i].ngrams[right];
-                    stats_tri[i].ngrams[right] = temp;
-                    left++;
-                    right--;
-                }
-            }
-        }
+    for (int i = 0; i < TRI_LENGTH; i++) {
+        strcpy(stats_tri[i].name, tri_definitions[i].name);
+        stats_tri[i].weight = -INFINITY;
+        stats_tri[i].skip = 0;
     }
+
+    classify_ngrams(3, TRI_LENGTH, classify_tri, tri_ngrams, lengths); /* stats_util.c */
+    for (int i = 0; i < TRI_LENGTH; i++) {stats_tri[i].length = lengths[i];}
+    free(lengths);
 }
 
 /*
@@ -843,5 +142,6 @@ void clean_tri_stats()
 /* Frees the memory allocated for the trigram statistics array. */
 void free_tri_stats()
 {
+    for (int i = 0; i < TRI_LENGTH; i++) {free(stats_tri[i].ngrams);}
     free(stats_tri);
 }
@@ -0,0 +1,318 @@
+/*
+ * stats_cache.c - Cache of built stat tables for the GULAG.
+ *
+ * Building the stats classifies every possible ngram of the grid, tens of
+ * millions of quadgrams, on every start. The result only depends on the
+ * geometry of the keyboard and on the stat definitions, so the ngram lists
+ * are kept in './data/stats.gstat' under a key hashed from both. The cache is
+ * mapped with mmap and each list is copied into an array of its own length.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "stats_cache.h"
+#include "stats_util.h"
+#include "custom.h"
+#include "util.h"
+#include "global.h"
+#include "structs.h"
+
+/* Location of the stats cache. */
+#define STATS_CACHE_PATH "./data/stats.gstat"
+
+/* The kinds of stats in the cache, in file order. */
+#define KIND_COUNT 5
+static const uint32_t stat_kinds[KIND_COUNT] = {'m', 'b', 't', 'q', 's'};
+
+/*
+ * Mixes a value into an FNV-1a hash.
+ * Parameters:
+ *   hash:  The hash so far.
+ *   value: The value to mix in.
+ * Returns: The new hash.
+ */
+static uint64_t mix(uint64_t hash, uint64_t value)
+{
+    for (int i = 0; i < 8; i++) {
+        hash = (hash ^ ((value >> (8 * i)) & 0xFF)) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/*
+ * Hashes everything the stat tables are derived from: the dimensions of the
+ * grid and its home row, the hand, finger and stretch of every key, the
+ * custom stat definitions, and STATS_VERSION.
+ */
+uint64_t stats_key()
+{
+    uint64_t hash = 14695981039346656037ULL;
+    hash = mix(hash, STATS_VERSION);
+    hash = mix(hash, ROW);
+    hash = mix(hash, COL);
+    hash = mix(hash, HOME_ROW);
+    for (int i = 0; i < ROW; i++) {
+        for (int j = 0; j < COL; j++) {
+            hash = mix(hash, hand(i, j)); /* stats_util.c */
+            hash = mix(hash, finger(i, j)); /* stats_util.c */
+            hash = mix(hash, is_stretch(i, j)); /* stats_util.c */
+        }
+    }
+    hash = mix(hash, custom_stats_hash()); /* stats/custom.c */
+    return hash;
+}
+
+/*
+ * Returns the number of stats of a kind.
+ * Parameters:
+ *   kind: The kind of stat.
+ */
+static int stat_count(uint32_t kind)
+{
+    switch (kind) {
+        case 'm': return MONO_LENGTH;
+        case 'b': return BI_LENGTH;
+        case 't': return TRI_LENGTH;
+        case 'q': return QUAD_LENGTH;
+        default: return SKIP_LENGTH;
+    }
+}
+
+/*
+ * Returns the number of entries in the ngram array of a kind of stat.
+ * Parameters:
+ *   kind: The kind of stat.
+ */
+static int stat_limit(uint32_t kind)
+{
+    switch (kind) {
+        case 'm': return DIM1;
+        case 'b': return DIM2;
+        case 't': return DIM3;
+        case 'q': return DIM4;
+        default: return DIM2;
+    }
+}
+
+/*
+ * Finds the fields of one stat shared by every kind.
+ * Parameters:
+ *   kind:   The kind of stat.
+ *   i:      The index of the stat in its array.
+ *   name:   Where to store the address of its name.
+ *   length: Where to store the address of its length.
+ * Returns: Where its ngram array is stored.
+ */
+static int **stat_fields(uint32_t kind, int i, char **name, int **length)
+{
+    switch (kind) {
+        case 'm': *name = stats_mono[i].name; *length = &stats_mono[i].length; return &stats_mono[i].ngrams;
+        case 'b': *name = stats_bi[i].name; *length = &stats_bi[i].length; return &stats_bi[i].ngrams;
+        case 't': *name = stats_tri[i].name; *length = &stats_tri[i].length; return &stats_tri[i].ngrams;
+        case 'q': *name = stats_quad[i].name; *length = &stats_quad[i].length; return &stats_quad[i].ngrams;
+        default: *name = stats_skip[i].name; *length = &stats_skip[i].length; return &stats_skip[i].ngrams;
+    }
+}
+
+/*
+ * Allocates the stat array of a kind and sets the default values of every
+ * stat, as the initialize functions do, without touching the ngram arrays.
+ * Parameters:
+ *   kind:  The kind of stat.
+ *   count: The number of stats.
+ */
+static void allocate_stats(uint32_t kind, int count)
+{
+    switch (kind) {
+        case 'm':
+            MONO_LENGTH = count;
+            stats_mono = (mono_stat *)malloc(sizeof(mono_stat) * count);
+            if (stats_mono == NULL) {error("failed to malloc monogram stats");}
+            for (int i = 0; i < count; i++) {
+                stats_mono[i].weight = -INFINITY;
+                stats_mono[i].skip = 0;
+            }
+            break;
+        case 'b':
+            BI_LENGTH = count;
+            stats_bi = (bi_stat *)malloc(sizeof(bi_stat) * count);
+            if (stats_bi == NULL) {error("failed to malloc bigram stats");}
+            for (int i = 0; i < count; i++) {
+                stats_bi[i].weight = -INFINITY;
+                stats_bi[i].skip = 0;
+            }
+            break;
+        case 't':
+            TRI_LENGTH = count;
+            stats_tri = (tri_stat *)malloc(sizeof(tri_stat) * count);
+            if (stats_tri == NULL) {error("failed to malloc trigram stats");}
+            for (int i = 0; i < count; i++) {
+                stats_tri[i].weight = -INFINITY;
+                stats_tri[i].skip = 0;
+            }
+            break;
+        case 'q':
+            QUAD_LENGTH = count;
+            stats_quad = (quad_stat *)malloc(sizeof(quad_stat) * count);
+            if (stats_quad == NULL) {error("failed to malloc quadgram stats");}
+            for (int i = 0; i < count; i++) {
+                stats_quad[i].weight = -INFINITY;
+                stats_quad[i].skip = 0;
+            }
+            break;
+        default:
+            SKIP_LENGTH = count;
+            stats_skip = (skip_stat *)malloc(sizeof(skip_stat) * count);
+            if (stats_skip == NULL) {error("failed to malloc skipgram stats");}
+            for (int i = 0; i < count; i++) {
+                for (int j = 0; j < 10; j++) {stats_skip[i].weight[j] = -INFINITY;}
+                stats_skip[i].skip = 0;
+            }
+            break;
+    }
+}
+
+/*
+ * Reads the monogram to skipgram stats from the stats cache, in place of
+ * building them. Each ngram array is allocated to exactly its length.
+ */
+int read_stats_cache()
+{
+    int fd = open(STATS_CACHE_PATH, O_RDONLY);
+    if (fd < 0) {return 0;}
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(stats_header)) {
+        close(fd);
+        return 0;
+    }
+    size_t size = info.st_size;
+    unsigned char *map = (unsigned char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {return 0;}
+
+    /* check every table before any stat is allocated */
+    stats_header *header = (stats_header *)map;
+    stats_table *tables = (stats_table *)(map + sizeof(stats_header));
+    int counts[KIND_COUNT] = {0};
+    int valid = memcmp(header->magic, STATS_MAGIC, 8) == 0 && header->format == STATS_FORMAT
+        && header->key == stats_key()
+        && header->table_count <= (size - sizeof(stats_header)) / sizeof(stats_table);
+    int last = 0;
+    for (uint32_t t = 0; valid && t < header->table_count; t++) {
+        int k = 0;
+        while (k < KIND_COUNT && tables[t].kind != stat_kinds[k]) {k++;}
+        /* kinds come in file order, so each array fills from the front */
+        valid = k < KIND_COUNT && k >= last
+            && tables[t].length <= (uint32_t)stat_limit(tables[t].kind)
+            && tables[t].offset % 64 == 0 && tables[t].offset <= size
+            && tables[t].length <= (size - tables[t].offset) / sizeof(int32_t)
+            && memchr(tables[t].name, '\0', STATS_NAME_LENGTH) != NULL
+            && strlen(tables[t].name) < sizeof(stats_mono[0].name);
+        if (valid) {
+            counts[k]++;
+            last = k;
+        }
+    }
+    if (!valid) {
+        munmap(map, size);
+        return 0;
+    }
+
+    for (int k = 0; k < KIND_COUNT; k++) {allocate_stats(stat_kinds[k], counts[k]);}
+    int index[KIND_COUNT] = {0};
+    for (uint32_t t = 0; t < header->table_count; t++) {
+        int k = 0;
+        while (tables[t].kind != stat_kinds[k]) {k++;}
+        char *name;
+        int *length;
+        int **ngrams = stat_fields(stat_kinds[k], index[k]++, &name, &length);
+        strcpy(name, tables[t].name);
+        *length = tables[t].length;
+        *ngrams = (int *)malloc(sizeof(int) * (*length > 0 ? *length : 1));
+        if (*ngrams == NULL) {error("failed to malloc cached stat ngrams");}
+        memcpy(*ngrams, map + tables[t].offset, tables[t].length * sizeof(int32_t));
+    }
+    munmap(map, size);
+    return 1;
+}
+
+/*
+ * Writes a number of bytes to the stats cache, failing loudly.
+ * Parameters:
+ *   file:  The file to write to.
+ *   data:  The bytes to write.
+ *   count: The number of bytes.
+ */
+static void write_bytes(FILE *file, const void *data, size_t count)
+{
+    if (fwrite(data, 1, count, file) != count) {error("Stats cache file failed to be written.");}
+}
+
+/*
+ * Writes the built monogram to skipgram stats to the stats cache.
+ * The file is written to a temporary file and renamed over the old one, so a
+ * reader never sees it half written.
+ */
+void write_stats_cache()
+{
+    stats_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, STATS_MAGIC, 8);
+    header.format = STATS_FORMAT;
+    header.key = stats_key();
+    for (int k = 0; k < KIND_COUNT; k++) {header.table_count += stat_count(stat_kinds[k]);}
+
+    stats_table *tables = (stats_table *)calloc(header.table_count, sizeof(stats_table));
+    if (tables == NULL) {error("failed to calloc stats cache tables");}
+    uint64_t offset = sizeof(header) + header.table_count * sizeof(stats_table);
+    int t = 0;
+    for (int k = 0; k < KIND_COUNT; k++) {
+        for (int i = 0; i < stat_count(stat_kinds[k]); i++, t++) {
+            char *name;
+            int *length;
+            stat_fields(stat_kinds[k], i, &name, &length);
+            tables[t].kind = stat_kinds[k];
+            tables[t].length = *length;
+            offset = (offset + 63) / 64 * 64;
+            tables[t].offset = offset;
+            strncpy(tables[t].name, name, STATS_NAME_LENGTH - 1);
+            offset += (uint64_t)*length * sizeof(int32_t);
+        }
+    }
+
+    char temp[64];
+    sprintf(temp, "%s.%ld.tmp", STATS_CACHE_PATH, (long)getpid());
+    FILE *cache = fopen(temp, "wb");
+    if (cache == NULL) {error("Stats cache file failed to be created.");}
+
+    static const unsigned char padding[64] = {0};
+    uint64_t written = sizeof(header) + header.table_count * sizeof(stats_table);
+    write_bytes(cache, &header, sizeof(header));
+    write_bytes(cache, tables, header.table_count * sizeof(stats_table));
+    t = 0;
+    for (int k = 0; k < KIND_COUNT; k++) {
+        for (int i = 0; i < stat_count(stat_kinds[k]); i++, t++) {
+            char *name;
+            int *length;
+            int **ngrams = stat_fields(stat_kinds[k], i, &name, &length);
+            write_bytes(cache, padding, tables[t].offset - written);
+            write_bytes(cache, *ngrams, tables[t].length * sizeof(int32_t));
+            written = tables[t].offset + tables[t].length * sizeof(int32_t);
+        }
+    }
+    free(tables);
+
+    if (fflush(cache) != 0 || fsync(fileno(cache)) != 0) {error("Stats cache file failed to be written.");}
+    fclose(cache);
+    if (rename(temp, STATS_CACHE_PATH) != 0) {
+        remove(temp);
+        error("Stats cache file failed to be replaced.");
+    }
+}
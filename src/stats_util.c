@@ -3,11 +3,15 @@
  *
  * This file contains utility functions for determining what stats each key
  * sequences (n-grams) falls under, as well as other miscellaneous helpers.
+ * Built stats are cached, so a change to a classifier here also needs
+ * STATS_VERSION in stats_cache.h increased.
  */
 
 #include <string.h>
+#include <stdlib.h>
 
 #include "stats_util.h"
+#include "pool.h"
 #include "global.h"
 #include "structs.h"
 #include "util.h"
@@ -93,46 +97,202 @@ int find_stat_index(char *stat_name, char type) {
     return -1;
 }
 
+/* Number of ngrams classified by one task. */
+#define CLASSIFY_BLOCK 4096
+
+/* One block of ngrams to classify for every stat. */
+typedef struct classify_task {
+    /* the block, as ranks among the ngrams of keys only */
+    int start;
+    int end;
+    int keys;
+    /* the positions of the grid holding a key, ascending */
+    const int *positions;
+    int key_count;
+    int count;
+    void (*classify)(int index, char *members);
+    /* the ngrams of each stat within the block, stat after stat */
+    int *ngrams;
+    /* the number of ngrams of each stat within the block */
+    int *lengths;
+} classify_task;
+
+/*
+ * Returns whether every key of an ngram is on the keyboard, rather than in a
+ * gap of its grid.
+ */
+int is_key_ngram(int index, int keys)
+{
+    for (int k = 0; k < keys; k++) {
+        int position = index % DIM1;
+        if (key_fingers[position / COL][position % COL] < 0) {return 0;}
+        index /= DIM1;
+    }
+    return 1;
+}
+
+/*
+ * Returns the ngram at a rank among the ngrams of keys only. The rank counts
+ * in base 'key_count' in the same digit order as the flat index, so ascending
+ * ranks give ascending indices.
+ */
+static int key_ngram(int rank, int keys, const int *positions, int key_count)
+{
+    int index = 0;
+    int scale = 1;
+    for (int k = 0; k < keys; k++) {
+        index += positions[rank % key_count] * scale;
+        rank /= key_count;
+        scale *= DIM1;
+    }
+    return index;
+}
+
+/*
+ * Pool task that classifies one block of ngrams. Every ngram is classified
+ * for all stats first, then the members of each stat are listed in one run,
+ * rather than touching every list for every ngram.
+ * Parameters:
+ *   arg: A pointer to a classify_task.
+ */
+static void classify_block(void *arg)
+{
+    classify_task *task = (classify_task *)arg;
+    int size = task->end - task->start;
+    char *members = (char *)malloc((size_t)size * task->count);
+    if (members == NULL) {error("failed to malloc ngram classes");}
+
+    int total = 0;
+    for (int i = 0; i < size; i++) {
+        char *classes = members + (size_t)i * task->count;
+        task->classify(key_ngram(task->start + i, task->keys, task->positions, task->key_count), classes);
+        for (int s = 0; s < task->count; s++) {total += classes[s];}
+    }
+
+    task->ngrams = (int *)malloc(sizeof(int) * (total > 0 ? total : 1));
+    if (task->ngrams == NULL) {error("failed to malloc classified ngrams");}
+    int *next = task->ngrams;
+    for (int s = 0; s < task->count; s++) {
+        int length = 0;
+        for (int i = 0; i < size; i++) {
+            if (members[(size_t)i * task->count + s]) {
+                next[length++] = key_ngram(task->start + i, task->keys, task->positions, task->key_count);
+            }
+        }
+        task->lengths[s] = length;
+        next += length;
+    }
+    free(members);
+}
+
+/*
+ * Classifies every ngram of one size for a set of stats in a single pass.
+ * Each ngram is decoded once and run through every classifier, and the ngrams
+ * are split into blocks across the worker pool. The lists of the blocks are
+ * then joined in order, so each stat gets exactly its ngrams, ascending. Only
+ * the ngrams of keys are enumerated, never the gaps of the grid.
+ */
+void classify_ngrams(int keys, int count, void (*classify)(int index, char *members),
+    int **(*ngrams)(int stat), int *lengths)
+{
+    int *positions = (int *)malloc(sizeof(int) * DIM1);
+    if (positions == NULL) {error("failed to malloc classification tasks");}
+    int key_count = 0;
+    for (int p = 0; p < DIM1; p++) {
+        if (key_fingers[p / COL][p % COL] >= 0) {positions[key_count++] = p;}
+    }
+    int size = 1;
+    for (int k = 0; k < keys; k++) {size *= key_count;}
+
+    int blocks = (size + CLASSIFY_BLOCK - 1) / CLASSIFY_BLOCK;
+    classify_task *tasks = (classify_task *)malloc(sizeof(classify_task) * blocks);
+    int *block_lengths = (int *)malloc(sizeof(int) * blocks * count);
+    if (tasks == NULL || block_lengths == NULL) {error("failed to malloc classification tasks");}
+
+    for (int b = 0; b < blocks; b++) {
+        tasks[b].start = b * CLASSIFY_BLOCK;
+        tasks[b].end = tasks[b].start + CLASSIFY_BLOCK < size ? tasks[b].start + CLASSIFY_BLOCK : size;
+        tasks[b].keys = keys;
+        tasks[b].positions = positions;
+        tasks[b].key_count = key_count;
+        tasks[b].count = count;
+        tasks[b].classify = classify;
+        tasks[b].lengths = block_lengths + (size_t)b * count;
+        pool_submit(classify_block, &tasks[b]); /* pool.c */
+    }
+    pool_wait(); /* pool.c */
+
+    /* each block holds its stats one after another, in stat order */
+    int **next = (int **)malloc(sizeof(int *) * count);
+    if (next == NULL) {error("failed to malloc stat ngrams");}
+    for (int s = 0; s < count; s++) {
+        lengths[s] = 0;
+        for (int b = 0; b < blocks; b++) {lengths[s] += tasks[b].lengths[s];}
+        *ngrams(s) = (int *)malloc(sizeof(int) * (lengths[s] > 0 ? lengths[s] : 1));
+        if (*ngrams(s) == NULL) {error("failed to malloc stat ngrams");}
+        next[s] = *ngrams(s);
+    }
+    for (int b = 0; b < blocks; b++) {
+        int *block = tasks[b].ngrams;
+        for (int s = 0; s < count; s++) {
+            memcpy(next[s], block, sizeof(int) * tasks[b].lengths[s]);
+            next[s] += tasks[b].lengths[s];
+            block += tasks[b].lengths[s];
+        }
+        free(tasks[b].ngrams);
+    }
+    free(next);
+    free(block_lengths);
+    free(tasks);
+    free(positions);
+}
+
+/*
+ * Packs the ngram array of a hand written stat, built over every ngram with
+ * the index of each member and -1 elsewhere, down to exactly its members on
+ * the keyboard, in ascending order. Sets the length of the stat to match.
+ */
+void pack_ngrams(int **ngrams, int *length, int size, int keys)
+{
+    int *array = *ngrams;
+    int packed = 0;
+    for (int i = 0; i < size; i++) {
+        if (array[i] != -1 && is_key_ngram(array[i], keys)) {array[packed++] = array[i];}
+    }
+    *length = packed;
+    int *shrunk = (int *)realloc(array, sizeof(int) * (packed > 0 ? packed : 1));
+    if (shrunk == NULL) {error("failed to realloc stat ngrams");}
+    *ngrams = shrunk;
+}
+
+/*
+ * Allocates the ngram array of a hand written stat over every ngram of its
+ * size, to be filled by the initialize functions and packed afterwards.
+ */
+int *full_ngrams(int size)
+{
+    int *ngrams = (int *)malloc(sizeof(int) * size);
+    if (ngrams == NULL) {error("failed to malloc stat ngrams");}
+    return ngrams;
+}
+
 /* 'l' for left hand, 'r' for right hand. */
 char hand(int row0, int col0)
 {
-    if (col0 < COL/2) {return 'l';}
+    if (key_fingers[row0][col0] < 4) {return 'l';}
     else {return 'r';}
 }
 
-/* An integer representing the finger used (0-7). */
+/* An integer representing the finger used (0-7), -1 without a key. */
 int finger(int row0, int col0)
 {
-    switch(col0)
-    {
-        default:
-        case 0:
-        case 1:
-            return 0;
-        case 2:
-            return 1;
-        case 3:
-            return 2;
-        case 4:
-        case 5:
-            return 3;
-        case 6:
-        case 7:
-            return 4;
-        case 8:
-            return 5;
-        case 9:
-            return 6;
-        case 10:
-        case 11:
-            return 7;
-    }
+    return key_fingers[row0][col0];
 }
 
 /* pinky and index stretch */
 int is_stretch(int row0, int col0)
 {
-    return col0 == 0 || col0 == 5 || col0 == 6 || col0 == 11;
+    return key_stretch[row0][col0];
 }
 
 int is_same_hand_bi(int row0, int col0, int row1, int col1)
@@ -327,20 +487,22 @@ int is_half_russor(int row0, int col0, int row1, int col1)
         && is_russor_fingers(row0, col0, row1, col1);
 }
 
+/* middle finger next to an index stretch key of the same hand */
 int is_index_stretch_bi(int row0, int col0, int row1, int col1)
 {
-    return (finger(row0, col0) == 2 && col1 == 5)
-        || (finger(row1, col1) == 2 && col0 == 5)
-        || (finger(row0, col0) == 5 && col1 == 6)
-        || (finger(row1, col1) == 5 && col0 == 6);
+    return (finger(row0, col0) == 2 && finger(row1, col1) == 3 && is_stretch(row1, col1))
+        || (finger(row1, col1) == 2 && finger(row0, col0) == 3 && is_stretch(row0, col0))
+        || (finger(row0, col0) == 5 && finger(row1, col1) == 4 && is_stretch(row1, col1))
+        || (finger(row1, col1) == 5 && finger(row0, col0) == 4 && is_stretch(row0, col0));
 }
 
+/* ring finger next to a pinky stretch key of the same hand */
 int is_pinky_stretch_bi(int row0, int col0, int row1, int col1)
 {
-    return (finger(row0, col0) == 1 && col1 == 0)
-        || (finger(row1, col1) == 1 && col0 == 0)
-        || (finger(row0, col0) == 6 && col1 == 11)
-        || (finger(row1, col1) == 6 && col0 == 11);
+    return (finger(row0, col0) == 1 && finger(row1, col1) == 0 && is_stretch(row1, col1))
+        || (finger(row1, col1) == 1 && finger(row0, col0) == 0 && is_stretch(row0, col0))
+        || (finger(row0, col0) == 6 && finger(row1, col1) == 7 && is_stretch(row1, col1))
+        || (finger(row1, col1) == 6 && finger(row0, col0) == 7 && is_stretch(row0, col0));
 }
 
 /*                                                   */
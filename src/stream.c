@@ -0,0 +1,399 @@
+/*
+ * stream.c - Streaming corpus input for the GULAG.
+ *
+ * Compressed corpora and standard input cannot be mapped, so they are read as
+ * a sequence of large chunks instead. A decompression thread fills a ring of
+ * chunks while the reader counts the ones before them, and the two only meet
+ * on a lock when a chunk changes hands. The format is detected from the magic
+ * bytes at the start of the input, which are then fed to the decoder.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "stream.h"
+#include "util.h"
+
+/* Compressed bytes read from the file at a time. */
+#define INPUT_BYTES (1 << 20)
+
+/* Longest magic number of a supported format. */
+#define MAGIC_BYTES 6
+
+enum stream_formats {FORMAT_PLAIN, FORMAT_GZIP, FORMAT_XZ, FORMAT_ZSTD};
+
+/* One chunk of the ring and whether it holds bytes the reader has not taken. */
+typedef struct stream_chunk {
+    unsigned char *buffer;
+    size_t size;
+    int full;
+} stream_chunk;
+
+struct stream {
+    int fd;
+    int format;
+    /* compressed input, or the magic bytes of plain text not yet passed on */
+    unsigned char *input;
+    size_t input_pos;
+    size_t input_size;
+    int input_done;
+#ifdef HAVE_ZLIB
+    z_stream gzip;
+    int gzip_member;
+#endif
+#ifdef HAVE_LZMA
+    lzma_stream xz;
+#endif
+#ifdef HAVE_ZSTD
+    ZSTD_DStream *zstd;
+    size_t zstd_left;
+#endif
+    int ended;
+
+    size_t chunk;
+    size_t prefix;
+    stream_chunk *chunks;
+    int depth;
+    /* the next chunk the reader takes, counted from the start */
+    long taken;
+    int finished;
+
+    pthread_t thread;
+    /* protects the full flags of the chunks, backs both condition variables */
+    pthread_mutex_t lock;
+    pthread_cond_t filled;
+    pthread_cond_t emptied;
+};
+
+/*
+ * Detects a compression format from the first bytes of a file.
+ * Parameters:
+ *   magic: The first bytes.
+ *   size:  The number of bytes, fewer only for very short files.
+ * Returns: The format, plain text if no magic number matches.
+ */
+static int detect_format(const unsigned char *magic, size_t size)
+{
+    if (size >= 2 && magic[0] == 0x1F && magic[1] == 0x8B) {return FORMAT_GZIP;}
+    if (size >= 6 && memcmp(magic, "\xFD" "7zXZ\0", 6) == 0) {return FORMAT_XZ;}
+    if (size >= 4 && memcmp(magic, "\x28\xB5\x2F\xFD", 4) == 0) {return FORMAT_ZSTD;}
+    return FORMAT_PLAIN;
+}
+
+/*
+ * Checks whether a regular file starts with the magic bytes of a compression
+ * format, without moving its file offset.
+ */
+int compressed_file(int fd)
+{
+    unsigned char magic[MAGIC_BYTES];
+    ssize_t size = pread(fd, magic, MAGIC_BYTES, 0);
+    return size > 0 && detect_format(magic, size) != FORMAT_PLAIN;
+}
+
+/*
+ * Reads up to a number of bytes, retrying short reads until the end of file.
+ * Parameters:
+ *   fd:   The file.
+ *   data: Where to store the bytes.
+ *   size: The number of bytes wanted.
+ * Returns: The number of bytes read, less than size only at the end of file.
+ */
+static size_t read_full(int fd, unsigned char *data, size_t size)
+{
+    size_t done = 0;
+    while (done < size) {
+        ssize_t got = read(fd, data + done, size - done);
+        if (got < 0 && errno == EINTR) {continue;}
+        if (got < 0) {error("Failed to read the corpus.");}
+        if (got == 0) {break;}
+        done += got;
+    }
+    return done;
+}
+
+/*
+ * Refills the input buffer with compressed bytes once the decoder used it up.
+ * Parameters:
+ *   s: The stream.
+ * Returns: The number of bytes read, 0 at the end of file.
+ */
+static size_t refill(stream *s)
+{
+    s->input_pos = 0;
+    s->input_size = read_full(s->fd, s->input, INPUT_BYTES);
+    s->input_done = s->input_size == 0;
+    return s->input_size;
+}
+
+/*
+ * Decompresses the next bytes of the stream. Each format is decoded to its
+ * end, and concatenated gzip members, xz streams and zstd frames are read as
+ * one text, the way the command line tools do.
+ * Parameters:
+ *   s:    The stream.
+ *   data: Where to store the bytes.
+ *   size: The number of bytes wanted.
+ * Returns: The number of bytes produced, 0 only at the end of the stream.
+ */
+static size_t decode(stream *s, unsigned char *data, size_t size)
+{
+    if (s->ended) {return 0;}
+    switch (s->format) {
+#ifdef HAVE_ZLIB
+        case FORMAT_GZIP:
+            s->gzip.next_out = data;
+            s->gzip.avail_out = size;
+            while (s->gzip.avail_out == size) {
+                if (s->gzip.avail_in == 0) {
+                    if (refill(s) == 0) {
+                        if (s->gzip_member) {error("Compressed corpus ends early.");}
+                        s->ended = 1;
+                        break;
+                    }
+                    s->gzip.next_in = s->input;
+                    s->gzip.avail_in = s->input_size;
+                }
+                s->gzip_member = 1;
+                int result = inflate(&s->gzip, Z_NO_FLUSH);
+                if (result == Z_STREAM_END) {
+                    /* another member may follow */
+                    inflateReset(&s->gzip);
+                    s->gzip_member = 0;
+                } else if (result != Z_OK && result != Z_BUF_ERROR) {
+                    error("Corpus is not valid gzip data.");
+                }
+            }
+            return size - s->gzip.avail_out;
+#endif
+#ifdef HAVE_LZMA
+        case FORMAT_XZ:
+            s->xz.next_out = data;
+            s->xz.avail_out = size;
+            while (s->xz.avail_out == size) {
+                if (s->xz.avail_in == 0 && !s->input_done) {
+                    s->xz.next_in = s->input;
+                    s->xz.avail_in = refill(s);
+                }
+                lzma_ret result = lzma_code(&s->xz, s->input_done ? LZMA_FINISH : LZMA_RUN);
+                if (result == LZMA_STREAM_END) {
+                    s->ended = 1;
+                    break;
+                }
+                if (result == LZMA_BUF_ERROR) {error("Compressed corpus ends early.");}
+                if (result != LZMA_OK) {error("Corpus is not valid xz data.");}
+            }
+            return size - s->xz.avail_out;
+#endif
+#ifdef HAVE_ZSTD
+        case FORMAT_ZSTD: {
+            ZSTD_outBuffer out = {data, size, 0};
+            while (out.pos == 0) {
+                if (s->input_pos == s->input_size && refill(s) == 0) {
+                    if (s->zstd_left != 0) {error("Compressed corpus ends early.");}
+                    s->ended = 1;
+                    break;
+                }
+                ZSTD_inBuffer in = {s->input, s->input_size, s->input_pos};
+                s->zstd_left = ZSTD_decompressStream(s->zstd, &out, &in);
+                if (ZSTD_isError(s->zstd_left)) {error("Corpus is not valid zstd data.");}
+                s->input_pos = in.pos;
+            }
+            return out.pos;
+        }
+#endif
+        default: {
+            /* the magic bytes already read come first */
+            size_t done = s->input_size - s->input_pos;
+            if (done > size) {done = size;}
+            memcpy(data, s->input + s->input_pos, done);
+            s->input_pos += done;
+            done += read_full(s->fd, data + done, size - done);
+            s->ended = done == 0;
+            return done;
+        }
+    }
+}
+
+/*
+ * Thread that fills the chunks of the ring in order, waiting whenever the
+ * next one is still held by the reader. A chunk short of full ends the
+ * stream.
+ * Parameters:
+ *   arg: A pointer to the stream.
+ */
+static void *decompress(void *arg)
+{
+    stream *s = (stream *)arg;
+    for (long n = 0;; n++) {
+        stream_chunk *c = &s->chunks[n % s->depth];
+        pthread_mutex_lock(&s->lock);
+        while (c->full) {pthread_cond_wait(&s->emptied, &s->lock);}
+        pthread_mutex_unlock(&s->lock);
+
+        unsigned char *data = c->buffer + s->prefix;
+        size_t size = 0;
+        while (size < s->chunk) {
+            size_t got = decode(s, data + size, s->chunk - size);
+            if (got == 0) {break;}
+            size += got;
+        }
+
+        pthread_mutex_lock(&s->lock);
+        c->size = size;
+        c->full = 1;
+        pthread_cond_signal(&s->filled);
+        pthread_mutex_unlock(&s->lock);
+        if (size < s->chunk) {return NULL;}
+    }
+}
+
+/*
+ * Starts reading a file on a new decompression thread.
+ */
+stream *open_stream(int fd, size_t chunk, size_t prefix, int depth)
+{
+    stream *s = (stream *)calloc(1, sizeof(stream));
+    if (s == NULL) {error("failed to calloc corpus stream");}
+    s->fd = fd;
+    s->chunk = chunk;
+    s->prefix = prefix;
+    s->depth = depth < 2 ? 2 : depth;
+    s->input = (unsigned char *)malloc(INPUT_BYTES);
+    s->chunks = (stream_chunk *)calloc(s->depth, sizeof(stream_chunk));
+    if (s->input == NULL || s->chunks == NULL) {error("failed to malloc corpus stream");}
+    for (int i = 0; i < s->depth; i++) {
+        s->chunks[i].buffer = (unsigned char *)malloc(prefix + chunk);
+        if (s->chunks[i].buffer == NULL) {error("failed to malloc corpus stream chunk");}
+    }
+
+    /* the magic bytes stay in the input buffer for the decoder */
+    s->input_size = read_full(fd, s->input, MAGIC_BYTES);
+    s->format = detect_format(s->input, s->input_size);
+    switch (s->format) {
+        case FORMAT_GZIP:
+#ifdef HAVE_ZLIB
+            /* 32 added to the window bits only accepts the gzip header */
+            if (inflateInit2(&s->gzip, 15 + 32) != Z_OK) {error("failed to start gzip decoder");}
+            s->gzip.next_in = s->input;
+            s->gzip.avail_in = s->input_size;
+            break;
+#else
+            error("Corpus is gzip compressed, but GULAG was built without zlib.");
+#endif
+        case FORMAT_XZ:
+#ifdef HAVE_LZMA
+            if (lzma_stream_decoder(&s->xz, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) {
+                error("failed to start xz decoder");
+            }
+            s->xz.next_in = s->input;
+            s->xz.avail_in = s->input_size;
+            break;
+#else
+            error("Corpus is xz compressed, but GULAG was built without liblzma.");
+#endif
+        case FORMAT_ZSTD:
+#ifdef HAVE_ZSTD
+            s->zstd = ZSTD_createDStream();
+            if (s->zstd == NULL || ZSTD_isError(ZSTD_initDStream(s->zstd))) {error("failed to start zstd decoder");}
+            break;
+#else
+            error("Corpus is zstd compressed, but GULAG was built without libzstd.");
+#endif
+        default:
+            break;
+    }
+
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->filled, NULL);
+    pthread_cond_init(&s->emptied, NULL);
+    if (pthread_create(&s->thread, NULL, decompress, s) != 0) {error("failed to start decompression thread");}
+    return s;
+}
+
+/*
+ * Returns the name of the format of a stream.
+ */
+const char *stream_format(const stream *s)
+{
+    const char *names[] = {"text", "gzip", "xz", "zstd"};
+    return names[s->format];
+}
+
+/*
+ * Waits for the next chunk of decompressed bytes.
+ */
+unsigned char *stream_next(stream *s, size_t *size)
+{
+    if (s->finished) {return NULL;}
+    stream_chunk *c = &s->chunks[s->taken % s->depth];
+    pthread_mutex_lock(&s->lock);
+    while (!c->full) {pthread_cond_wait(&s->filled, &s->lock);}
+    pthread_mutex_unlock(&s->lock);
+
+    s->taken++;
+    /* the decompression thread stops after a short chunk */
+    s->finished = c->size < s->chunk;
+    if (c->size == 0) {
+        stream_release(s, c->buffer + s->prefix);
+        return NULL;
+    }
+    *size = c->size;
+    return c->buffer + s->prefix;
+}
+
+/*
+ * Gives a chunk back to the decompression thread to be filled again.
+ */
+void stream_release(stream *s, unsigned char *data)
+{
+    for (int i = 0; i < s->depth; i++) {
+        if (s->chunks[i].buffer + s->prefix != data) {continue;}
+        pthread_mutex_lock(&s->lock);
+        s->chunks[i].full = 0;
+        pthread_cond_signal(&s->emptied);
+        pthread_mutex_unlock(&s->lock);
+        return;
+    }
+}
+
+/*
+ * Waits for the decompression thread and frees the stream.
+ */
+void close_stream(stream *s)
+{
+    pthread_join(s->thread, NULL);
+    switch (s->format) {
+#ifdef HAVE_ZLIB
+        case FORMAT_GZIP: inflateEnd(&s->gzip); break;
+#endif
+#ifdef HAVE_LZMA
+        case FORMAT_XZ: lzma_end(&s->xz); break;
+#endif
+#ifdef HAVE_ZSTD
+        case FORMAT_ZSTD: ZSTD_freeDStream(s->zstd); break;
+#endif
+        default: break;
+    }
+    if (s->fd != STDIN_FILENO) {close(s->fd);}
+    pthread_mutex_destroy(&s->lock);
+    pthread_cond_destroy(&s->filled);
+    pthread_cond_destroy(&s->emptied);
+    for (int i = 0; i < s->depth; i++) {free(s->chunks[i].buffer);}
+    free(s->chunks);
+    free(s->input);
+    free(s);
+}
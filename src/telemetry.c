@@ -0,0 +1,228 @@
+/*
+ * telemetry.c - Progress and throughput reporting for the GULAG.
+ *
+ * Annealing threads publish their progress through per-thread atomic counters.
+ * A dedicated reporter thread samples those counters on a timer, aggregates
+ * them into an accurate throughput and ETA, and optionally writes a machine
+ * readable time series (CSV or JSONL, chosen by file extension) of score
+ * against time for tuning.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <math.h>
+#include <errno.h>
+
+#include "telemetry.h"
+#include "io.h"
+#include "util.h"
+#include "global.h"
+
+/* Seconds between two samples of the counters. */
+#define REPORT_INTERVAL 0.5
+
+/* Smoothing factor for the throughput used by the ETA. */
+#define RATE_SMOOTHING 0.3
+
+static thread_counters *counters = NULL;
+static int counter_count = 0;
+static long long total_iterations = 0;
+
+static pthread_t reporter;
+static pthread_mutex_t reporter_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t reporter_wake = PTHREAD_COND_INITIALIZER;
+static int reporter_stop = 0;
+
+static FILE *series = NULL;
+/* 'c' for CSV, 'j' for JSONL. */
+static char series_format = 'c';
+
+static struct timespec start_time;
+
+/* Aggregate of every thread's counters at one point in time. */
+typedef struct sample {
+    double seconds;
+    long long iterations;
+    long long accepts;
+    long long improvements;
+    float best_score;
+} sample;
+
+/* Seconds since start_telemetry(). */
+static double elapsed_seconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start_time.tv_sec) + (now.tv_nsec - start_time.tv_nsec) / 1e9;
+}
+
+/* Sums the counters of every thread. */
+static sample take_sample()
+{
+    sample s = {elapsed_seconds(), 0, 0, 0, -INFINITY};
+    for (int i = 0; i < counter_count; i++) {
+        s.iterations += atomic_load_explicit(&counters[i].iterations, memory_order_relaxed);
+        s.accepts += atomic_load_explicit(&counters[i].accepts, memory_order_relaxed);
+        s.improvements += atomic_load_explicit(&counters[i].improvements, memory_order_relaxed);
+        float best = atomic_load_explicit(&counters[i].best_score, memory_order_relaxed);
+        if (best > s.best_score) {s.best_score = best;}
+    }
+    return s;
+}
+
+/*
+ * Prints the progress line and appends one row to the time series.
+ * Parameters:
+ *   s:    The current sample.
+ *   rate: The smoothed aggregate throughput in layouts per second.
+ */
+static void report(sample s, double rate)
+{
+    double progress = total_iterations > 0 ? (double)s.iterations / total_iterations : 1;
+    if (progress > 1) {progress = 1;}
+    int remaining = rate > 0 ? (int)((total_iterations - s.iterations) / rate) : 0;
+    if (remaining < 0) {remaining = 0;}
+
+    /* Calculate hours, minutes, and seconds */
+    int hours = remaining / 3600;
+    int minutes = (remaining % 3600) / 60;
+    int seconds = remaining % 60;
+
+    /* Print the result (with correct pluralization) */
+    log_print('n', L"\r%3d%%  ETA: %02dh %02dm %02ds, %8.0lf layout%s/sec, best: %f        ",
+        (int)(progress * 100), hours, minutes, seconds, rate,
+        rate == 1 ? "" : "s", s.best_score);
+
+    if (series == NULL) {return;}
+    double accept_rate = s.iterations > 0 ? (double)s.accepts / s.iterations : 0;
+    if (series_format == 'j') {
+        fprintf(series, "{\"seconds\": %.3f, \"iterations\": %lld, \"layouts_per_second\": %.1f, "
+            "\"accept_rate\": %.5f, \"improvements\": %lld, \"best_score\": %f}\n",
+            s.seconds, s.iterations, rate, accept_rate, s.improvements, s.best_score);
+    } else {
+        fprintf(series, "%.3f,%lld,%.1f,%.5f,%lld,%f\n",
+            s.seconds, s.iterations, rate, accept_rate, s.improvements, s.best_score);
+    }
+    fflush(series);
+}
+
+/*
+ * Reporter thread: samples the counters every REPORT_INTERVAL seconds until
+ * stop_telemetry() is called.
+ */
+static void *reporter_function(void *arg)
+{
+    sample last = take_sample();
+    double rate = 0;
+
+    pthread_mutex_lock(&reporter_lock);
+    while (!reporter_stop) {
+        struct timespec wake;
+        clock_gettime(CLOCK_REALTIME, &wake);
+        wake.tv_nsec += (long)(REPORT_INTERVAL * 1e9);
+        wake.tv_sec += wake.tv_nsec / 1000000000L;
+        wake.tv_nsec %= 1000000000L;
+
+        int waited = 0;
+        while (!reporter_stop && waited != ETIMEDOUT) {
+            waited = pthread_cond_timedwait(&reporter_wake, &reporter_lock, &wake);
+        }
+        if (reporter_stop) {break;}
+        pthread_mutex_unlock(&reporter_lock);
+
+        sample current = take_sample();
+        double dt = current.seconds - last.seconds;
+        if (dt > 0) {
+            double instant = (current.iterations - last.iterations) / dt;
+            rate = rate == 0 ? instant : RATE_SMOOTHING * instant + (1 - RATE_SMOOTHING) * rate;
+        }
+        report(current, rate);
+        last = current;
+
+        pthread_mutex_lock(&reporter_lock);
+    }
+    pthread_mutex_unlock(&reporter_lock);
+    return NULL;
+}
+
+/*
+ * Allocates one set of counters per thread and starts the reporter thread,
+ * which samples them on a timer to print throughput and ETA, and optionally
+ * appends a time series to the file named by 'telemetry_name'.
+ */
+void start_telemetry(int count, long long total)
+{
+    counter_count = count;
+    total_iterations = total;
+    counters = (thread_counters *)aligned_alloc(64, sizeof(thread_counters) * count);
+    if (counters == NULL) {error("failed to allocate telemetry counters");}
+    for (int i = 0; i < count; i++) {
+        atomic_init(&counters[i].iterations, 0);
+        atomic_init(&counters[i].accepts, 0);
+        atomic_init(&counters[i].improvements, 0);
+        atomic_init(&counters[i].best_score, -INFINITY);
+    }
+
+    series = NULL;
+    if (telemetry_name != NULL) {
+        int header = 1;
+        /* keep appending to an existing series so runs can be compared */
+        FILE *existing = fopen(telemetry_name, "r");
+        if (existing != NULL) {
+            header = fgetc(existing) == EOF;
+            fclose(existing);
+        }
+        series = fopen(telemetry_name, "a");
+        if (series == NULL) {error("Telemetry file could not be opened.");}
+        size_t len = strlen(telemetry_name);
+        series_format = (len > 6 && strcmp(telemetry_name + len - 6, ".jsonl") == 0) ? 'j' : 'c';
+        if (header && series_format == 'c') {
+            fprintf(series, "seconds,iterations,layouts_per_second,accept_rate,improvements,best_score\n");
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    reporter_stop = 0;
+    if (pthread_create(&reporter, NULL, reporter_function, NULL) != 0) {
+        error("failed to create telemetry reporter thread");
+    }
+}
+
+/* Returns the counters belonging to one annealing thread. */
+thread_counters *get_counters(int thread_id)
+{
+    return &counters[thread_id];
+}
+
+/*
+ * Stops the reporter thread, prints the final progress line and closes the
+ * time series file.
+ */
+long long stop_telemetry()
+{
+    pthread_mutex_lock(&reporter_lock);
+    reporter_stop = 1;
+    pthread_cond_signal(&reporter_wake);
+    pthread_mutex_unlock(&reporter_lock);
+    pthread_join(reporter, NULL);
+
+    /* final line uses the average over the whole run */
+    sample final = take_sample();
+    double rate = final.seconds > 0 ? final.iterations / final.seconds : 0;
+    report(final, rate);
+    /* Newline after percentage reaches 100% */
+    log_print('q', L"\n");
+
+    if (series != NULL) {
+        fclose(series);
+        series = NULL;
+    }
+
+    free(counters);
+    counters = NULL;
+    counter_count = 0;
+    return final.iterations;
+}
@@ -179,7 +179,7 @@ size_t index_mono(int i) {
  * Returns: The index in the linearized bigram array.
  */
 size_t index_bi(int i, int j) {
-    return i * LANG_LENGTH + j;
+    return (size_t)i * LANG_LENGTH + j;
 }
 
 /*
@@ -189,7 +189,8 @@ size_t index_bi(int i, int j) {
  * Returns: The index in the linearized trigram array.
  */
 size_t index_tri(int i, int j, int k) {
-    return i * LANG_LENGTH * LANG_LENGTH + j * LANG_LENGTH + k;
+    size_t l = LANG_LENGTH;
+    return ((size_t)i * l + j) * l + k;
 }
 
 /*
@@ -199,7 +200,8 @@ size_t index_tri(int i, int j, int k) {
  * Returns: The index in the linearized quadgram array.
  */
 size_t index_quad(int i, int j, int k, int l) {
-    return i * LANG_LENGTH * LANG_LENGTH * LANG_LENGTH + j * LANG_LENGTH * LANG_LENGTH + k * LANG_LENGTH + l;
+    size_t n = LANG_LENGTH;
+    return (((size_t)i * n + j) * n + k) * n + l;
 }
 
 /*
@@ -210,88 +212,145 @@ size_t index_quad(int i, int j, int k, int l) {
  * Returns: The index in the linearized skipgram array.
  */
 size_t index_skip(int skip_index, int j, int k) {
-    return skip_index * LANG_LENGTH * LANG_LENGTH + j * LANG_LENGTH + k;
+    size_t l = LANG_LENGTH;
+    return ((size_t)skip_index * l + j) * l + k;
 }
 
-/* Normalizes the corpus data from raw frequencies to percentages. */
-void normalize_corpus()
+/*
+ * Allocates zeroed memory aligned to a cache line, so the flat frequency
+ * arrays can be processed with aligned vector loads.
+ * Parameters:
+ *   count: The number of elements.
+ *   size:  The size of each element.
+ * Returns: The allocated memory, to be released with free.
+ */
+void *aligned_calloc(size_t count, size_t size)
 {
-    long long total_mono = 0;
-    long long total_bi = 0;
-    long long total_tri = 0;
-    long long total_quad = 0;
-    long long total_skip[10] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-
-    log_print('n',L"Calculating totals... ");
-
-    for (int i = 0; i < LANG_LENGTH; i++) {
-        total_mono += corpus_mono[i];
-        for (int j = 0; j < LANG_LENGTH; j++) {
-            total_bi += corpus_bi[i][j];
-            for (int k = 0; k < LANG_LENGTH; k++) {
-                total_tri += corpus_tri[i][j][k];
-                for (int l = 0; l < LANG_LENGTH; l++) {
-                    total_quad += corpus_quad[i][j][k][l];
-                }
-            }
-        }
-    }
-
-    for (int i = 1; i <= 9; i++) {
-        for (int j = 0; j < LANG_LENGTH; j++) {
-            for (int k = 0; k < LANG_LENGTH; k++) {
-                total_skip[i] += corpus_skip[i][j][k];
-            }
-        }
-    }
+    /* aligned_alloc needs a multiple of the alignment */
+    size_t bytes = (count * size + 63) / 64 * 64;
+    void *memory = aligned_alloc(64, bytes);
+    if (memory == NULL) {error("failed to allocate aligned memory");}
+    memset(memory, 0, bytes);
+    return memory;
+}
 
-    log_print('n',L"Normalizing... ");
+/*
+ * Allocates the raw and normalized corpus arrays for the current language.
+ * Languages larger than DENSE_LANG_LENGTH get sparse tri, quad and skip
+ * tables, a dense quadgram array alone would take gigabytes.
+ */
+void alloc_corpus()
+{
+    size_t l = LANG_LENGTH;
+    log_print('v',L"Monograms... ");
+    corpus_mono = (long long *)aligned_calloc(l, sizeof(long long));
+    linear_mono = (float *)aligned_calloc(l, sizeof(float));
+
+    log_print('v',L"Bigrams... ");
+    corpus_bi = (long long *)aligned_calloc(l * l, sizeof(long long));
+    linear_bi = (float *)aligned_calloc(l * l, sizeof(float));
+
+    if (LANG_LENGTH > DENSE_LANG_LENGTH) {
+        log_print('v',L"Sparse trigrams, quadgrams and skipgrams... ");
+        sparse_tri = create_sparse(l * l); /* sparse.c */
+        sparse_quad = create_sparse(l * l); /* sparse.c */
+        sparse_skip = create_sparse(l * l); /* sparse.c */
+        return;
+    }
+
+    log_print('v',L"Trigrams... ");
+    corpus_tri = (long long *)aligned_calloc(l * l * l, sizeof(long long));
+    linear_tri = (float *)aligned_calloc(l * l * l, sizeof(float));
+
+    log_print('v',L"Quadgrams... ");
+    corpus_quad = (long long *)aligned_calloc(l * l * l * l, sizeof(long long));
+    linear_quad = (float *)aligned_calloc(l * l * l * l, sizeof(float));
+
+    /* skip distances 1 to 9, index 0 is unused */
+    log_print('v',L"Skipgrams... ");
+    corpus_skip = (long long *)aligned_calloc(10 * l * l, sizeof(long long));
+    linear_skip = (float *)aligned_calloc(10 * l * l, sizeof(float));
+}
 
-    if (total_mono > 0) {
-        for (int i = 0; i < LANG_LENGTH; i++) {
-            linear_mono[index_mono(i)] = (float)corpus_mono[i] * 100 / total_mono;
-        }
+/*
+ * Converts one flat table of counts to percentages of its total, in a single
+ * linear pass the compiler can vectorize.
+ */
+void normalize_table(const long long *counts, float *linear, size_t size)
+{
+    long long total = 0;
+    for (size_t i = 0; i < size; i++) {total += counts[i];}
+    if (total <= 0) {return;}
+    for (size_t i = 0; i < size; i++) {
+        linear[i] = (float)counts[i] * 100 / total;
     }
+}
 
-    if (total_bi > 0) {
-        for (int i = 0; i < LANG_LENGTH; i++) {
-            for (int j = 0; j < LANG_LENGTH; j++) {
-                linear_bi[index_bi(i, j)] = (float)corpus_bi[i][j] * 100 / total_bi;
-            }
-        }
-    }
+/* Normalizes the corpus data from raw frequencies to percentages. */
+void normalize_corpus()
+{
+    size_t l = LANG_LENGTH;
 
-    if (total_tri > 0) {
-        for (int i = 0; i < LANG_LENGTH; i++) {
-            for (int j = 0; j < LANG_LENGTH; j++) {
-                for (int k = 0; k < LANG_LENGTH; k++) {
-                    linear_tri[index_tri(i, j, k)] = (float)corpus_tri[i][j][k] * 100 / total_tri;
-                }
-            }
-        }
-    }
+    log_print('n',L"Normalizing... ");
 
-    if (total_quad > 0) {
-        for (int i = 0; i < LANG_LENGTH; i++) {
-            for (int j = 0; j < LANG_LENGTH; j++) {
-                for (int k = 0; k < LANG_LENGTH; k++) {
-                    for (int l = 0; l < LANG_LENGTH; l++) {
-                        linear_quad[index_quad(i, j, k, l)] = (float)corpus_quad[i][j][k][l] * 100 / total_quad;
-                    }
-                }
-            }
-        }
+    normalize_table(corpus_mono, linear_mono, l);
+    normalize_table(corpus_bi, linear_bi, l * l);
+    if (sparse_quad != NULL) {
+        normalize_sparse(sparse_tri, l * l * l); /* sparse.c */
+        normalize_sparse(sparse_quad, l * l * l * l); /* sparse.c */
+        /* each skip distance is normalized on its own */
+        normalize_sparse(sparse_skip, l * l); /* sparse.c */
+        return;
+    }
+    normalize_table(corpus_tri, linear_tri, l * l * l);
+    normalize_table(corpus_quad, linear_quad, l * l * l * l);
+    /* each skip distance is normalized on its own */
+    for (int i = 1; i <= 9; i++) {
+        normalize_table(corpus_skip + index_skip(i, 0, 0), linear_skip + index_skip(i, 0, 0), l * l);
     }
+}
 
-    if (total_skip > 0) {
-        for (int i = 1; i <= 9; i++) {
-            for (int j = 0; j < LANG_LENGTH; j++) {
-                for (int k = 0; k < LANG_LENGTH; k++) {
-                    linear_skip[index_skip(i, j, k)] = (float)corpus_skip[i][j][k] * 100 / total_skip[i];
-                }
-            }
-        }
-    }
+/*
+ * Zeroes the raw corpus counts, so another corpus can be counted into them.
+ */
+void clear_corpus()
+{
+    size_t l = LANG_LENGTH;
+    memset(corpus_mono, 0, l * sizeof(long long));
+    memset(corpus_bi, 0, l * l * sizeof(long long));
+    if (sparse_quad != NULL) {
+        free_sparse(sparse_tri); /* sparse.c */
+        free_sparse(sparse_quad); /* sparse.c */
+        free_sparse(sparse_skip); /* sparse.c */
+        sparse_tri = create_sparse(l * l); /* sparse.c */
+        sparse_quad = create_sparse(l * l); /* sparse.c */
+        sparse_skip = create_sparse(l * l); /* sparse.c */
+        return;
+    }
+    memset(corpus_tri, 0, l * l * l * sizeof(long long));
+    memset(corpus_quad, 0, l * l * l * l * sizeof(long long));
+    memset(corpus_skip, 0, 10 * l * l * sizeof(long long));
+}
+
+/*
+ * Frees the raw corpus counts, only the normalized linear arrays are needed
+ * for scoring.
+ */
+void free_corpus()
+{
+    free(corpus_mono);
+    free(corpus_bi);
+    free(corpus_tri);
+    free(corpus_quad);
+    free(corpus_skip);
+    corpus_mono = NULL;
+    corpus_bi = NULL;
+    corpus_tri = NULL;
+    corpus_quad = NULL;
+    corpus_skip = NULL;
+    free_sparse_counts(sparse_tri); /* sparse.c */
+    free_sparse_counts(sparse_quad); /* sparse.c */
+    free_sparse_counts(sparse_skip); /* sparse.c */
 }
 
 /*
@@ -482,19 +541,26 @@ void free_list() {
 }
 
 /*
- * Randomly shuffles the keys in a layout.
+ * Randomly shuffles the keys in a layout, leaving the gaps of the keyboard
+ * where they are.
  * Parameters:
- *   lt: Pointer to the layout to be shuffled.
+ *   lt: Pointer to the layout to be shuffled.
  */
 void shuffle_layout(layout *lt)
 {
-    for (int i = DIM1 - 1; i > 0; i--) {
+    int positions[MAX_ROW * MAX_COL];
+    int count = 0;
+    for (int i = 0; i < DIM1; i++) {
+        if (key_fingers[i / COL][i % COL] != -1) {positions[count++] = i;}
+    }
+
+    for (int i = count - 1; i > 0; i--) {
         int j = rand() % (i + 1);
 
-        int i_row = i / COL;
-        int i_col = i % COL;
-        int j_row = j / COL;
-        int j_col = j % COL;
+        int i_row = positions[i] / COL;
+        int i_col = positions[i] % COL;
+        int j_row = positions[j] / COL;
+        int j_col = positions[j] % COL;
 
         int temp = lt->matrix[i_row][i_col];
         lt->matrix[i_row][i_col] = lt->matrix[j_row][j_col];